@@ -29,8 +29,26 @@ MxxRu::Cpp::composite_target( MxxRu::BUILD_ROOT ) {
 
 	required_prj 'test/topic_name_splitter/prj.ut.rb'
 	required_prj 'test/subscription_map/prj.ut.rb'
+	required_prj 'test/shared_subscription/prj.ut.rb'
+	required_prj 'test/subscriptions_cover/prj.ut.rb'
+	required_prj 'test/recent_messages/prj.ut.rb'
+	required_prj 'test/correlation_table/prj.ut.rb'
+	required_prj 'test/topic_throttle/prj.ut.rb'
+	required_prj 'test/io_dispatcher/prj.ut.rb'
+	required_prj 'test/subscribe_packet/prj.ut.rb'
+	required_prj 'test/subscription_batch/prj.ut.rb'
+	required_prj 'test/bulk_status/prj.ut.rb'
+	required_prj 'test/subscription_deadlines/prj.ut.rb'
+	required_prj 'test/payload_filter/prj.ut.rb'
+	required_prj 'test/callback_subscriber/prj.ut.rb'
 
 	required_prj 'test/simple_start_stop/prj.rb'
 	required_prj 'test/simple_subscribe/prj.rb'
 	required_prj 'test/dummy_decoder/prj.rb'
+	required_prj 'test/local_echo/prj.rb'
+	required_prj 'test/publish_conflation/prj.rb'
+	required_prj 'test/incoming_conflation/prj.rb'
+	required_prj 'test/batch_max_age/prj.rb'
+	required_prj 'test/fan_out_order/prj.rb'
+	required_prj 'test/mchain_delivery/prj.rb'
 }
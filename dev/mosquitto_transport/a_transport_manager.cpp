@@ -10,10 +10,15 @@
 #include <mosquitto_transport/a_transport_manager.hpp>
 #include <mosquitto_transport/tools.hpp>
 
+#include <mosquitto_transport/impl/mosquitto_shim.hpp>
+#include <mosquitto_transport/impl/resolve_host.hpp>
+#include <mosquitto_transport/impl/subscribe_packet.hpp>
+
 #include <fmt/format.h>
 #include <fmt/ostream.h>
 
 #include <algorithm>
+#include <cstdlib>
 #include <iterator>
 
 namespace mosquitto_transport {
@@ -22,6 +27,9 @@ namespace details {
 
 constexpr int qos_to_use = 0;
 
+//! Value of granted QoS in SUBACK for failed subscription.
+constexpr int subscription_failure_qos = 0x80;
+
 //
 // subscription_info_t
 //
@@ -33,15 +41,26 @@ subscription_status_t
 subscription_info_t::status() const
 	{ return m_status; }
 
+const std::string &
+subscription_info_t::failure_description() const
+	{ return m_failure_description; }
+
 void
 subscription_info_t::subscription_created(
 	const std::string & topic_name )
 	{
+		// Subscription can be confirmed again when it is moved
+		// between broker subscriptions. Postmans must not be
+		// informed twice in that case.
+		const bool already_subscribed =
+				subscription_status_t::subscribed == m_status;
+
 		m_status = subscription_status_t::subscribed;
 		m_failure_description.clear();
 
-		for( const auto & p : m_postmans )
-			p->subscription_available( topic_name );
+		if( !already_subscribed )
+			for( const auto & p : m_postmans )
+				p->subscription_available( topic_name );
 	}
 
 void
@@ -86,21 +105,147 @@ subscription_info_t::add_postman(
 		// If there is no any exception after status setup the postman
 		// can be stored in postmans set.
 		m_postmans.insert( postman );
+
+		std::lock_guard< std::mutex > lock{ m_snapshot_lock };
+		m_snapshot.reset();
 	}
 
 void
 subscription_info_t::remove_postman( const postman_shared_ptr_t & postman )
 	{
 		m_postmans.erase( postman );
+
+		std::lock_guard< std::mutex > lock{ m_snapshot_lock };
+		m_snapshot.reset();
 	}
 
-void
+//
+// deliver_to_postmans
+//
+/*!
+ * \brief Deliver a message to a range of postmans.
+ *
+ * \a filter_results must be created for \a payload. It can be shared by
+ * all subscriptions matched by the message.
+ *
+ * \return count of postmans which rejected the message by payload filters.
+ *
+ * \since
+ * v.0.7.0
+ */
+template< typename IT >
+std::size_t
+deliver_to_postmans(
+	IT first,
+	IT last,
+	const std::string & topic,
+	const std::string & payload,
+	const delivery_info_t & info,
+	impl::payload_filter_results_t & filter_results )
+	{
+		std::size_t rejected = 0u;
+
+		for(; first != last; ++first )
+			{
+				const auto & p = *first;
+				const auto * filter = p->payload_filter();
+				if( filter && !filter_results.accept( *filter ) )
+					{
+						++rejected;
+						continue;
+					}
+
+				if( p->accept( topic, payload ) )
+					p->deliver( topic, payload, info );
+			}
+
+		return rejected;
+	}
+
+std::size_t
 subscription_info_t::deliver_message(
 	const std::string & topic,
-	const std::string & payload )
+	const std::string & payload,
+	const delivery_info_t & info,
+	impl::payload_filter_results_t & filter_results )
 	{
-		for( const auto & p : m_postmans )
-			p->post( topic, payload );
+		return deliver_to_postmans( m_postmans.begin(), m_postmans.end(),
+				topic, payload, info, filter_results );
+	}
+
+std::size_t
+subscription_info_t::postmans_count() const
+	{
+		return m_postmans.size();
+	}
+
+postmans_snapshot_t
+subscription_info_t::postmans_snapshot()
+	{
+		std::lock_guard< std::mutex > lock{ m_snapshot_lock };
+		if( !m_snapshot )
+			m_snapshot = std::make_shared< std::vector< postman_shared_ptr_t > >(
+					m_postmans.begin(), m_postmans.end() );
+
+		return m_snapshot;
+	}
+
+//
+// resolve_endpoints
+//
+/*!
+ * \brief Get numeric addresses for host names of \a endpoints.
+ *
+ * If a host name can't be resolved the corresponding item of
+ * \a previous is used.
+ *
+ * \note Can be called on any thread.
+ *
+ * \since
+ * v.0.7.0
+ */
+std::vector< broker_endpoint_t >
+resolve_endpoints(
+	const std::vector< broker_endpoint_t > & endpoints,
+	std::vector< broker_endpoint_t > previous,
+	spdlog::logger & logger )
+	{
+		for( std::size_t i = 0; i != endpoints.size(); ++i )
+			{
+				const auto & ep = endpoints[ i ];
+				auto address = impl::resolve_host( ep.m_host );
+				if( address.empty() )
+					logger.warn( "unable to resolve broker address, host={}, "
+							"address_to_use={}",
+							ep.m_host, previous[ i ].m_host );
+				else
+					{
+						logger.info( "broker address resolved, host={}, "
+								"address={}",
+								ep.m_host, address );
+						previous[ i ].m_host = std::move(address);
+					}
+			}
+
+		return previous;
+	}
+
+//
+// whole_seconds
+//
+/*!
+ * \brief Round up a delay to whole seconds for libmosquitto.
+ *
+ * \since
+ * v.0.7.0
+ */
+unsigned int
+whole_seconds( std::chrono::steady_clock::duration d )
+	{
+		const auto s = std::chrono::duration_cast< std::chrono::seconds >(
+				d + std::chrono::seconds{1} - std::chrono::steady_clock::duration{1} );
+		return static_cast< unsigned int >( std::max< decltype(s.count()) >(
+				1, s.count() ) );
 	}
 
 //
@@ -109,9 +254,13 @@ subscription_info_t::deliver_message(
 mosquitto_unique_ptr_t
 make_mosq_instance(
 	const std::string & client_id,
+	bool clean_session,
 	a_transport_manager_t * callback_param )
 	{
-		auto m = mosquitto_new( client_id.c_str(), true, callback_param );
+		ensure_with_explblock< ex_t >( clean_session || !client_id.empty(),
+			[]{ return "client_id must be specified if clean_session is false"; } );
+
+		auto m = mosquitto_new( client_id.c_str(), clean_session, callback_param );
 		ensure_with_explblock< ex_t >( m,
 			[]{ return fmt::format( "mosquitto_new failed, errno: {}", errno ); } );
 
@@ -120,6 +269,232 @@ make_mosq_instance(
 		return retval;
 	}
 
+//
+// backlog_t
+//
+struct backlog_t::ticket_t
+	{
+		const std::shared_ptr< backlog_t > m_backlog;
+		const std::size_t m_bytes;
+
+		~ticket_t()
+			{
+				m_backlog->release( m_bytes );
+			}
+	};
+
+backlog_t::backlog_t(
+	std::size_t high_watermark_messages,
+	std::size_t high_watermark_bytes,
+	std::size_t low_watermark_messages,
+	std::size_t low_watermark_bytes,
+	std::shared_ptr< stats_counters_t > stats )
+	:	m_high_watermark_messages{ high_watermark_messages }
+	,	m_high_watermark_bytes{ high_watermark_bytes }
+	,	m_low_watermark_messages{ low_watermark_messages }
+	,	m_low_watermark_bytes{ low_watermark_bytes }
+	,	m_stats{ std::move(stats) }
+	{}
+
+void
+backlog_t::set_pause_handler( pause_handler_t handler )
+	{
+		std::lock_guard< std::mutex > lock{ m_lock };
+		m_pause_handler = std::move(handler);
+		if( m_paused )
+			m_pause_handler( true );
+	}
+
+delivery_ticket_t
+backlog_t::acquire( std::size_t bytes )
+	{
+		{
+			std::lock_guard< std::mutex > lock{ m_lock };
+			++m_messages;
+			m_bytes += bytes;
+
+			if( !m_paused && ( m_messages >= m_high_watermark_messages ||
+					m_bytes >= m_high_watermark_bytes ) )
+				{
+					m_paused = true;
+					++(m_stats->m_read_pauses);
+					if( m_pause_handler )
+						m_pause_handler( true );
+				}
+		}
+
+		return std::shared_ptr< ticket_t >(
+				new ticket_t{ shared_from_this(), bytes } );
+	}
+
+void
+backlog_t::release( std::size_t bytes )
+	{
+		std::lock_guard< std::mutex > lock{ m_lock };
+		--m_messages;
+		m_bytes -= bytes;
+
+		if( m_paused && m_messages <= m_low_watermark_messages &&
+				m_bytes <= m_low_watermark_bytes )
+			{
+				m_paused = false;
+				if( m_pause_handler )
+					m_pause_handler( false );
+			}
+	}
+
+//
+// rpc_postman_t
+//
+rpc_postman_t::rpc_postman_t(
+	std::string reply_topic_prefix,
+	std::chrono::steady_clock::duration timeout_resolution,
+	std::size_t timer_wheel_slots,
+	std::shared_ptr< spdlog::logger > logger,
+	std::shared_ptr< stats_counters_t > stats )
+	:	m_reply_topic_prefix{ std::move(reply_topic_prefix) }
+	,	m_logger{ std::move(logger) }
+	,	m_stats{ std::move(stats) }
+	,	m_calls{ timeout_resolution, timer_wheel_slots,
+			std::chrono::steady_clock::now() }
+	{}
+
+std::string
+rpc_postman_t::reply_topic_filter() const
+	{
+		return m_reply_topic_prefix + "/+";
+	}
+
+bool
+rpc_postman_t::start_call(
+	const rpc_call_t & cmd,
+	std::string & request_topic )
+	{
+		{
+			std::lock_guard< std::mutex > lock{ m_lock };
+			if( m_replies_available )
+				{
+					m_calls.insert( cmd.m_call_id, cmd.m_completion,
+							std::chrono::steady_clock::now() + cmd.m_timeout );
+
+					request_topic = fmt::format( "{}/{}/{}",
+							cmd.m_topic_name, m_reply_topic_prefix, cmd.m_call_id );
+					return true;
+				}
+		}
+
+		cmd.m_completion->failed( cmd.m_call_id,
+				"reply subscription is not available" );
+		return false;
+	}
+
+void
+rpc_postman_t::expire_calls( std::chrono::steady_clock::time_point now )
+	{
+		std::vector< std::pair< rpc_call_id_t, rpc_completion_shared_ptr_t > >
+				expired;
+		{
+			std::lock_guard< std::mutex > lock{ m_lock };
+			m_calls.expire( now,
+					[&expired]( rpc_call_id_t id, rpc_completion_shared_ptr_t c ) {
+						expired.emplace_back( id, std::move(c) );
+					} );
+		}
+
+		// Completions are called without lock because they can take
+		// some time.
+		for( auto & e : expired )
+			{
+				++(m_stats->m_rpc_timeouts);
+				e.second->failed( e.first, "timeout" );
+			}
+	}
+
+bool
+rpc_postman_t::next_expiration( std::chrono::steady_clock::time_point & at )
+	{
+		std::lock_guard< std::mutex > lock{ m_lock };
+		return m_calls.next_expiration( at );
+	}
+
+void
+rpc_postman_t::subscription_available( const std::string & topic_name )
+	{
+		m_logger->info( "replies to calls are available, topic_filter={}",
+				topic_name );
+
+		std::lock_guard< std::mutex > lock{ m_lock };
+		m_replies_available = true;
+	}
+
+void
+rpc_postman_t::subscription_unavailable( const std::string & )
+	{
+		fail_all_calls( "reply subscription is lost" );
+	}
+
+void
+rpc_postman_t::post( std::string topic_name, std::string payload )
+	{
+		// Reply topic is '<prefix>/<call_id>'.
+		const auto id_start = m_reply_topic_prefix.size() + 1u;
+		char * id_end = nullptr;
+		const auto call_id = static_cast< rpc_call_id_t >( std::strtoull(
+				topic_name.c_str() + std::min( id_start, topic_name.size() ),
+				&id_end, 10 ) );
+		if( topic_name.size() <= id_start ||
+				id_end != topic_name.c_str() + topic_name.size() )
+			{
+				m_logger->warn( "unexpected reply topic, topic={}", topic_name );
+				return;
+			}
+
+		rpc_completion_shared_ptr_t completion;
+		{
+			std::lock_guard< std::mutex > lock{ m_lock };
+			if( !m_calls.extract( call_id, completion ) )
+				{
+					m_logger->debug( "reply for unknown call (timed out?), "
+							"topic={}", topic_name );
+					return;
+				}
+		}
+
+		++(m_stats->m_rpc_replies);
+		completion->completed( call_id, std::move(payload) );
+	}
+
+void
+rpc_postman_t::subscription_failed(
+	const std::string & topic_name,
+	const std::string & description )
+	{
+		// There is nobody to receive an exception.
+		m_logger->error( "subscription for replies to calls failed, "
+				"topic_filter={}, description={}",
+				topic_name, description );
+
+		fail_all_calls( description );
+	}
+
+void
+rpc_postman_t::fail_all_calls( const std::string & description )
+	{
+		std::vector< std::pair< rpc_call_id_t, rpc_completion_shared_ptr_t > >
+				calls;
+		{
+			std::lock_guard< std::mutex > lock{ m_lock };
+			m_replies_available = false;
+			m_calls.clear(
+					[&calls]( rpc_call_id_t id, rpc_completion_shared_ptr_t c ) {
+						calls.emplace_back( id, std::move(c) );
+					} );
+		}
+
+		for( auto & c : calls )
+			c.second->failed( c.first, description );
+	}
+
 } /* namespace details */
 
 using namespace details;
@@ -138,7 +513,11 @@ a_transport_manager_t::a_transport_manager_t(
 	,	m_logger{ std::move(logger) }
 	,	m_mosq{
 			make_mosq_instance(
-				m_connection_params.m_client_id, this ) }
+				m_connection_params.m_client_id,
+				m_connection_params.m_clean_session,
+				this ) }
+	,	m_stats{ std::make_shared< stats_counters_t >() }
+	,	m_standby_mosq{ nullptr, &mosquitto_destroy }
 	{
 		setup_mosq_callbacks();
 	}
@@ -149,21 +528,59 @@ a_transport_manager_t::so_define_agent()
 		st_working
 			.event( m_self_mbox, &a_transport_manager_t::on_subscribe_topic )
 			.event( m_self_mbox, &a_transport_manager_t::on_unsubscribe_topic )
+			.event( m_self_mbox, &a_transport_manager_t::on_subscribe_topics )
+			.event( m_self_mbox, &a_transport_manager_t::on_unsubscribe_topics )
+			// Chunks of parallel delivery must be placed into slots
+			// in the order of messages.
 			.event( m_self_mbox, &a_transport_manager_t::on_message_received,
+					m_fan_out_enabled ? so_5::not_thread_safe : so_5::thread_safe )
+			.event( m_self_mbox, &a_transport_manager_t::on_local_message,
+					so_5::not_thread_safe )
+			.event( m_self_mbox, &a_transport_manager_t::on_flush_incoming_batch,
+					so_5::thread_safe )
+			.event( &a_transport_manager_t::on_serve_fan_out_slot,
+					so_5::thread_safe )
+			.event( &a_transport_manager_t::on_linger_expired )
+			.event( m_self_mbox, &a_transport_manager_t::on_endpoints_resolved )
+			.event< standby_connected_t >(
+				m_self_mbox, &a_transport_manager_t::on_standby_connected )
+			.event< standby_disconnected_t >(
+				m_self_mbox, &a_transport_manager_t::on_standby_disconnected )
+			.event( m_self_mbox,
+				&a_transport_manager_t::on_standby_subscription_result )
+			.event( m_self_mbox,
+				&a_transport_manager_t::on_standby_message_received )
+			.event( m_self_mbox, &a_transport_manager_t::on_rpc_call,
+					so_5::thread_safe )
+			.event( &a_transport_manager_t::on_rpc_timer,
+					so_5::thread_safe )
+			.event( &a_transport_manager_t::on_flush_conflated_message,
 					so_5::thread_safe );
 
 		st_disconnected
 			.on_enter( [this] {
 					// Everyone should be informed that connection lost.
 					so_5::send< broker_disconnected_t >( m_self_mbox );
+					// Broker could be moved to another address.
+					refresh_endpoints_if_stale();
+					arm_endpoints_refresh_timer();
+				} )
+			.on_exit( [this] {
+					m_endpoints_refresh_timer.release();
 				} )
-			.event< connected_t >(
-				m_self_mbox, &a_transport_manager_t::on_connected );
+			.event( m_self_mbox, &a_transport_manager_t::on_connected )
+			.event( &a_transport_manager_t::on_endpoints_refresh_timer )
+			.event( m_self_mbox,
+				&a_transport_manager_t::on_publish_message_when_disconnected,
+					so_5::thread_safe );
 
 		st_connected
 			.on_enter( [this] {
 					// Everyone should be informed that connection established.
 					so_5::send< broker_connected_t >( m_self_mbox );
+					// Subscriptions removed during disconnection must be
+					// removed from broker's session.
+					restore_unsubscriptions_on_reconnect();
 					// All registered subscriptions must be restored.
 					restore_subscriptions_on_reconnect();
 				} )
@@ -172,63 +589,46 @@ a_transport_manager_t::so_define_agent()
 					drop_subscription_statuses();
 					// No more pending subscriptions.
 					m_pending_subscriptions.clear();
+					// Collected subscriptions will be restored on reconnect.
+					m_new_subscriptions.clear();
+					// All subscriptions will be made again after reconnection.
+					// There is no need to repeat them.
+					drop_subscription_deadlines();
+					// Standby connection delivers all messages again.
+					m_subscriptions_to_restore.clear();
 				} )
 			.event< disconnected_t >(
 				m_self_mbox, &a_transport_manager_t::on_disconnected )
 			.event( m_self_mbox, &a_transport_manager_t::on_subscription_result )
 			.event( m_self_mbox, &a_transport_manager_t::on_publish_message,
 					so_5::thread_safe )
-			.event( &a_transport_manager_t::on_pending_subscriptions_timer );
+			.event( &a_transport_manager_t::on_pending_subscriptions_timer )
+			.event( &a_transport_manager_t::on_flush_new_subscriptions );
+
+		make_recent_messages();
 	}
 
 void
 a_transport_manager_t::so_evt_start()
 	{
-		// mosquitto event loop must be started.
-		ensure_mosq_success(
-				mosquitto_loop_start( m_mosq.get() ),
-				[]{ return "mosquitto_loop_start failed"; } );
-
 		this >>= st_disconnected;
 
-		// Initiate connection to broker.
-		ensure_mosq_success(
-				mosquitto_connect_async(
-						m_mosq.get(),
-						m_connection_params.m_host.c_str(),
-						static_cast< int >(m_connection_params.m_port),
-						static_cast< int >(m_connection_params.m_keepalive) ),
-				[&]{ return fmt::format(
-						"mosquitto_connect_async({}, {}, {}) failed",
-						m_connection_params.m_host,
-						m_connection_params.m_port,
-						m_connection_params.m_keepalive ); } );
+		if( m_rpc_postman )
+			start_rpc();
 
-		m_pending_subscriptions_timer =
-			so_5::send_periodic< pending_subscriptions_timer_t >( *this,
-					std::chrono::seconds{1},
-					std::chrono::seconds{1} );
+		start_io();
 	}
 
 void
 a_transport_manager_t::so_evt_finish()
 	{
-		// mosquitto event-loop must be stopped here!
-		if( st_connected == so_current_state() )
-			// Because there is a connection it must be gracefully closed.
-			ensure_mosq_success(
-					mosquitto_disconnect( m_mosq.get() ),
-					[]{ return "mosquitto_disconnect failed"; } );
-
-		ensure_mosq_success(
-				mosquitto_loop_stop( m_mosq.get(), true ),
-				[]{ return "mosquitto_loop_stop failed"; } );
+		stop_io();
 	}
 
 instance_t
 a_transport_manager_t::instance() const
 	{
-		return instance_t{ so_environment(), m_self_mbox };
+		return instance_t{ so_environment(), m_self_mbox, m_stats };
 	}
 
 void
@@ -261,6 +661,197 @@ a_transport_manager_t::set_subscription_timeout(
 		m_subscription_timeout = timeout;
 	}
 
+void
+a_transport_manager_t::set_io_dispatcher(
+	io_dispatcher_handle_t io_dispatcher )
+	{
+		m_io_dispatcher = std::move(io_dispatcher);
+	}
+
+void
+a_transport_manager_t::set_publish_conflation(
+	const std::string & topic_filter,
+	std::chrono::steady_clock::duration min_interval )
+	{
+		ensure_with_explblock< ex_t >(
+				min_interval > std::chrono::steady_clock::duration::zero(),
+				[&]{ return fmt::format( "invalid interval for publish conflation, "
+						"topic_filter='{}'", topic_filter ); } );
+
+		m_publish_conflation_enabled = true;
+		m_publish_conflation_filters.insert( topic_filter, min_interval );
+	}
+
+void
+a_transport_manager_t::set_subscribe_batching(
+	subscribe_batching_params_t params )
+	{
+		ensure_with_explblock< ex_t >(
+				0u != params.m_max_filters && 0u != params.m_max_bytes,
+				[]{ return "subscribe batching limits must be greater than 0"; } );
+
+		m_subscribe_batching = params;
+	}
+
+void
+a_transport_manager_t::set_subscription_coalescing(
+	subscription_coalescing_params_t params )
+	{
+		ensure_with_explblock< ex_t >( 0u != params.m_max_topics,
+				[]{ return "max_topics for subscription coalescing must be "
+						"greater than 0"; } );
+
+		m_subscription_coalescing_enabled = true;
+		m_subscription_coalescing = params;
+	}
+
+void
+a_transport_manager_t::enable_subscription_minimization()
+	{
+		m_subscription_minimization_enabled = true;
+	}
+
+void
+a_transport_manager_t::set_subscription_retry(
+	subscription_retry_params_t params )
+	{
+		ensure_with_explblock< ex_t >(
+				params.m_initial_delay > std::chrono::steady_clock::duration::zero() &&
+				params.m_max_delay >= params.m_initial_delay,
+				[]{ return "invalid delays for subscription retry"; } );
+		ensure_with_explblock< ex_t >(
+				params.m_multiplier >= 1.0 &&
+				params.m_jitter >= 0.0 && params.m_jitter < 1.0,
+				[]{ return "invalid multiplier or jitter for subscription retry"; } );
+
+		m_subscription_retry_enabled = true;
+		m_subscription_retry = params;
+	}
+
+void
+a_transport_manager_t::set_standby_broker( standby_params_t params )
+	{
+		ensure_with_explblock< ex_t >( !params.m_broker.m_host.empty(),
+				[]{ return "host of standby broker is empty"; } );
+
+		const auto & client_id = m_connection_params.m_client_id;
+		m_standby_mosq = make_mosq_instance(
+				client_id.empty() ? client_id :
+						client_id + params.m_client_id_suffix,
+				true,
+				this );
+
+		mosquitto_log_callback_set(
+				m_standby_mosq.get(),
+				&a_transport_manager_t::on_log_callback );
+		mosquitto_connect_callback_set(
+				m_standby_mosq.get(),
+				&a_transport_manager_t::on_standby_connect_callback );
+		mosquitto_disconnect_callback_set(
+				m_standby_mosq.get(),
+				&a_transport_manager_t::on_standby_disconnect_callback );
+		mosquitto_subscribe_callback_set(
+				m_standby_mosq.get(),
+				&a_transport_manager_t::on_standby_subscribe_callback );
+		mosquitto_message_callback_set(
+				m_standby_mosq.get(),
+				&a_transport_manager_t::on_standby_message_callback );
+
+		m_standby = std::move(params);
+	}
+
+void
+a_transport_manager_t::set_local_delivery( local_delivery_params_t params )
+	{
+		ensure_with_explblock< ex_t >(
+				local_delivery_policy_t::skip_broker == params.m_policy ||
+				( params.m_echo_window > std::chrono::steady_clock::duration::zero() &&
+					0u != params.m_echo_max_messages ),
+				[]{ return "invalid echo window for local delivery"; } );
+
+		m_local_delivery_enabled = true;
+		m_local_delivery = params;
+	}
+
+void
+a_transport_manager_t::set_rpc( rpc_params_t params )
+	{
+		if( params.m_reply_topic_prefix.empty() )
+			{
+				ensure_with_explblock< ex_t >(
+						!m_connection_params.m_client_id.empty(),
+						[]{ return "reply topic prefix must be specified if "
+								"client_id is empty"; } );
+				params.m_reply_topic_prefix =
+						"rpc-replies/" + m_connection_params.m_client_id;
+			}
+
+		const auto & prefix = params.m_reply_topic_prefix;
+		ensure_with_explblock< ex_t >(
+				std::string::npos == prefix.find_first_of( "+#" ) &&
+				'/' != prefix.back(),
+				[&]{ return fmt::format( "invalid reply topic prefix: '{}'",
+						prefix ); } );
+		ensure_with_explblock< ex_t >(
+				params.m_timeout_resolution >
+						std::chrono::steady_clock::duration::zero() &&
+				0u != params.m_timer_wheel_slots,
+				[]{ return "invalid timer wheel parameters for calls"; } );
+
+		m_rpc_postman = std::make_shared< rpc_postman_t >(
+				std::move(params.m_reply_topic_prefix),
+				params.m_timeout_resolution,
+				params.m_timer_wheel_slots,
+				m_logger,
+				m_stats );
+		m_rpc_timeout_resolution = params.m_timeout_resolution;
+	}
+
+void
+a_transport_manager_t::set_backpressure( backpressure_params_t params )
+	{
+		ensure_with_explblock< ex_t >(
+				params.m_low_watermark_messages < params.m_high_watermark_messages &&
+				params.m_low_watermark_bytes < params.m_high_watermark_bytes,
+				[]{ return "low watermarks must be less than high watermarks"; } );
+
+		m_backlog = std::make_shared< backlog_t >(
+				params.m_high_watermark_messages,
+				params.m_high_watermark_bytes,
+				params.m_low_watermark_messages,
+				params.m_low_watermark_bytes,
+				m_stats );
+	}
+
+void
+a_transport_manager_t::set_fan_out( fan_out_params_t params )
+	{
+		ensure_with_explblock< ex_t >( 0u != params.m_chunk_size,
+				[]{ return "chunk_size for parallel delivery is zero"; } );
+		ensure_with_explblock< ex_t >( 0u != params.m_slots,
+				[]{ return "count of slots for parallel delivery is zero"; } );
+
+		m_fan_out_enabled = true;
+		m_fan_out = params;
+
+		m_fan_out_slots.clear();
+		for( std::size_t i = 0u; i != params.m_slots; ++i )
+			m_fan_out_slots.emplace_back( new fan_out_slot_t{} );
+	}
+
+void
+a_transport_manager_t::set_unsubscription_linger(
+	std::chrono::steady_clock::duration linger )
+	{
+		m_unsubscription_linger = linger;
+	}
+
+transport_stats_t
+a_transport_manager_t::stats() const
+	{
+		return m_stats->snapshot();
+	}
+
 void
 a_transport_manager_t::setup_mosq_callbacks()
 	{
@@ -284,7 +875,7 @@ a_transport_manager_t::setup_mosq_callbacks()
 
 void
 a_transport_manager_t::on_connect_callback(
-	mosquitto *,
+	mosquitto * mosq,
 	void * this_object,
 	int connect_result )
 	{
@@ -295,7 +886,8 @@ a_transport_manager_t::on_connect_callback(
 				mosquitto_connack_string( connect_result ) );
 
 		if( 0 == connect_result )
-			so_5::send< connected_t >( tm->m_self_mbox );
+			so_5::send< connected_t >( tm->m_self_mbox,
+					impl::connack_session_present( mosq ) );
 	}
 
 void
@@ -346,24 +938,90 @@ a_transport_manager_t::on_message_callback(
 				", retain={}",
 				msg->topic, msg->payloadlen, msg->qos, msg->retain );
 
-		so_5::send< message_received_t >( tm->m_self_mbox, *msg );
+		if( tm->m_backlog )
+			so_5::send< message_received_t >( tm->m_self_mbox, *msg,
+					tm->m_backlog->acquire(
+							static_cast< std::size_t >( msg->payloadlen ) ) );
+		else
+			so_5::send< message_received_t >( tm->m_self_mbox, *msg );
 	}
 
 void
-a_transport_manager_t::on_log_callback(
+a_transport_manager_t::on_standby_connect_callback(
 	mosquitto *,
 	void * this_object,
-	int log_level,
-	const char * log_msg )
+	int connect_result )
 	{
-		static const char log_line_format[] = "[libmosquitto] {}";
-
 		auto tm = reinterpret_cast< a_transport_manager_t * >(this_object);
-		auto & logger = *(tm->m_logger);
 
-		switch( log_level )
-			{
-			case MOSQ_LOG_ERR :
+		tm->m_logger->info( "on_standby_connect, rc={}/{}",
+				connect_result,
+				mosquitto_connack_string( connect_result ) );
+
+		if( 0 == connect_result )
+			so_5::send< standby_connected_t >( tm->m_self_mbox );
+	}
+
+void
+a_transport_manager_t::on_standby_disconnect_callback(
+	mosquitto *,
+	void * this_object,
+	int disconnect_result )
+	{
+		auto tm = reinterpret_cast< a_transport_manager_t * >(this_object);
+
+		tm->m_logger->info( "on_standby_disconnect, rc={}", disconnect_result );
+
+		// Zero means that mosquitto_disconnect() was called by
+		// transport manager itself during its shutdown.
+		if( 0 != disconnect_result )
+			so_5::send< standby_disconnected_t >( tm->m_self_mbox );
+	}
+
+void
+a_transport_manager_t::on_standby_subscribe_callback(
+	mosquitto *,
+	void * this_object,
+	int mid,
+	int qos_count,
+	const int * qos_items )
+	{
+		auto tm = reinterpret_cast< a_transport_manager_t * >(this_object);
+
+		tm->m_logger->trace( "on_standby_subscribe, mid={}, qos_count={}",
+				mid, qos_count );
+
+		so_5::send< standby_subscription_result_t >( tm->m_self_mbox,
+				mid,
+				std::vector< int >( qos_items, qos_items + qos_count ) );
+	}
+
+void
+a_transport_manager_t::on_standby_message_callback(
+	mosquitto *,
+	void * this_object,
+	const mosquitto_message * msg )
+	{
+		auto tm = reinterpret_cast< a_transport_manager_t * >(this_object);
+
+		so_5::send< standby_message_received_t >( tm->m_self_mbox, *msg );
+	}
+
+void
+a_transport_manager_t::on_log_callback(
+	mosquitto *,
+	void * this_object,
+	int log_level,
+	const char * log_msg )
+	{
+		static const char log_line_format[] = "[libmosquitto] {}";
+
+		auto tm = reinterpret_cast< a_transport_manager_t * >(this_object);
+		auto & logger = *(tm->m_logger);
+
+		switch( log_level )
+			{
+			case MOSQ_LOG_ERR :
 				logger.error( log_line_format, log_msg ); break;
 			case MOSQ_LOG_WARNING :
 			case MOSQ_LOG_NOTICE :
@@ -376,199 +1034,1462 @@ a_transport_manager_t::on_log_callback(
 	}
 
 void
-a_transport_manager_t::on_connected()
+a_transport_manager_t::start_io()
+	{
+		if( !m_io_dispatcher )
+			{
+				// Reconnections are performed by libmosquitto itself.
+				ensure_with_explblock< ex_t >(
+						m_connection_params.m_fallback_brokers.empty(),
+						[]{ return "fallback brokers require I/O dispatcher"; } );
+				ensure_with_explblock< ex_t >(
+						0.0 == m_connection_params.m_reconnect.m_jitter,
+						[]{ return "jitter of reconnection delays requires "
+								"I/O dispatcher"; } );
+				// Reading from the socket can't be paused.
+				ensure_with_explblock< ex_t >( !m_backlog,
+						[]{ return "backpressure requires I/O dispatcher"; } );
+			}
+
+		// Host names will be resolved by libmosquitto if
+		// they can't be resolved now.
+		start_resolution( configured_endpoints(), true );
+	}
+
+std::vector< broker_endpoint_t >
+a_transport_manager_t::configured_endpoints() const
+	{
+		std::vector< broker_endpoint_t > endpoints;
+		endpoints.emplace_back(
+				m_connection_params.m_host, m_connection_params.m_port );
+		endpoints.insert( endpoints.end(),
+				m_connection_params.m_fallback_brokers.begin(),
+				m_connection_params.m_fallback_brokers.end() );
+
+		return endpoints;
+	}
+
+void
+a_transport_manager_t::start_resolution(
+	std::vector< broker_endpoint_t > previous,
+	bool initial )
+	{
+		// DNS lookups can take several seconds. They are performed on
+		// a separate thread and the agent's worker thread isn't blocked.
+		// The thread is detached: transport manager doesn't wait for
+		// a hung lookup at shutdown, the result is just dropped.
+		m_resolution = std::make_shared< impl::resolution_slot_t >();
+		m_endpoints_refresh_started_at = std::chrono::steady_clock::now();
+
+		std::thread{
+				[slot = m_resolution,
+					endpoints = configured_endpoints(),
+					previous = std::move(previous),
+					standby = m_standby.m_broker,
+					with_standby = initial && m_standby_mosq,
+					initial,
+					mbox = m_self_mbox,
+					logger = m_logger]() mutable {
+					auto resolved = resolve_endpoints(
+							endpoints, std::move(previous), *logger );
+					if( with_standby )
+						standby = resolve_endpoints(
+								{ standby }, { standby }, *logger ).front();
+
+					slot->deliver( [&] {
+							so_5::send< endpoints_resolved_t >( mbox,
+									std::move(resolved),
+									std::move(standby),
+									initial );
+						} );
+				} }.detach();
+	}
+
+void
+a_transport_manager_t::refresh_endpoints_if_stale()
+	{
+		const auto ttl = m_connection_params.m_reconnect.m_address_ttl;
+		if( !m_io_dispatcher || !m_io_started || m_resolution ||
+				std::chrono::steady_clock::duration::zero() == ttl )
+			return;
+
+		if( std::chrono::steady_clock::now() - m_endpoints_refresh_started_at < ttl )
+			return;
+
+		m_logger->info( "resolving broker addresses again" );
+		start_resolution( m_broker_endpoints, false );
+	}
+
+void
+a_transport_manager_t::arm_endpoints_refresh_timer()
+	{
+		const auto ttl = m_connection_params.m_reconnect.m_address_ttl;
+		if( m_io_dispatcher && m_io_started &&
+				std::chrono::steady_clock::duration::zero() != ttl )
+			m_endpoints_refresh_timer =
+					so_5::send_periodic< endpoints_refresh_timer_t >(
+							*this, ttl, ttl );
+	}
+
+void
+a_transport_manager_t::on_endpoints_refresh_timer(
+	mhood_t< endpoints_refresh_timer_t > )
 	{
+		refresh_endpoints_if_stale();
+	}
+
+void
+a_transport_manager_t::on_endpoints_resolved(
+	const endpoints_resolved_t & cmd )
+	{
+		m_resolution.reset();
+		m_broker_endpoints = cmd.m_endpoints;
+
+		if( !cmd.m_initial )
+			{
+				// Addresses for the next reconnection attempts.
+				m_io_dispatcher->set_endpoints(
+						m_io_connection_id, m_broker_endpoints );
+				return;
+			}
+
+		if( !m_io_dispatcher )
+			{
+				const auto & reconnect = m_connection_params.m_reconnect;
+				ensure_mosq_success(
+						mosquitto_reconnect_delay_set( m_mosq.get(),
+								whole_seconds( reconnect.m_initial_delay ),
+								whole_seconds( reconnect.m_max_delay ),
+								reconnect.m_exponential_backoff ),
+						[]{ return "mosquitto_reconnect_delay_set failed"; } );
+
+				// mosquitto event loop must be started.
+				ensure_mosq_success(
+						mosquitto_loop_start( m_mosq.get() ),
+						[]{ return "mosquitto_loop_start failed"; } );
+			}
+		m_io_started = true;
+		// Addresses must be refreshed if the first connection can't
+		// be established.
+		arm_endpoints_refresh_timer();
+
+		// Initiate connection to broker.
+		const auto & broker = m_broker_endpoints.front();
+		ensure_mosq_success(
+				mosquitto_connect_async(
+						m_mosq.get(),
+						broker.m_host.c_str(),
+						static_cast< int >(broker.m_port),
+						static_cast< int >(m_connection_params.m_keepalive) ),
+				[&]{ return fmt::format(
+						"mosquitto_connect_async({}, {}, {}) failed",
+						broker.m_host,
+						broker.m_port,
+						m_connection_params.m_keepalive ); } );
+
+		if( m_io_dispatcher )
+			m_io_connection_id = m_io_dispatcher->attach( m_mosq.get(),
+					// disconnected_t is sent by on_disconnect_callback().
+					[logger = m_logger]( int rc ) {
+						logger->info( "connection lost, rc={}", rc );
+					},
+					io_dispatcher_t::reconnect_options_t{
+							m_broker_endpoints,
+							m_connection_params.m_keepalive,
+							m_connection_params.m_reconnect } );
+
+		if( m_backlog )
+			// Tickets can outlive transport manager. Because of that
+			// the handler must not refer to the agent.
+			m_backlog->set_pause_handler(
+					[dispatcher = m_io_dispatcher, id = m_io_connection_id,
+						logger = m_logger]( bool paused ) {
+						logger->info( "reading from broker is {}",
+								paused ? "paused" : "resumed" );
+						dispatcher->set_reading_paused( id, paused );
+					} );
+
+		if( m_standby_mosq )
+			start_standby_io( cmd.m_standby );
+	}
+
+void
+a_transport_manager_t::start_standby_io( const broker_endpoint_t & broker )
+	{
+		if( !m_io_dispatcher )
+			ensure_mosq_success(
+					mosquitto_loop_start( m_standby_mosq.get() ),
+					[]{ return "mosquitto_loop_start failed for standby"; } );
+
+		ensure_mosq_success(
+				mosquitto_connect_async(
+						m_standby_mosq.get(),
+						broker.m_host.c_str(),
+						static_cast< int >(broker.m_port),
+						static_cast< int >(m_connection_params.m_keepalive) ),
+				[&]{ return fmt::format(
+						"mosquitto_connect_async({}, {}, {}) failed for standby",
+						broker.m_host,
+						broker.m_port,
+						m_connection_params.m_keepalive ); } );
+
+		if( m_io_dispatcher )
+			m_standby_io_connection_id = m_io_dispatcher->attach(
+					m_standby_mosq.get(),
+					// standby_disconnected_t is sent by
+					// on_standby_disconnect_callback().
+					[logger = m_logger]( int rc ) {
+						logger->info( "standby connection lost, rc={}", rc );
+					},
+					io_dispatcher_t::reconnect_options_t{
+							{ broker },
+							m_connection_params.m_keepalive,
+							m_connection_params.m_reconnect } );
+	}
+
+void
+a_transport_manager_t::stop_io()
+	{
+		if( m_resolution )
+			// The lookup can't be interrupted but its result is dropped.
+			m_resolution->cancel();
+
+		// Connection could be not initiated yet.
+		if( !m_io_started )
+			return;
+
+		// mosquitto event-loop must be stopped here!
+		if( st_connected == so_current_state() )
+			{
+				// Because there is a connection it must be gracefully closed.
+				ensure_mosq_success(
+						mosquitto_disconnect( m_mosq.get() ),
+						[]{ return "mosquitto_disconnect failed"; } );
+				io_wakeup();
+			}
+
+		if( m_io_dispatcher )
+			m_io_dispatcher->detach( m_io_connection_id );
+		else
+			ensure_mosq_success(
+					mosquitto_loop_stop( m_mosq.get(), true ),
+					[]{ return "mosquitto_loop_stop failed"; } );
+
+		if( m_standby_mosq )
+			{
+				if( m_standby_connected )
+					{
+						mosquitto_disconnect( m_standby_mosq.get() );
+						if( m_io_dispatcher )
+							m_io_dispatcher->wakeup( m_standby_io_connection_id );
+					}
+
+				if( m_io_dispatcher )
+					m_io_dispatcher->detach( m_standby_io_connection_id );
+				else
+					mosquitto_loop_stop( m_standby_mosq.get(), true );
+			}
+	}
+
+void
+a_transport_manager_t::io_wakeup()
+	{
+		if( m_io_dispatcher )
+			m_io_dispatcher->wakeup( m_io_connection_id );
+	}
+
+void
+a_transport_manager_t::on_connected( const connected_t & cmd )
+	{
+		m_session_present = cmd.m_session_present;
+
+		if( m_was_connected )
+			{
+				const auto reconnect_time =
+						std::chrono::steady_clock::now() - m_disconnected_at;
+				m_logger->info( "reconnected, time_ms={}",
+						std::chrono::duration_cast< std::chrono::milliseconds >(
+								reconnect_time ).count() );
+				m_stats->reconnected( reconnect_time );
+			}
+		m_was_connected = true;
+
 		this >>= st_connected;
 	}
 
 void
 a_transport_manager_t::on_disconnected()
 	{
-		this >>= st_disconnected;
+		m_disconnected_at = std::chrono::steady_clock::now();
+
+		this >>= st_disconnected;
+	}
+
+void
+a_transport_manager_t::on_subscribe_topic(
+	const subscribe_topic_t & cmd )
+	{
+		impl::subscriptions_cover_t::actions_t actions;
+		add_topic_postman( cmd.m_topic_name, cmd.m_postman, actions );
+		do_broker_actions( actions );
+	}
+
+void
+a_transport_manager_t::on_subscribe_topics(
+	const subscribe_topics_t & cmd )
+	{
+		m_logger->debug( "add postman for several topics, topics={}, "
+				"postman={}",
+				cmd.m_topic_names.size(), cmd.m_postman );
+
+		// All new topics will be sent to the broker at once.
+		impl::subscriptions_cover_t::actions_t actions;
+		for( const auto & topic_name : cmd.m_topic_names )
+			add_topic_postman( topic_name, cmd.m_postman, actions );
+		do_broker_actions( actions );
+	}
+
+void
+a_transport_manager_t::add_topic_postman(
+	const std::string & topic_name,
+	const postman_shared_ptr_t & postman,
+	impl::subscriptions_cover_t::actions_t & actions )
+	{
+		m_logger->debug( "add topic postman, topic={}, postman={}",
+				topic_name, postman );
+
+		const auto delivery_filter = impl::delivery_topic_filter( topic_name );
+		const auto itdelivery = m_delivery_filters.find( delivery_filter );
+		if( itdelivery != m_delivery_filters.end() &&
+				itdelivery->second != topic_name )
+		{
+			// Messages for both subscriptions would be delivered to
+			// postmans of both subscriptions.
+			m_logger->warn( "topic filter is already used by another "
+					"subscription, topic={}, subscription={}",
+					topic_name, itdelivery->second );
+			postman->subscription_failed( topic_name,
+					fmt::format( "topic filter '{}' is already used by "
+							"subscription '{}'",
+							delivery_filter, itdelivery->second ) );
+			return;
+		}
+
+		// Topic is needed again and must not be removed from
+		// broker's session.
+		m_delayed_unsubscriptions.erase( topic_name );
+		// Subscription from linger period is reused.
+		m_lingering_subscriptions.erase( topic_name );
+
+		auto & info = m_registered_subscriptions[ topic_name ];
+		info.add_postman( topic_name, postman );
+		if( subscription_status_t::new_subscription == info.status() )
+		{
+			// Shared subscription must be registered in delivery map
+			// by its underlying topic filter.
+			m_delivery_map.insert( delivery_filter, &info );
+			m_delivery_filters.emplace( delivery_filter, topic_name );
+
+			if( m_subscription_minimization_enabled )
+			{
+				auto a = m_subscriptions_cover.insert( topic_name );
+				actions.m_subscribe.insert( actions.m_subscribe.end(),
+						a.m_subscribe.begin(), a.m_subscribe.end() );
+				actions.m_unsubscribe.insert( actions.m_unsubscribe.end(),
+						a.m_unsubscribe.begin(), a.m_unsubscribe.end() );
+
+				const auto & root_name = m_subscriptions_cover.root_of(
+						topic_name );
+				if( root_name != topic_name )
+					// Messages will be received via existing subscription.
+					inherit_root_status( topic_name, info,
+							m_registered_subscriptions[ root_name ] );
+			}
+			else
+				actions.m_subscribe.push_back( topic_name );
+
+			if( impl::is_shared_subscription( topic_name ) )
+				// Shared subscriptions are not mirrored by standby connection.
+				++m_shared_subscriptions_count;
+			else if( m_standby_connected )
+				{
+					// Standby broker gets all topics without minimization.
+					standby_subscribe( std::vector< std::string >{ topic_name } );
+					update_standby_readiness();
+				}
+		}
+	}
+
+void
+a_transport_manager_t::on_unsubscribe_topic(
+	const unsubscribe_topic_t & cmd )
+	{
+		remove_topic_postman( cmd.m_topic_name, cmd.m_postman );
+	}
+
+void
+a_transport_manager_t::on_unsubscribe_topics(
+	const unsubscribe_topics_t & cmd )
+	{
+		m_logger->debug( "remove postman for several topics, topics={}, "
+				"postman={}",
+				cmd.m_topic_names.size(), cmd.m_postman );
+
+		for( const auto & topic_name : cmd.m_topic_names )
+			remove_topic_postman( topic_name, cmd.m_postman );
+	}
+
+void
+a_transport_manager_t::remove_topic_postman(
+	const std::string & topic_name,
+	const postman_shared_ptr_t & postman )
+	{
+		m_logger->debug( "remove topic postman, topic={}, postman={}",
+				topic_name, postman );
+
+		auto ittopic = m_registered_subscriptions.find( topic_name );
+		if( ittopic != m_registered_subscriptions.end() )
+			{
+				ittopic->second.remove_postman( postman );
+				if( !ittopic->second.has_postmans() )
+					{
+						if( std::chrono::steady_clock::duration::zero() ==
+								m_unsubscription_linger )
+							remove_subscription( ittopic );
+						else
+							{
+								// Subscription is kept for a possible reuse.
+								// Messages for it will be dropped because there
+								// are no postmans.
+								const auto expires_at =
+										std::chrono::steady_clock::now() +
+										m_unsubscription_linger;
+								m_lingering_subscriptions[ topic_name ] =
+										expires_at;
+
+								so_5::send_delayed< linger_expired_t >( *this,
+										m_unsubscription_linger,
+										topic_name,
+										expires_at );
+							}
+					}
+			}
+		else
+			m_logger->warn( "topic for unsubscription is not registered, "
+					"topic={}", topic_name );
+	}
+
+void
+a_transport_manager_t::on_linger_expired( const linger_expired_t & cmd )
+	{
+		// Topic could get a new subscriber or could be lingered again.
+		auto it = m_lingering_subscriptions.find( cmd.m_topic_name );
+		if( it == m_lingering_subscriptions.end() ||
+				it->second != cmd.m_expires_at )
+			return;
+
+		m_lingering_subscriptions.erase( it );
+
+		auto ittopic = m_registered_subscriptions.find( cmd.m_topic_name );
+		if( ittopic != m_registered_subscriptions.end() &&
+				!ittopic->second.has_postmans() )
+			remove_subscription( ittopic );
+	}
+
+void
+a_transport_manager_t::remove_subscription(
+	subscription_info_map_t::iterator ittopic )
+	{
+		// Topic name must be copied because map item will be destroyed.
+		const std::string topic_name = ittopic->first;
+
+		const auto delivery_filter = impl::delivery_topic_filter( topic_name );
+		m_delivery_map.erase( delivery_filter, &(ittopic->second) );
+		m_delivery_filters.erase( delivery_filter );
+		m_registered_subscriptions.erase( ittopic );
+		m_subscription_retries.erase( topic_name );
+
+		if( m_subscription_minimization_enabled )
+			do_broker_actions( m_subscriptions_cover.erase( topic_name ) );
+		else
+			do_unsubscription_actions( topic_name );
+
+		if( impl::is_shared_subscription( topic_name ) )
+			--m_shared_subscriptions_count;
+		else if( m_standby_connected )
+			{
+				standby_unsubscribe( topic_name );
+				update_standby_readiness();
+			}
+	}
+
+void
+a_transport_manager_t::on_subscription_result(
+	const subscription_result_t & cmd )
+	{
+		auto itpending = m_pending_subscriptions.find( cmd.m_mid );
+		if( itpending != m_pending_subscriptions.end() )
+		{
+			const auto & topic_names = itpending->second.m_topic_names;
+			if( topic_names.size() != cmd.m_granted_qos.size() )
+				m_logger->warn( "count of granted_qos mismatch, mid={}, "
+						"topics={}, granted_qos={}",
+						cmd.m_mid, topic_names.size(), cmd.m_granted_qos.size() );
+
+			for( std::size_t i = 0; i != topic_names.size(); ++i )
+			{
+				const auto & topic_name = topic_names[ i ];
+				// Absence of granted_qos value is handled as failure.
+				const int granted_qos = i < cmd.m_granted_qos.size() ?
+						cmd.m_granted_qos[ i ] : subscription_failure_qos;
+
+				subscription_restored( topic_name );
+
+				auto ittopic = m_registered_subscriptions.find( topic_name );
+				if( ittopic != m_registered_subscriptions.end() )
+				{
+					m_logger->debug( "subscription_result: mid={}, topic={}, "
+							"granted_qos={}",
+							cmd.m_mid, topic_name, granted_qos );
+
+					m_stats->subscription_acknowledged(
+							std::chrono::steady_clock::now() -
+							itpending->second.m_initiated_at );
+
+					process_subscription_result(
+							topic_name,
+							ittopic->second,
+							granted_qos );
+				}
+				else
+					m_logger->warn( "unknown topic for subscription_result, "
+							"mid={}, topic={}",
+							cmd.m_mid, topic_name );
+			}
+
+			m_pending_subscriptions.erase( itpending );
+		}
+		else
+			m_logger->warn( "unknown mid in subscription_result_t, mid={}",
+					cmd.m_mid );
+	}
+
+void
+a_transport_manager_t::on_pending_subscriptions_timer(
+	mhood_t< pending_subscriptions_timer_t > )
+	{
+		// This can be a signal from already canceled timer. It is not
+		// a problem: only expired deadlines are handled and the timer
+		// is rearmed for the nearest one.
+		m_pending_subscriptions_timer_armed = false;
+
+		const auto now = std::chrono::steady_clock::now();
+		std::vector< std::string > topics_to_retry;
+
+		while( !m_subscription_deadlines.empty() &&
+				m_subscription_deadlines.top().m_at <= now )
+			{
+				const auto deadline = m_subscription_deadlines.top();
+				m_subscription_deadlines.pop();
+
+				if( deadline.m_topic_name.empty() )
+					{
+						// SUBACK can be already received. MID can be reused
+						// for another packet.
+						auto it = m_pending_subscriptions.find( deadline.m_mid );
+						if( it != m_pending_subscriptions.end() &&
+								it->second.m_deadline == deadline.m_at )
+							{
+								const auto pending = std::move(it->second);
+								m_pending_subscriptions.erase( it );
+								subscription_timed_out( pending );
+							}
+					}
+				else
+					{
+						// Topic can be unsubscribed or rescheduled.
+						auto it = m_subscription_retries.find( deadline.m_topic_name );
+						if( it != m_subscription_retries.end() &&
+								it->second.m_retry_at == deadline.m_at &&
+								( !m_subscription_minimization_enabled ||
+									m_subscriptions_cover.is_root(
+											deadline.m_topic_name ) ) )
+							topics_to_retry.push_back( deadline.m_topic_name );
+					}
+			}
+
+		if( !topics_to_retry.empty() )
+			{
+				m_logger->info( "repeating failed subscriptions, topics={}",
+						topics_to_retry.size() );
+				m_stats->m_subscription_retries += topics_to_retry.size();
+
+				do_subscription_actions( topics_to_retry );
+			}
+
+		arm_pending_subscriptions_timer();
+	}
+
+void
+a_transport_manager_t::on_message_received(
+	const message_received_t & cmd )
+	{
+		if( m_recent_messages &&
+				!accept_message( cmd, impl::message_source_t::primary ) )
+			// Message is already delivered via standby connection
+			// or locally.
+			return;
+
+		deliver_message( cmd );
+	}
+
+void
+a_transport_manager_t::on_flush_incoming_batch(
+	const flush_incoming_batch_t & cmd )
+	{
+		cmd.m_flusher->flush( cmd.m_batch_id );
+	}
+
+void
+a_transport_manager_t::on_standby_connected()
+	{
+		m_standby_connected = true;
+
+		std::vector< std::string > topic_names;
+		topic_names.reserve( m_registered_subscriptions.size() );
+		for( const auto & info : m_registered_subscriptions )
+			if( !impl::is_shared_subscription( info.first ) )
+				topic_names.push_back( info.first );
+
+		m_logger->info( "standby connected, topics to subscribe={}",
+				topic_names.size() );
+
+		standby_subscribe( topic_names );
+		update_standby_readiness();
+	}
+
+void
+a_transport_manager_t::on_standby_disconnected()
+	{
+		m_standby_connected = false;
+		// The standby broker drops all subscriptions because
+		// clean_session is always used for standby connection.
+		m_standby_pending_subscriptions.clear();
+		m_standby_subscribed.clear();
+		update_standby_readiness();
+	}
+
+void
+a_transport_manager_t::on_standby_subscription_result(
+	const standby_subscription_result_t & cmd )
+	{
+		auto it = m_standby_pending_subscriptions.find( cmd.m_mid );
+		if( it == m_standby_pending_subscriptions.end() )
+			// SUBACK for the previous standby connection.
+			return;
+
+		const auto topic_names = std::move(it->second);
+		m_standby_pending_subscriptions.erase( it );
+
+		for( std::size_t i = 0u; i != topic_names.size(); ++i )
+			{
+				const auto & topic_name = topic_names[ i ];
+				if( i < cmd.m_granted_qos.size() &&
+						subscription_failure_qos != cmd.m_granted_qos[ i ] )
+					{
+						// Topic could be unsubscribed while SUBACK was in flight.
+						if( m_registered_subscriptions.count( topic_name ) )
+							m_standby_subscribed.insert( topic_name );
+					}
+				else
+					{
+						m_logger->warn( "standby subscription rejected, topic={}",
+								topic_name );
+						++(m_stats->m_standby_subscription_failures);
+					}
+			}
+
+		update_standby_readiness();
+	}
+
+void
+a_transport_manager_t::update_standby_readiness()
+	{
+		const bool ready = m_standby_connected &&
+				m_standby_pending_subscriptions.empty() &&
+				m_standby_subscribed.size() + m_shared_subscriptions_count ==
+						m_registered_subscriptions.size();
+
+		if( ready != m_standby_ready )
+			{
+				m_standby_ready = ready;
+				m_stats->m_standby_ready.store( ready, std::memory_order_relaxed );
+				m_logger->info( "standby connection is {}",
+						ready ? "ready" : "not ready" );
+			}
+	}
+
+void
+a_transport_manager_t::on_standby_message_received(
+	const standby_message_received_t & cmd )
+	{
+		if( st_connected == so_current_state() &&
+				m_subscriptions_to_restore.empty() )
+			// Messages are delivered via primary connection.
+			return;
+
+		if( !accept_message( cmd, impl::message_source_t::standby ) )
+			return;
+
+		++(m_stats->m_standby_deliveries);
+		deliver_message( cmd );
+	}
+
+bool
+a_transport_manager_t::accept_message(
+	const message_received_t & cmd,
+	impl::message_source_t source )
+	{
+		const auto hash = impl::message_hash(
+				cmd.m_body->m_topic_name, cmd.m_body->m_payload );
+
+		std::lock_guard< std::mutex > lock{ m_recent_messages_lock };
+		if( m_recent_messages->accept(
+				hash, source, std::chrono::steady_clock::now() ) )
+			return true;
+
+		++(m_stats->m_duplicates_dropped);
+		return false;
+	}
+
+void
+a_transport_manager_t::standby_subscribe(
+	const std::vector< std::string > & topic_names )
+	{
+		impl::for_each_subscribe_packet( topic_names,
+				m_subscribe_batching.m_max_filters,
+				m_subscribe_batching.m_max_bytes,
+				[&]( std::size_t first, std::size_t last ) {
+					std::vector< char * > filters;
+					for( auto i = first; i != last; ++i )
+						filters.push_back( const_cast< char * >(
+								topic_names[ i ].c_str() ) );
+
+					int mid{};
+					auto r = impl::subscribe_multiple( m_standby_mosq.get(),
+							&mid, filters, qos_to_use );
+					if( MOSQ_ERR_SUCCESS == r )
+						// Topics are counted as subscribed only after SUBACK.
+						m_standby_pending_subscriptions[ mid ] =
+								std::vector< std::string >(
+										topic_names.begin() +
+												static_cast< std::ptrdiff_t >( first ),
+										topic_names.begin() +
+												static_cast< std::ptrdiff_t >( last ) );
+					else
+						m_logger->warn( "standby subscription failed, "
+								"first_topic={}, topics={}, rc={}",
+								topic_names[ first ], filters.size(), r );
+				} );
+
+		if( m_io_dispatcher )
+			m_io_dispatcher->wakeup( m_standby_io_connection_id );
+	}
+
+void
+a_transport_manager_t::standby_unsubscribe(
+	const std::string & topic_name )
+	{
+		m_standby_subscribed.erase( topic_name );
+
+		auto r = mosquitto_unsubscribe( m_standby_mosq.get(), nullptr,
+				topic_name.c_str() );
+		if( MOSQ_ERR_SUCCESS != r )
+			m_logger->warn( "standby unsubscription failed, topic={}, rc={}",
+					topic_name, r );
+		else if( m_io_dispatcher )
+			m_io_dispatcher->wakeup( m_standby_io_connection_id );
+	}
+
+void
+a_transport_manager_t::deliver_message(
+	const message_received_t & cmd )
+	{
+		const auto & body = *(cmd.m_body);
+		auto subscribers = m_delivery_map.match_with_params( body.m_topic_name );
+		if( !subscribers.empty() )
+			deliver_to_subscribers( subscribers,
+					delivery_info_t{ cmd.m_body, cmd.m_ticket, cmd.m_received_at, {} } );
+		else
+			m_logger->warn( "message for unregistered topic, topic={}, "
+					"payloadlen={}",
+					body.m_topic_name, body.m_payload.size() );
+	}
+
+void
+a_transport_manager_t::deliver_to_subscribers(
+	std::vector< delivery_map_t::match_t > & subscribers,
+	delivery_info_t info )
+	{
+		std::shared_ptr< const fan_out_message_t > shared_msg;
+		// Filters are evaluated once for all matched subscriptions.
+		impl::payload_filter_results_t filter_results{ info.m_body->m_payload };
+
+		std::size_t rejected = 0u;
+		for( auto & s : subscribers )
+			{
+				info.m_topic_params = std::move(s.m_params);
+				rejected += deliver_to_subscription( *(s.m_postman),
+						info, shared_msg, filter_results );
+			}
+		if( rejected )
+			m_stats->m_filtered_messages += rejected;
+	}
+
+std::size_t
+a_transport_manager_t::deliver_to_subscription(
+	subscription_info_t & subscription,
+	const delivery_info_t & info,
+	std::shared_ptr< const fan_out_message_t > & shared_msg,
+	impl::payload_filter_results_t & filter_results )
+	{
+		const auto & topic = info.m_body->m_topic_name;
+		const auto & payload = info.m_body->m_payload;
+
+		if( !m_fan_out_enabled ||
+				subscription.postmans_count() <= m_fan_out.m_threshold )
+			return subscription.deliver_message(
+					topic, payload, info, filter_results );
+
+		auto postmans = subscription.postmans_snapshot();
+		const auto chunk_size = m_fan_out.m_chunk_size;
+
+		if( !shared_msg ||
+				shared_msg->m_info.m_topic_params != info.m_topic_params )
+			// The body is shared by all chunks. Delivery info is copied
+			// only once for subscriptions with the same topic params.
+			shared_msg = std::make_shared< const fan_out_message_t >(
+					fan_out_message_t{ info } );
+
+		for( std::size_t first = chunk_size, index = 0u;
+				first < postmans->size();
+				first += chunk_size, ++index )
+			{
+				// A chunk with the same index always goes to the same slot.
+				// Its postmans receive messages in the order of placement.
+				place_fan_out_chunk( index % m_fan_out_slots.size(),
+						fan_out_chunk_t{
+								postmans,
+								first,
+								std::min( first + chunk_size, postmans->size() ),
+								shared_msg } );
+				++(m_stats->m_fan_out_chunks);
+			}
+
+		// The first chunk is served on the current thread.
+		return deliver_to_postmans(
+				postmans->begin(),
+				postmans->begin() + static_cast< std::ptrdiff_t >(
+						std::min( chunk_size, postmans->size() ) ),
+				topic, payload, info, filter_results );
+	}
+
+void
+a_transport_manager_t::place_fan_out_chunk(
+	std::size_t slot,
+	fan_out_chunk_t chunk )
+	{
+		auto & s = *(m_fan_out_slots[ slot ]);
+
+		std::lock_guard< std::mutex > lock{ s.m_lock };
+		s.m_chunks.push( std::move(chunk) );
+		if( !s.m_busy )
+			{
+				s.m_busy = true;
+				so_5::send< serve_fan_out_slot_t >( *this, slot );
+			}
+	}
+
+void
+a_transport_manager_t::on_serve_fan_out_slot(
+	const serve_fan_out_slot_t & cmd )
+	{
+		auto & s = *(m_fan_out_slots[ cmd.m_slot ]);
+
+		fan_out_chunk_t chunk;
+		{
+			std::lock_guard< std::mutex > lock{ s.m_lock };
+			chunk = std::move( s.m_chunks.front() );
+			s.m_chunks.pop();
+		}
+
+		const auto & postmans = *chunk.m_postmans;
+		// Chunks are served on other threads and use their own results.
+		const auto & info = chunk.m_msg->m_info;
+		impl::payload_filter_results_t filter_results{ info.m_body->m_payload };
+		const auto rejected = deliver_to_postmans(
+				postmans.begin() + static_cast< std::ptrdiff_t >( chunk.m_first ),
+				postmans.begin() + static_cast< std::ptrdiff_t >( chunk.m_last ),
+				info.m_body->m_topic_name,
+				info.m_body->m_payload,
+				info,
+				filter_results );
+		if( rejected )
+			m_stats->m_filtered_messages += rejected;
+
+		// One chunk is served by one event. Other events of the agent
+		// are not delayed by a long queue in the slot.
+		std::lock_guard< std::mutex > lock{ s.m_lock };
+		if( s.m_chunks.empty() )
+			s.m_busy = false;
+		else
+			so_5::send< serve_fan_out_slot_t >( *this, cmd.m_slot );
+	}
+
+void
+a_transport_manager_t::on_publish_message(
+	const publish_message_t & cmd )
+	{
+		const bool delivered_locally =
+				m_local_delivery_enabled && deliver_locally( cmd );
+		if( delivered_locally &&
+				local_delivery_policy_t::skip_broker == m_local_delivery.m_policy )
+			return;
+
+		if( m_publish_conflation_enabled &&
+				conflate_message( cmd, delivered_locally ) )
+			// The message can be replaced by a newer one. It will be
+			// remembered only if it is really published.
+			return;
+
+		if( delivered_locally )
+			// The broker will send the message back because there
+			// are subscriptions for it. It must be remembered before
+			// publishing because the copy can be received at any moment.
+			remember_local_delivery( cmd.m_topic_name, cmd.m_payload );
+
+		publish_to_broker( cmd.m_topic_name, cmd.m_payload );
+	}
+
+void
+a_transport_manager_t::publish_to_broker(
+	const std::string & topic_name,
+	const std::string & payload )
+	{
+		if( do_publish( topic_name, payload ) )
+			io_wakeup();
 	}
 
 void
-a_transport_manager_t::on_subscribe_topic(
-	const subscribe_topic_t & cmd )
+a_transport_manager_t::on_publish_message_when_disconnected(
+	const publish_message_t & cmd )
 	{
-		m_logger->debug( "add topic postman, topic={}, postman={}",
-				cmd.m_topic_name, cmd.m_postman );
+		// The message can't be published to the broker but
+		// local subscribers can receive it.
+		if( m_local_delivery_enabled )
+			deliver_locally( cmd );
 
-		auto & info = m_registered_subscriptions[ cmd.m_topic_name ];
-		info.add_postman( cmd.m_topic_name, cmd.m_postman );
-		if( subscription_status_t::new_subscription == info.status() )
-		{
-			m_delivery_map.insert( cmd.m_topic_name, &info );
-			try_subscribe_topic( cmd.m_topic_name );
-		}
+		++(m_stats->m_unpublished_messages);
 	}
 
-void
-a_transport_manager_t::on_unsubscribe_topic(
-	const unsubscribe_topic_t & cmd )
+bool
+a_transport_manager_t::conflate_message(
+	const publish_message_t & cmd,
+	bool delivered_locally )
 	{
-		m_logger->debug( "remove topic postman, topic={}, postman={}",
-				cmd.m_topic_name, cmd.m_postman );
+		const auto intervals = m_publish_conflation_filters.match(
+				cmd.m_topic_name );
+		if( intervals.empty() )
+			return false;
 
-		auto ittopic = m_registered_subscriptions.find( cmd.m_topic_name );
-		if( ittopic != m_registered_subscriptions.end() )
+		std::lock_guard< std::mutex > lock{ m_conflated_topics_lock };
+
+		auto it = m_conflated_topics.find( cmd.m_topic_name );
+		if( it == m_conflated_topics.end() )
 			{
-				ittopic->second.remove_postman( cmd.m_postman );
-				if( !ittopic->second.has_postmans() )
-					{
-						m_delivery_map.erase( cmd.m_topic_name, &(ittopic->second) );
-						m_registered_subscriptions.erase( ittopic );
+				// There were no publishes during min interval.
+				// Message can be published right now. The following
+				// messages will wait for the flush.
+				const auto min_interval = *std::min_element(
+						intervals.begin(), intervals.end() );
 
-						m_logger->info( "topic unsubscription, topic={}",
-								cmd.m_topic_name );
+				details::conflated_topic_t topic;
+				topic.m_min_interval = min_interval;
+				m_conflated_topics.emplace( cmd.m_topic_name, std::move(topic) );
 
-						auto r = mosquitto_unsubscribe( m_mosq.get(), 0,
-								cmd.m_topic_name.c_str() );
-						// If there is an error we can't do something reasonable.
-						// Just log it and ignore.
-						if( r != MOSQ_ERR_SUCCESS )
-							m_logger->warn( "mosquitto_unsubscribe failed, "
-									"topic={}, rc={}",
-									cmd.m_topic_name, r );
-					}
+				so_5::send_delayed< flush_conflated_message_t >( *this,
+						min_interval,
+						cmd.m_topic_name );
+
+				return false;
 			}
-		else
-			m_logger->warn( "topic for unsubscription is not registered, "
-					"topic={}", cmd.m_topic_name );
+
+		auto & topic = it->second;
+		if( topic.m_pending )
+			// The previous message is replaced by the new one.
+			++(m_stats->m_conflated_messages);
+
+		topic.m_pending = true;
+		topic.m_payload = cmd.m_payload;
+		topic.m_delivered_locally = delivered_locally;
+
+		return true;
 	}
 
 void
-a_transport_manager_t::on_subscription_result(
-	const subscription_result_t & cmd )
+a_transport_manager_t::on_flush_conflated_message(
+	const flush_conflated_message_t & cmd )
 	{
-		auto itpending = m_pending_subscriptions.find( cmd.m_mid );
-		if( itpending != m_pending_subscriptions.end() )
+		std::string payload;
+		bool delivered_locally = false;
 		{
-			auto ittopic = m_registered_subscriptions.find(
-					itpending->second.m_topic_name );
-			if( ittopic != m_registered_subscriptions.end() )
+			std::lock_guard< std::mutex > lock{ m_conflated_topics_lock };
+
+			auto it = m_conflated_topics.find( cmd.m_topic_name );
+			if( it == m_conflated_topics.end() )
+				return;
+
+			if( !it->second.m_pending )
+				{
+					// There were no messages during min interval.
+					// The next message can be published immediately.
+					m_conflated_topics.erase( it );
+					return;
+				}
+
+			// The next flush is performed after min interval anyway.
+			// It removes the state if there will be no new messages.
+			it->second.m_pending = false;
+			payload.swap( it->second.m_payload );
+			delivered_locally = it->second.m_delivered_locally;
+			so_5::send_delayed< flush_conflated_message_t >( *this,
+					it->second.m_min_interval,
+					cmd.m_topic_name );
+		}
+
+		if( st_connected == so_current_state() )
 			{
-				m_logger->debug( "subscription_result: mid={}, topic={}, "
-						"granted_qos={}",
-						cmd.m_mid,
-						itpending->second.m_topic_name,
-						cmd.m_granted_qos.front() );
+				if( delivered_locally )
+					// Only the payload which is really published
+					// will be received back.
+					remember_local_delivery( cmd.m_topic_name, payload );
 
-				process_subscription_result(
-						itpending->second.m_topic_name,
-						ittopic->second,
-						cmd.m_granted_qos.front() );
+				publish_to_broker( cmd.m_topic_name, payload );
 			}
-			else
-				m_logger->warn( "unknown topic for subscription_result, "
-						"mid={}, topic={}",
-						cmd.m_mid,
-						itpending->second.m_topic_name );
+		else
+			{
+				// Messages published during disconnection are lost.
+				m_logger->debug( "conflated message dropped because of "
+						"disconnection, topic={}", cmd.m_topic_name );
+				++(m_stats->m_unpublished_messages);
+			}
+	}
 
-			m_pending_subscriptions.erase( itpending );
-		}
+bool
+a_transport_manager_t::deliver_locally(
+	const publish_message_t & cmd )
+	{
+		auto subscribers = m_delivery_map.match_with_params( cmd.m_topic_name );
+		if( subscribers.empty() )
+			return false;
+
+		m_logger->debug( "local delivery, topic={}, payloadlen={}",
+				cmd.m_topic_name, cmd.m_payload.size() );
+
+		auto body = std::make_shared< const message_body_t >(
+				cmd.m_topic_name, cmd.m_payload );
+		if( m_fan_out_enabled )
+			// This event is thread safe. Chunks of parallel delivery
+			// must be placed into slots by a not thread-safe event
+			// in the same way as messages from the broker.
+			so_5::send< local_message_t >( m_self_mbox, std::move(body) );
 		else
-			m_logger->warn( "unknown mid in subscription_result_t, mid={}",
-					cmd.m_mid );
+			{
+				delivery_info_t info;
+				info.m_body = std::move(body);
+				deliver_to_subscribers( subscribers, std::move(info) );
+			}
+
+		++(m_stats->m_local_deliveries);
+		return true;
 	}
 
 void
-a_transport_manager_t::on_pending_subscriptions_timer(
-	mhood_t< pending_subscriptions_timer_t > )
+a_transport_manager_t::on_local_message(
+	const local_message_t & cmd )
 	{
-		if( m_pending_subscriptions.empty() )
+		// Subscriptions could be changed since the message was published.
+		auto subscribers = m_delivery_map.match_with_params(
+				cmd.m_body->m_topic_name );
+		if( subscribers.empty() )
 			return;
 
-		const auto now = std::chrono::steady_clock::now();
-		for( auto it = m_pending_subscriptions.begin();
-				it != m_pending_subscriptions.end(); )
-			{
-				auto & pending = it->second;
-				if( now - pending.m_initiated_at > m_subscription_timeout )
-					{
-						auto itdel = it++;
-						m_logger->error( "subscription timed out, topic={}",
-								pending.m_topic_name );
+		delivery_info_t info;
+		info.m_body = cmd.m_body;
+		deliver_to_subscribers( subscribers, std::move(info) );
+	}
 
-						auto ittopic = m_registered_subscriptions.find(
-								pending.m_topic_name );
-						ittopic->second.subscription_failed(
-								pending.m_topic_name,
-								"subscription timed out" );
+void
+a_transport_manager_t::remember_local_delivery(
+	const std::string & topic_name,
+	const std::string & payload )
+	{
+		const auto hash = impl::message_hash( topic_name, payload );
 
-						m_pending_subscriptions.erase( itdel );
-					}
-				else
-					++it;
+		std::lock_guard< std::mutex > lock{ m_recent_messages_lock };
+		m_recent_messages->remember(
+				hash,
+				impl::message_source_t::local,
+				std::chrono::steady_clock::now() );
+	}
+
+void
+a_transport_manager_t::make_recent_messages()
+	{
+		const bool local_echoes = m_local_delivery_enabled &&
+				local_delivery_policy_t::publish_to_broker ==
+						m_local_delivery.m_policy;
+
+		if( !m_standby_mosq && !local_echoes )
+			return;
+
+		// One window is used for both kinds of duplicates.
+		// It must be suitable for both of them.
+		std::chrono::steady_clock::duration window{};
+		std::size_t max_size{};
+		if( m_standby_mosq )
+			{
+				window = m_standby.m_dedup_window;
+				max_size = m_standby.m_dedup_max_messages;
+			}
+		if( local_echoes )
+			{
+				window = std::max( window, m_local_delivery.m_echo_window );
+				max_size = std::max( max_size,
+						m_local_delivery.m_echo_max_messages );
 			}
+
+		m_recent_messages.reset( new impl::recent_messages_t{
+				window, max_size } );
 	}
 
 void
-a_transport_manager_t::on_message_received(
-	const message_received_t & cmd )
+a_transport_manager_t::start_rpc()
 	{
-		auto subscribers = m_delivery_map.match( cmd.m_topic );
-		if( !subscribers.empty() )
+		// Subscription to replies is made as an ordinary subscription.
+		// It will be restored after reconnection.
+		impl::subscriptions_cover_t::actions_t actions;
+		add_topic_postman( m_rpc_postman->reply_topic_filter(),
+				m_rpc_postman, actions );
+		do_broker_actions( actions );
+	}
+
+void
+a_transport_manager_t::on_rpc_call(
+	const rpc_call_t & cmd )
+	{
+		if( !m_rpc_postman )
+			{
+				cmd.m_completion->failed( cmd.m_call_id, "calls are not enabled" );
+				return;
+			}
+
+		std::string request_topic;
+		if( !m_rpc_postman->start_call( cmd, request_topic ) )
+			return;
+
+		++(m_stats->m_rpc_calls);
+
 		{
-			for( auto * s : subscribers )
-				s->deliver_message( cmd.m_topic, cmd.m_payload );
+			const auto deadline = std::chrono::steady_clock::now() + cmd.m_timeout;
+
+			std::lock_guard< std::mutex > lock{ m_rpc_timer_lock };
+			if( !m_rpc_timer_armed || deadline < m_rpc_timer_deadline )
+				arm_rpc_timer( deadline, std::chrono::steady_clock::duration::zero() );
 		}
+
+		// Reply subscription is available only in st_connected.
+		// Request is published as an ordinary message.
+		on_publish_message( publish_message_t{
+				std::move(request_topic), cmd.m_payload } );
+	}
+
+void
+a_transport_manager_t::on_rpc_timer(
+	mhood_t< rpc_timer_t > )
+	{
+		m_rpc_postman->expire_calls( std::chrono::steady_clock::now() );
+
+		// Timer is re-armed only while there are pending calls.
+		// The deadline is taken under m_rpc_timer_lock, so a call started
+		// concurrently either is seen here or re-arms the timer itself.
+		std::lock_guard< std::mutex > lock{ m_rpc_timer_lock };
+		std::chrono::steady_clock::time_point at;
+		if( m_rpc_postman->next_expiration( at ) )
+			arm_rpc_timer( at, m_rpc_timeout_resolution );
 		else
-			m_logger->warn( "message for unregistered topic, topic={}, "
-					"payloadlen={}",
-					cmd.m_topic, cmd.m_payload.size() );
+			{
+				m_rpc_timer.release();
+				m_rpc_timer_armed = false;
+			}
 	}
 
 void
-a_transport_manager_t::on_publish_message(
-	const publish_message_t & cmd )
+a_transport_manager_t::arm_rpc_timer(
+	std::chrono::steady_clock::time_point deadline,
+	std::chrono::steady_clock::duration min_delay )
+	{
+		const auto delay = std::max( min_delay,
+				deadline - std::chrono::steady_clock::now() );
+
+		m_rpc_timer_deadline = deadline;
+		m_rpc_timer_armed = true;
+		// Zero period makes a single-shot timer which can be cancelled.
+		m_rpc_timer = so_5::send_periodic< rpc_timer_t >( *this,
+				delay,
+				std::chrono::steady_clock::duration::zero() );
+	}
+
+void
+a_transport_manager_t::on_flush_new_subscriptions(
+	const flush_new_subscriptions_t & cmd )
+	{
+		// The batch could be already sent because of size limit.
+		// A flush for a newer batch will be performed at the end
+		// of its own window.
+		if( m_new_subscriptions.is_current( cmd.m_batch_id ) )
+			flush_new_subscriptions();
+	}
+
+void
+a_transport_manager_t::flush_new_subscriptions()
+	{
+		auto topic_names = m_new_subscriptions.take();
+
+		// The same topic could be unsubscribed and subscribed again
+		// during coalescing window. Or it could be unsubscribed completely.
+		std::sort( topic_names.begin(), topic_names.end() );
+		topic_names.erase(
+				std::unique( topic_names.begin(), topic_names.end() ),
+				topic_names.end() );
+		// With minimization of subscriptions a topic could also be
+		// covered by a wider subscription during coalescing window.
+		topic_names.erase(
+				std::remove_if( topic_names.begin(), topic_names.end(),
+					[this]( const std::string & t ) {
+						return m_registered_subscriptions.end() ==
+								m_registered_subscriptions.find( t ) ||
+							( m_subscription_minimization_enabled &&
+								!m_subscriptions_cover.is_root( t ) );
+					} ),
+				topic_names.end() );
+
+		if( !topic_names.empty() )
+			do_subscription_actions( topic_names );
+	}
+
+bool
+a_transport_manager_t::do_publish(
+	const std::string & topic_name,
+	const std::string & payload )
 	{
 		m_logger->debug( "message publish, topic={}, "
 				"payloadlen={}",
-				cmd.m_topic_name, cmd.m_payload.size() );
+				topic_name, payload.size() );
 
 		auto r = mosquitto_publish( m_mosq.get(), 0 /* mid */,
-				cmd.m_topic_name.c_str(),
-				static_cast< int >(cmd.m_payload.size()),
-				cmd.m_payload.data(),
+				topic_name.c_str(),
+				static_cast< int >(payload.size()),
+				payload.data(),
 				qos_to_use,
 				false /* retain */ );
 
 		// If error just log it and ignore.
 		if( MOSQ_ERR_SUCCESS != r )
+			{
 				m_logger->warn( "message_publish failed, rc={}, topic={}, "
 						"payloadlen={}",
-						r, cmd.m_topic_name, cmd.m_payload.size() );
+						r, topic_name, payload.size() );
+				return false;
+			}
+
+		++(m_stats->m_published_messages);
+		m_stats->m_published_bytes += payload.size();
+
+		return true;
+	}
+
+void
+a_transport_manager_t::try_subscribe_topics(
+	const std::vector< std::string > & topic_names )
+	{
+		if( !( st_connected == so_current_state() ) || topic_names.empty() )
+			// Subscription will be sent after connection.
+			return;
+
+		if( !m_subscription_coalescing_enabled )
+			{
+				do_subscription_actions( topic_names );
+				return;
+			}
+
+		if( m_new_subscriptions.add( topic_names ) )
+			// The first subscription in a new batch.
+			so_5::send_delayed< flush_new_subscriptions_t >( *this,
+					m_subscription_coalescing.m_window,
+					m_new_subscriptions.id() );
+
+		if( m_new_subscriptions.size() >=
+				m_subscription_coalescing.m_max_topics )
+			flush_new_subscriptions();
 	}
 
 void
-a_transport_manager_t::try_subscribe_topic(
+a_transport_manager_t::do_unsubscription_actions(
 	const std::string & topic_name )
 	{
-		if( st_connected == so_current_state() )
-			do_subscription_actions( topic_name );
+		m_logger->info( "topic unsubscription, topic={}", topic_name );
+
+		// Even if UNSUBSCRIBE is delayed the subscription will be removed
+		// from the session before any new SUBSCRIBE.
+		m_session_subscriptions.erase( topic_name );
+
+		auto r = mosquitto_unsubscribe( m_mosq.get(), 0, topic_name.c_str() );
+		if( r == MOSQ_ERR_SUCCESS )
+			io_wakeup();
+		else if( !m_connection_params.m_clean_session &&
+				( MOSQ_ERR_NO_CONN == r || MOSQ_ERR_CONN_LOST == r ) )
+			{
+				// Broker can hold this subscription in the session.
+				// Unsubscription must be repeated after reconnection.
+				m_logger->info( "topic unsubscription delayed, topic={}",
+						topic_name );
+				m_delayed_unsubscriptions.insert( topic_name );
+			}
+		else
+			// If there is an error we can't do something reasonable.
+			// Just log it and ignore.
+			m_logger->warn( "mosquitto_unsubscribe failed, "
+					"topic={}, rc={}",
+					topic_name, r );
+	}
+
+void
+a_transport_manager_t::do_broker_actions(
+	const impl::subscriptions_cover_t::actions_t & actions )
+	{
+		// New broker subscriptions must be made before removal of
+		// old ones. Otherwise some messages can be lost.
+		std::vector< std::string > topic_names;
+		topic_names.reserve( actions.m_subscribe.size() );
+		for( const auto & topic_name : actions.m_subscribe )
+			{
+				// Topic can be covered by another topic from the same
+				// bulk subscription.
+				if( m_subscription_minimization_enabled &&
+						!m_subscriptions_cover.is_root( topic_name ) )
+					continue;
+
+				topic_names.push_back( topic_name );
+			}
+
+		try_subscribe_topics( topic_names );
+
+		for( const auto & topic_name : actions.m_unsubscribe )
+			{
+				m_logger->debug( "topic is covered by wider subscription or "
+						"removed, topic={}", topic_name );
+				do_unsubscription_actions( topic_name );
+			}
+	}
+
+void
+a_transport_manager_t::inherit_root_status(
+	const std::string & topic_name,
+	subscription_info_t & info,
+	const subscription_info_t & root_info )
+	{
+		if( subscription_status_t::subscribed == root_info.status() )
+			info.subscription_created( topic_name );
+		else if( subscription_status_t::failed == root_info.status() &&
+				subscription_status_t::failed != info.status() )
+			info.subscription_failed( topic_name,
+					root_info.failure_description() );
+	}
+
+void
+a_transport_manager_t::propagate_root_status(
+	const std::string & root_name )
+	{
+		auto itroot = m_registered_subscriptions.find( root_name );
+		if( itroot == m_registered_subscriptions.end() )
+			return;
+
+		for( const auto & topic_name :
+				m_subscriptions_cover.covered_by( root_name ) )
+			{
+				auto it = m_registered_subscriptions.find( topic_name );
+				if( it != m_registered_subscriptions.end() )
+					inherit_root_status( topic_name, it->second, itroot->second );
+			}
 	}
 
 void
 a_transport_manager_t::do_subscription_actions(
-	const std::string & topic_name )
+	const std::vector< std::string > & topic_names )
+	{
+		impl::for_each_subscribe_packet( topic_names,
+				m_subscribe_batching.m_max_filters,
+				m_subscribe_batching.m_max_bytes,
+				[&]( std::size_t first, std::size_t last ) {
+					send_subscribe_packet( topic_names, first, last );
+				} );
+
+		io_wakeup();
+	}
+
+void
+a_transport_manager_t::send_subscribe_packet(
+	const std::vector< std::string > & topic_names,
+	std::size_t first,
+	std::size_t last )
 	{
 		int mid{};
 
-		m_logger->info( "topic subscription, topic={}", topic_name );
+		std::vector< char * > filters;
+		filters.reserve( last - first );
+		for( auto i = first; i != last; ++i )
+			{
+				m_logger->debug( "topic subscription, topic={}",
+						topic_names[ i ] );
+				filters.push_back( const_cast< char * >(
+						topic_names[ i ].c_str() ) );
+			}
+
+		m_logger->info( "topic subscription, first_topic={}, topics={}",
+				topic_names[ first ], filters.size() );
 
-		auto r = mosquitto_subscribe( m_mosq.get(),
-				&mid, topic_name.c_str(), qos_to_use );
+		auto r = impl::subscribe_multiple( m_mosq.get(), &mid, filters,
+				qos_to_use );
 		ensure_with_explblock< ex_t >(
 				MOSQ_ERR_SUCCESS == r ||
 				MOSQ_ERR_NO_CONN == r ||
 				MOSQ_ERR_CONN_LOST == r,
-				[&]{ return fmt::format( "mosquitto_subscribe({}, {}) "
-						"failed, rc={}", topic_name, qos_to_use, r ); } );
+				[&]{ return fmt::format( "mosquitto_subscribe({}, {} topics, {}) "
+						"failed, rc={}",
+						topic_names[ first ], filters.size(), qos_to_use, r ); } );
 
+		const auto now = std::chrono::steady_clock::now();
+		const auto deadline = now + m_subscription_timeout;
 		m_pending_subscriptions[ mid ] = pending_subscription_t{
-				topic_name,
-				std::chrono::steady_clock::now() };
+				std::vector< std::string >(
+						topic_names.begin() + static_cast< std::ptrdiff_t >( first ),
+						topic_names.begin() + static_cast< std::ptrdiff_t >( last ) ),
+				now,
+				deadline };
+
+		add_subscription_deadline(
+				impl::subscription_deadline_t{ deadline, mid, {} } );
 	}
 
 void
@@ -578,7 +2499,13 @@ a_transport_manager_t::process_subscription_result(
 	int granted_qos )
 	{
 		if( qos_to_use == granted_qos )
-			info.subscription_created( topic_name );
+			{
+				info.subscription_created( topic_name );
+				m_subscription_retries.erase( topic_name );
+
+				if( !m_connection_params.m_clean_session )
+					m_session_subscriptions.insert( topic_name );
+			}
 		else
 			{
 				m_logger->error( "unexpected qos, topic_filter={}, granted_qos={}",
@@ -587,7 +2514,119 @@ a_transport_manager_t::process_subscription_result(
 				info.subscription_failed(
 						topic_name,
 						fmt::format( "unexpected qos: {}", granted_qos ) );
+
+				schedule_subscription_retry( topic_name );
+			}
+
+		if( m_subscription_minimization_enabled &&
+				m_subscriptions_cover.is_root( topic_name ) )
+			propagate_root_status( topic_name );
+	}
+
+void
+a_transport_manager_t::subscription_timed_out(
+	const pending_subscription_t & pending )
+	{
+		for( const auto & topic_name : pending.m_topic_names )
+			{
+				m_logger->error( "subscription timed out, topic={}", topic_name );
+				++(m_stats->m_subscription_timeouts);
+
+				subscription_restored( topic_name );
+
+				auto ittopic = m_registered_subscriptions.find( topic_name );
+				if( ittopic != m_registered_subscriptions.end() )
+					{
+						ittopic->second.subscription_failed(
+								topic_name,
+								"subscription timed out" );
+
+						if( m_subscription_minimization_enabled &&
+								m_subscriptions_cover.is_root( topic_name ) )
+							propagate_root_status( topic_name );
+
+						schedule_subscription_retry( topic_name );
+					}
+			}
+	}
+
+void
+a_transport_manager_t::schedule_subscription_retry(
+	const std::string & topic_name )
+	{
+		if( !m_subscription_retry_enabled )
+			return;
+
+		auto & retry = m_subscription_retries[ topic_name ];
+		if( 0u != m_subscription_retry.m_max_attempts &&
+				retry.m_attempts >= m_subscription_retry.m_max_attempts )
+			{
+				m_logger->error( "no more subscription attempts, topic={}, "
+						"attempts={}",
+						topic_name, retry.m_attempts );
+				m_subscription_retries.erase( topic_name );
+				return;
 			}
+
+		const auto delay = impl::subscription_retry_delay(
+				m_subscription_retry.m_initial_delay,
+				m_subscription_retry.m_max_delay,
+				m_subscription_retry.m_multiplier,
+				m_subscription_retry.m_jitter,
+				retry.m_attempts,
+				m_random_engine );
+
+		++retry.m_attempts;
+		retry.m_retry_at = std::chrono::steady_clock::now() + delay;
+
+		m_logger->info( "subscription will be repeated, topic={}, attempt={}, "
+				"delay_ms={}",
+				topic_name, retry.m_attempts,
+				std::chrono::duration_cast< std::chrono::milliseconds >(
+						delay ).count() );
+
+		add_subscription_deadline(
+				impl::subscription_deadline_t{ retry.m_retry_at, 0, topic_name } );
+	}
+
+void
+a_transport_manager_t::add_subscription_deadline(
+	impl::subscription_deadline_t deadline )
+	{
+		m_subscription_deadlines.push( std::move(deadline) );
+		arm_pending_subscriptions_timer();
+	}
+
+void
+a_transport_manager_t::arm_pending_subscriptions_timer()
+	{
+		if( m_subscription_deadlines.empty() )
+			return;
+
+		const auto nearest = m_subscription_deadlines.top().m_at;
+		if( m_pending_subscriptions_timer_armed &&
+				m_pending_subscriptions_timer_at <= nearest )
+			// The timer will fire early enough.
+			return;
+
+		const auto now = std::chrono::steady_clock::now();
+		// The previous timer (if any) is canceled by the assignment.
+		m_pending_subscriptions_timer =
+			so_5::send_periodic< pending_subscriptions_timer_t >( *this,
+					nearest > now ? nearest - now :
+							std::chrono::steady_clock::duration::zero(),
+					std::chrono::steady_clock::duration::zero() );
+		m_pending_subscriptions_timer_armed = true;
+		m_pending_subscriptions_timer_at = nearest;
+	}
+
+void
+a_transport_manager_t::drop_subscription_deadlines()
+	{
+		m_subscription_deadlines = impl::subscription_deadline_queue_t{};
+		m_subscription_retries.clear();
+		m_pending_subscriptions_timer.release();
+		m_pending_subscriptions_timer_armed = false;
 	}
 
 void
@@ -600,9 +2639,82 @@ a_transport_manager_t::drop_subscription_statuses()
 void
 a_transport_manager_t::restore_subscriptions_on_reconnect()
 	{
-		for( auto & info : m_registered_subscriptions )
-			do_subscription_actions( info.first );
+		if( !m_session_present )
+			// The broker has lost all subscriptions.
+			m_session_subscriptions.clear();
+
+		std::vector< std::string > topic_names;
+		topic_names.reserve( m_registered_subscriptions.size() );
+		std::vector< std::string > held_topic_names;
+		for( const auto & info : m_registered_subscriptions )
+			{
+				if( m_subscription_minimization_enabled &&
+						!m_subscriptions_cover.is_root( info.first ) )
+					// Status of covered topic will be set by its root.
+					continue;
+
+				if( m_session_subscriptions.end() !=
+						m_session_subscriptions.find( info.first ) )
+					held_topic_names.push_back( info.first );
+				else
+					topic_names.push_back( info.first );
+			}
+
+		m_logger->info( "restoring subscriptions, to_subscribe={}, "
+				"held_by_session={}",
+				topic_names.size(), held_topic_names.size() );
+
+		// Subscriptions from the session are available immediately.
+		for( const auto & topic_name : held_topic_names )
+			{
+				auto it = m_registered_subscriptions.find( topic_name );
+				process_subscription_result( topic_name, it->second, qos_to_use );
+			}
+
+		if( !topic_names.empty() )
+			{
+				if( m_standby_mosq )
+					// Standby connection delivers messages until these
+					// subscriptions are restored.
+					m_subscriptions_to_restore.insert(
+							topic_names.begin(), topic_names.end() );
+
+				do_subscription_actions( topic_names );
+			}
 	}
 
-} /* namespace mosquitto_transport */
+void
+a_transport_manager_t::subscription_restored(
+	const std::string & topic_name )
+	{
+		if( m_subscriptions_to_restore.erase( topic_name ) &&
+				m_subscriptions_to_restore.empty() )
+			m_logger->info( "subscriptions restored, delivery via standby "
+					"connection stopped" );
+	}
+
+void
+a_transport_manager_t::restore_unsubscriptions_on_reconnect()
+	{
+		// The broker could hold subscriptions from the previous connection
+		// only if clean_session is false.
+		if( !m_connection_params.m_clean_session )
+			{
+				for( const auto & topic_name : m_delayed_unsubscriptions )
+					{
+						m_logger->info( "topic unsubscription, topic={}", topic_name );
+
+						auto r = mosquitto_unsubscribe( m_mosq.get(), 0,
+								topic_name.c_str() );
+						if( r != MOSQ_ERR_SUCCESS )
+							m_logger->warn( "mosquitto_unsubscribe failed, "
+									"topic={}, rc={}",
+									topic_name, r );
+					}
+				io_wakeup();
+			}
+
+		m_delayed_unsubscriptions.clear();
+	}
 
+} /* namespace mosquitto_transport */
@@ -11,9 +11,18 @@
 
 #include <mosquitto_transport/initializer.hpp>
 #include <mosquitto_transport/pub.hpp>
+#include <mosquitto_transport/rpc.hpp>
 #include <mosquitto_transport/connection_params.hpp>
+#include <mosquitto_transport/io_dispatcher.hpp>
 
 #include <mosquitto_transport/impl/subscriptions_map.hpp>
+#include <mosquitto_transport/impl/subscriptions_cover.hpp>
+#include <mosquitto_transport/impl/recent_messages.hpp>
+#include <mosquitto_transport/impl/correlation_table.hpp>
+#include <mosquitto_transport/impl/payload_filter_results.hpp>
+#include <mosquitto_transport/impl/resolve_host.hpp>
+#include <mosquitto_transport/impl/subscription_batch.hpp>
+#include <mosquitto_transport/impl/subscription_deadlines.hpp>
 
 #include <mosquitto.h>
 
@@ -23,7 +32,14 @@
 
 #include <boost/container/flat_set.hpp>
 
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <set>
+#include <thread>
+#include <unordered_map>
 
 namespace mosquitto_transport {
 
@@ -49,6 +65,20 @@ enum class subscription_status_t
 		failed
 	};
 
+//
+// postmans_snapshot_t
+//
+/*!
+ * \brief Immutable copy of postmans of a subscription.
+ *
+ * Is used for parallel delivery of a message.
+ *
+ * \since
+ * v.0.7.0
+ */
+using postmans_snapshot_t =
+		std::shared_ptr< const std::vector< postman_shared_ptr_t > >;
+
 //
 // subscription_info_t
 //
@@ -60,6 +90,16 @@ class subscription_info_t
 		subscription_status_t
 		status() const;
 
+		//! Description of subscription failure.
+		/*!
+		 * Is empty if status() != subscription_status_t::failed.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		const std::string &
+		failure_description() const;
+
 		void
 		subscription_created(
 			const std::string & topic_name );
@@ -84,15 +124,51 @@ class subscription_info_t
 		void
 		remove_postman( const postman_shared_ptr_t & postman );
 
-		void
+		/*!
+		 * \note Since v.0.7.0 \a info is passed to postmans.
+		 * Since v.0.7.0 returns count of postmans which rejected
+		 * the message by their payload filters. \a filter_results are
+		 * shared by all subscriptions matched by the message.
+		 */
+		std::size_t
 		deliver_message(
 			const std::string & topic,
-			const std::string & payload );
+			const std::string & payload,
+			const delivery_info_t & info,
+			impl::payload_filter_results_t & filter_results );
+
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		std::size_t
+		postmans_count() const;
+
+		//! Get the copy of the current set of postmans.
+		/*!
+		 * \note Can be called from several threads at the same time.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		postmans_snapshot_t
+		postmans_snapshot();
 
 	private :
 		bcnt::flat_set< postman_shared_ptr_t > m_postmans;
 		subscription_status_t m_status;
 
+		/*!
+		 * \brief Copy of m_postmans for parallel delivery.
+		 *
+		 * Is created on demand and is dropped when m_postmans is changed.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		postmans_snapshot_t m_snapshot;
+		std::mutex m_snapshot_lock;
+
 		/*!
 		 * \note Has value only if m_status == subscription_status_t::failed.
 		 *
@@ -113,10 +189,37 @@ using delivery_map_t = impl::subscriptions_map_t< subscription_info_t * >;
 //
 // pending_subscription_t
 //
+/*!
+ * \brief Info about one SUBSCRIBE packet waiting for SUBACK.
+ *
+ * \note Since v.0.7.0 one packet can contain several topic filters.
+ */
 struct pending_subscription_t
 	{
-		std::string m_topic_name;
+		std::vector< std::string > m_topic_names;
 		std::chrono::steady_clock::time_point m_initiated_at;
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		std::chrono::steady_clock::time_point m_deadline;
+	};
+
+//
+// subscription_retry_t
+//
+/*!
+ * \brief State of repeated subscription attempts for a topic.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct subscription_retry_t
+	{
+		//! Count of attempts already scheduled.
+		unsigned int m_attempts{};
+		//! Time of the next attempt.
+		std::chrono::steady_clock::time_point m_retry_at;
 	};
 
 //
@@ -140,20 +243,544 @@ struct subscription_result_t : public so_5::message_t
 //
 struct message_received_t : public so_5::message_t
 	{
-		const std::string m_topic;
-		const std::string m_payload;
+		//! Topic name and payload.
+		/*!
+		 * Are shared with incoming messages for all subscribers.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		const message_body_shared_ptr_t m_body;
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		const delivery_ticket_t m_ticket;
+		//! Time of receiving from the broker.
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		const std::chrono::steady_clock::time_point m_received_at;
 
 		message_received_t(
-			const mosquitto_message & mosq_msg )
-			:	m_topic( mosq_msg.topic )
-			,	m_payload(
-					reinterpret_cast< const char * >(mosq_msg.payload),
-					static_cast< std::size_t >(mosq_msg.payloadlen) )
+			const mosquitto_message & mosq_msg,
+			delivery_ticket_t ticket = delivery_ticket_t{} )
+			:	m_body{ std::make_shared< const message_body_t >(
+					std::string{ mosq_msg.topic },
+					std::string{
+						reinterpret_cast< const char * >(mosq_msg.payload),
+						static_cast< std::size_t >(mosq_msg.payloadlen) } ) }
+			,	m_ticket{ std::move(ticket) }
+			,	m_received_at{ std::chrono::steady_clock::now() }
+			{}
+	};
+
+//
+// local_message_t
+//
+/*!
+ * \brief Locally published message to be delivered by a not thread-safe
+ * event when parallel delivery is turned on.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct local_message_t : public so_5::message_t
+	{
+		const message_body_shared_ptr_t m_body;
+
+		local_message_t( message_body_shared_ptr_t body )
+			:	m_body{ std::move(body) }
 			{}
 	};
 
+//
+// fan_out_message_t
+//
+/*!
+ * \brief Incoming message shared between chunks of parallel delivery.
+ *
+ * Topic name and payload are in m_info.m_body.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct fan_out_message_t
+	{
+		const delivery_info_t m_info;
+	};
+
+//
+// fan_out_chunk_t
+//
+/*!
+ * \brief Range of postmans to be served by a separate event.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct fan_out_chunk_t
+	{
+		postmans_snapshot_t m_postmans;
+		//! Range of postmans to be served.
+		std::size_t m_first;
+		std::size_t m_last;
+		std::shared_ptr< const fan_out_message_t > m_msg;
+	};
+
+//
+// fan_out_slot_t
+//
+/*!
+ * \brief Queue of chunks which must be served one after another.
+ *
+ * Chunks with the same index are always placed into the same slot.
+ * Only one event serves a slot at any moment, so postmans of a chunk
+ * receive messages in the order of their placement into the slot.
+ * Different slots are served in parallel.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct fan_out_slot_t
+	{
+		std::mutex m_lock;
+		std::queue< fan_out_chunk_t > m_chunks;
+		//! Is there an event which serves this slot?
+		bool m_busy{ false };
+	};
+
+//
+// standby_message_received_t
+//
+/*!
+ * \brief Message received via standby connection.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct standby_message_received_t : public message_received_t
+	{
+		using message_received_t::message_received_t;
+	};
+
+//
+// standby_subscription_result_t
+//
+/*!
+ * \brief SUBACK received via standby connection.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct standby_subscription_result_t : public subscription_result_t
+	{
+		using subscription_result_t::subscription_result_t;
+	};
+
+//
+// conflated_topic_t
+//
+/*!
+ * \brief State of a topic in publish conflation mode.
+ *
+ * The state exists only during min interval after the last publish.
+ * There always is a flush scheduled for the end of this interval.
+ * If the flush finds no pending message the state is removed.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct conflated_topic_t
+	{
+		//! Min interval between publishes for the topic.
+		std::chrono::steady_clock::duration m_min_interval;
+		//! Is there a message waiting for publish?
+		bool m_pending{ false };
+		//! The latest message waiting for publish.
+		std::string m_payload;
+		//! Was the latest message delivered to local subscribers?
+		/*!
+		 * If it is true then the copy received back from the broker
+		 * must be dropped.
+		 */
+		bool m_delivered_locally{ false };
+	};
+
+//
+// backlog_t
+//
+/*!
+ * \brief Accounting of incoming messages which are not handled yet.
+ *
+ * Every incoming message gets a delivery ticket. The ticket is held by
+ * the message in transport manager's queue and by all its copies in
+ * subscribers' queues. The message is removed from the backlog when the
+ * last holder of the ticket is destroyed.
+ *
+ * Pause handler is called with true when the backlog reaches the high
+ * watermark and with false when it drops below the low watermark.
+ *
+ * \since
+ * v.0.7.0
+ */
+class backlog_t : public std::enable_shared_from_this< backlog_t >
+	{
+	public :
+		using pause_handler_t = std::function< void(bool) >;
+
+		backlog_t(
+			std::size_t high_watermark_messages,
+			std::size_t high_watermark_bytes,
+			std::size_t low_watermark_messages,
+			std::size_t low_watermark_bytes,
+			std::shared_ptr< stats_counters_t > stats );
+
+		//! Set the pause handler.
+		/*!
+		 * If the backlog is already over the high watermark the handler
+		 * is called immediately.
+		 */
+		void
+		set_pause_handler( pause_handler_t handler );
+
+		//! Add a message to the backlog.
+		delivery_ticket_t
+		acquire( std::size_t bytes );
+
+	private :
+		struct ticket_t;
+
+		const std::size_t m_high_watermark_messages;
+		const std::size_t m_high_watermark_bytes;
+		const std::size_t m_low_watermark_messages;
+		const std::size_t m_low_watermark_bytes;
+		const std::shared_ptr< stats_counters_t > m_stats;
+
+		std::mutex m_lock;
+		std::size_t m_messages{};
+		std::size_t m_bytes{};
+		bool m_paused{ false };
+		pause_handler_t m_pause_handler;
+
+		void
+		release( std::size_t bytes );
+	};
+
+//
+// rpc_postman_t
+//
+/*!
+ * \brief Postman for replies to calls made via transport manager.
+ *
+ * Holds the table of pending calls. All replies are received via
+ * one subscription to '<reply_topic_prefix>/+'. The last level of
+ * reply topic is the call ID.
+ *
+ * \note Calls are started and replies are received in thread-safe event
+ * handlers of transport manager. Because of that the table of pending
+ * calls is protected by a mutex.
+ *
+ * \since
+ * v.0.7.0
+ */
+class rpc_postman_t : public postman_t
+	{
+	public :
+		rpc_postman_t(
+			std::string reply_topic_prefix,
+			std::chrono::steady_clock::duration timeout_resolution,
+			std::size_t timer_wheel_slots,
+			std::shared_ptr< spdlog::logger > logger,
+			std::shared_ptr< stats_counters_t > stats );
+
+		//! Topic filter for subscription to replies.
+		std::string
+		reply_topic_filter() const;
+
+		//! Register a new call.
+		/*!
+		 * Returns false if call is failed immediately. Otherwise
+		 * \a request_topic receives the topic for request publishing.
+		 */
+		bool
+		start_call(
+			const rpc_call_t & cmd,
+			std::string & request_topic );
+
+		//! Fail all calls with elapsed timeouts.
+		void
+		expire_calls( std::chrono::steady_clock::time_point now );
+
+		//! Get the time when expire_calls() should be called.
+		/*!
+		 * Returns false if there are no pending calls.
+		 */
+		bool
+		next_expiration( std::chrono::steady_clock::time_point & at );
+
+		virtual void
+		subscription_available( const std::string & topic_name ) override;
+
+		virtual void
+		subscription_unavailable( const std::string & topic_name ) override;
+
+		virtual void
+		post( std::string topic_name, std::string payload ) override;
+
+		virtual void
+		subscription_failed(
+			const std::string & topic_name,
+			const std::string & description ) override;
+
+	private :
+		const std::string m_reply_topic_prefix;
+		const std::shared_ptr< spdlog::logger > m_logger;
+		const std::shared_ptr< stats_counters_t > m_stats;
+
+		std::mutex m_lock;
+
+		//! Can replies be received?
+		bool m_replies_available{ false };
+
+		impl::correlation_table_t< rpc_completion_shared_ptr_t > m_calls;
+
+		void
+		fail_all_calls( const std::string & description );
+	};
+
 } /* namespace details */
 
+//
+// subscribe_batching_params_t
+//
+/*!
+ * \brief Limits for SUBSCRIBE packets with several topic filters.
+ *
+ * Several topic filters are packed into one SUBSCRIBE packet when
+ * subscriptions are restored after reconnection.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct subscribe_batching_params_t
+	{
+		//! Max count of topic filters in one SUBSCRIBE packet.
+		std::size_t m_max_filters{ 1024u };
+		//! Max size of topic filters in one SUBSCRIBE packet.
+		std::size_t m_max_bytes{ 64u * 1024u };
+	};
+
+//
+// subscription_coalescing_params_t
+//
+/*!
+ * \brief Parameters for coalescing of new subscriptions.
+ *
+ * New subscriptions are collected during m_window (or until
+ * m_max_topics subscriptions are collected) and then sent to the broker
+ * in SUBSCRIBE packets with several topic filters
+ * (see subscribe_batching_params_t).
+ *
+ * \since
+ * v.0.7.0
+ */
+struct subscription_coalescing_params_t
+	{
+		//! Time for collecting new subscriptions.
+		std::chrono::steady_clock::duration m_window{
+				std::chrono::milliseconds{20} };
+		//! Max count of collected subscriptions.
+		std::size_t m_max_topics{ 1024u };
+	};
+
+//
+// subscription_retry_params_t
+//
+/*!
+ * \brief Parameters for repeated attempts of failed subscriptions.
+ *
+ * A subscription which is rejected by the broker or not acknowledged
+ * during subscription timeout is repeated after a delay. The delay
+ * starts from m_initial_delay and is multiplied by m_multiplier after
+ * every attempt (but doesn't exceed m_max_delay). Every delay is randomly
+ * changed by up to m_jitter fraction of it, so subscriptions of many
+ * clients are not repeated at the same moment.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct subscription_retry_params_t
+	{
+		//! Delay before the first repeated attempt.
+		std::chrono::steady_clock::duration m_initial_delay{
+				std::chrono::seconds{1} };
+		//! Max delay between attempts.
+		std::chrono::steady_clock::duration m_max_delay{
+				std::chrono::seconds{60} };
+		//! Multiplier for the delay after every attempt.
+		double m_multiplier{ 2.0 };
+		//! Max random deviation of the delay (as a fraction of it).
+		double m_jitter{ 0.2 };
+		//! Max count of repeated attempts. 0 means no limit.
+		unsigned int m_max_attempts{ 0u };
+	};
+
+//
+// standby_params_t
+//
+/*!
+ * \brief Parameters for hot-standby connection.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct standby_params_t
+	{
+		//! Standby broker.
+		broker_endpoint_t m_broker;
+		//! Suffix for client ID of standby connection.
+		/*!
+		 * Client ID of standby connection must differ from the client ID
+		 * of the main connection if brokers share sessions.
+		 */
+		std::string m_client_id_suffix{ "-standby" };
+		//! Time window for detection of duplicates at the moment of
+		//! switching between connections.
+		std::chrono::steady_clock::duration m_dedup_window{
+				std::chrono::seconds{1} };
+		//! Max count of messages in deduplication window.
+		std::size_t m_dedup_max_messages{ 16u * 1024u };
+	};
+
+//
+// local_delivery_policy_t
+//
+/*!
+ * \brief What to do with a message published to a topic which has
+ * local subscribers.
+ *
+ * \since
+ * v.0.7.0
+ */
+enum class local_delivery_policy_t
+	{
+		//! Message is delivered to local subscribers and is published to
+		//! the broker too. The copy of the message received back from
+		//! the broker is dropped.
+		/*!
+		 * \note If there is no connection to the broker the message is
+		 * delivered to local subscribers only. It isn't published later.
+		 * Such messages are counted in
+		 * transport_stats_t::m_unpublished_messages.
+		 */
+		publish_to_broker,
+		//! Message is delivered to local subscribers only.
+		//! Subscribers in other processes will not receive it.
+		skip_broker
+	};
+
+//
+// local_delivery_params_t
+//
+/*!
+ * \brief Parameters for local delivery of published messages.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct local_delivery_params_t
+	{
+		//! What to do with the broker publish.
+		local_delivery_policy_t m_policy{
+				local_delivery_policy_t::publish_to_broker };
+		//! Time window for dropping of messages received back from
+		//! the broker.
+		std::chrono::steady_clock::duration m_echo_window{
+				std::chrono::seconds{5} };
+		//! Max count of messages in echo window.
+		std::size_t m_echo_max_messages{ 16u * 1024u };
+	};
+
+//
+// backpressure_params_t
+//
+/*!
+ * \brief Watermarks for backlog of incoming messages.
+ *
+ * Backlog includes messages in transport manager's queue and in
+ * queues of subscribers.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct backpressure_params_t
+	{
+		//! Reading is paused when count of messages reaches this value.
+		std::size_t m_high_watermark_messages{ 100u * 1000u };
+		//! Reading is paused when total size of payloads reaches this value.
+		std::size_t m_high_watermark_bytes{ 64u * 1024u * 1024u };
+		//! Reading is resumed when count of messages and total size of
+		//! payloads drop to these values.
+		std::size_t m_low_watermark_messages{ 50u * 1000u };
+		std::size_t m_low_watermark_bytes{ 32u * 1024u * 1024u };
+	};
+
+//
+// fan_out_params_t
+//
+/*!
+ * \brief Parameters for parallel delivery of incoming messages to
+ * subscriptions with many postmans.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct fan_out_params_t
+	{
+		//! Delivery is made in parallel if count of postmans of one
+		//! topic filter exceeds this value.
+		std::size_t m_threshold{ 1024u };
+		//! Count of postmans served by one event of transport manager.
+		std::size_t m_chunk_size{ 256u };
+		//! Max count of chunks of different messages served in parallel.
+		/*!
+		 * Chunks with the same index are served one after another.
+		 */
+		std::size_t m_slots{ 8u };
+	};
+
+//
+// rpc_params_t
+//
+/*!
+ * \brief Parameters for calls made via transport manager.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct rpc_params_t
+	{
+		//! Prefix of topics for replies.
+		/*!
+		 * If empty then 'rpc-replies/<client_id>' is used.
+		 *
+		 * \attention This prefix must be unique for every client.
+		 */
+		std::string m_reply_topic_prefix;
+		//! Resolution of call timeouts.
+		/*!
+		 * Timeouts are checked by a single-shot timer for the earliest
+		 * deadline of pending calls. This is the minimal interval between
+		 * two consecutive checks.
+		 */
+		std::chrono::steady_clock::duration m_timeout_resolution{
+				std::chrono::milliseconds{50} };
+		//! Count of slots in the timer wheel for call timeouts.
+		std::size_t m_timer_wheel_slots{ 1024u };
+	};
+
 //
 // a_transport_manager_t
 //
@@ -212,13 +839,330 @@ class a_transport_manager_t : public so_5::agent_t
 		set_subscription_timeout(
 			std::chrono::steady_clock::duration timeout );
 
-	private :
-		struct connected_t : public so_5::signal_t {};
-		struct disconnected_t : public so_5::signal_t {};
-		struct pending_subscriptions_timer_t : public so_5::signal_t {};
+		//! Set I/O dispatcher to be used for serving connection to broker.
+		/*!
+		 * By default transport manager starts a separate thread for
+		 * its connection (via mosquitto_loop_start). If an I/O dispatcher
+		 * is set then all I/O operations will be performed on the context
+		 * of I/O dispatcher's threads. One I/O dispatcher can be shared
+		 * between many transport managers.
+		 *
+		 * \note This method must be called before agent will be registered.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		void
+		set_io_dispatcher( io_dispatcher_handle_t io_dispatcher );
 
-		using subscription_info_map_t =
-				std::map< std::string, details::subscription_info_t >;
+		//! Turn publish conflation on for topics matching \a topic_filter.
+		/*!
+		 * Messages for every such topic are published to the broker no more
+		 * often than once per \a min_interval. If several messages are
+		 * published during the interval only the latest of them is sent
+		 * to the broker at the end of the interval.
+		 *
+		 * Can be called several times for different topic filters. If
+		 * a topic matches several filters the smallest interval is used.
+		 *
+		 * \note Local delivery (see set_local_delivery()) is not conflated.
+		 *
+		 * \note This method must be called before agent will be registered.
+		 *
+		 * \throw ex_t if \a min_interval is not positive.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		void
+		set_publish_conflation(
+			const std::string & topic_filter,
+			std::chrono::steady_clock::duration min_interval );
+
+		//! Set limits for SUBSCRIBE packets with several topic filters.
+		/*!
+		 * \note This method must be called before agent will be registered.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		void
+		set_subscribe_batching( subscribe_batching_params_t params );
+
+		//! Turn coalescing of new subscriptions on.
+		/*!
+		 * \note This method must be called before agent will be registered.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		void
+		set_subscription_coalescing( subscription_coalescing_params_t params );
+
+		//! Turn minimization of broker-side subscriptions on.
+		/*!
+		 * If a registered topic filter is covered by another registered
+		 * topic filter (like `plant/1/line3/temp` is covered by
+		 * `plant/1/line3/#`) then only the wider filter is subscribed on
+		 * the broker. Messages for the narrower filter are routed locally.
+		 *
+		 * Only registered topic filters are subscribed on the broker, so
+		 * the broker doesn't send messages which nobody needs.
+		 *
+		 * \note This method must be called before agent will be registered.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		void
+		enable_subscription_minimization();
+
+		//! Turn repeated attempts of failed subscriptions on.
+		/*!
+		 * Postmans are informed about every failure. Subscription is
+		 * repeated after that. A failure notification can be received
+		 * several times and then subscription_available_t can be received.
+		 *
+		 * \note This method must be called before agent will be registered.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		void
+		set_subscription_retry( subscription_retry_params_t params );
+
+		//! Set linger period for topics without subscribers.
+		/*!
+		 * When the last subscriber of a topic filter is removed the topic
+		 * filter stays subscribed on the broker during \a linger.
+		 * Messages for it are dropped. A new subscriber which appears during
+		 * that period reuses the existing subscription without any
+		 * interaction with the broker.
+		 *
+		 * Linger period is zero by default (topic filter is unsubscribed
+		 * immediately).
+		 *
+		 * \note This method must be called before agent will be registered.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		void
+		set_unsubscription_linger( std::chrono::steady_clock::duration linger );
+
+		//! Turn hot-standby connection on.
+		/*!
+		 * Transport manager keeps a second connection to the standby broker.
+		 * All registered topic filters are subscribed via this connection
+		 * too, but messages received via it are dropped while the main
+		 * connection is alive. When the main connection is lost messages from
+		 * the standby connection are delivered to subscribers. Messages
+		 * which were already delivered via another connection are dropped
+		 * at the moment of switching.
+		 *
+		 * After reconnection of the main connection messages from
+		 * the standby connection are delivered until all restored
+		 * subscriptions are acknowledged by the main broker.
+		 *
+		 * Standby connection is ready for failover when all registered
+		 * topic filters are acknowledged by the standby broker. Readiness
+		 * is available via transport_stats_t::m_standby_ready.
+		 *
+		 * \note Shared subscriptions (`$share/...`) are not subscribed
+		 * via the standby connection: the standby broker would add
+		 * the client to the group as another member. Messages for them
+		 * are not delivered during failover.
+		 *
+		 * \note Subscription statuses and publishing still depend on
+		 * the main connection only.
+		 *
+		 * \note This method must be called before agent will be registered.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		void
+		set_standby_broker( standby_params_t params );
+
+		//! Turn local delivery of published messages on.
+		/*!
+		 * A message published to a topic with local subscribers is
+		 * delivered to them immediately, without a round-trip through
+		 * the broker. Local delivery works even if there is no connection
+		 * to the broker.
+		 *
+		 * If the message is also published to the broker the broker will
+		 * send it back. Such copies are detected by hashes of topic and
+		 * payload and are dropped.
+		 *
+		 * \note This method must be called before agent will be registered.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		void
+		set_local_delivery( local_delivery_params_t params );
+
+		//! Turn calls via rpc_client_t on.
+		/*!
+		 * Transport manager makes one subscription to
+		 * '<reply_topic_prefix>/+' for replies to all calls.
+		 * Calls are failed immediately if this subscription is not
+		 * available (for example if there is no connection to the broker).
+		 * All pending calls are failed when this subscription is lost.
+		 *
+		 * \note This method must be called before agent will be registered.
+		 *
+		 * \throw ex_t if reply topic prefix is not valid.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		void
+		set_rpc( rpc_params_t params );
+
+		//! Turn flow control for incoming messages on.
+		/*!
+		 * When the backlog of incoming messages reaches the high watermark
+		 * transport manager stops reading from the socket. Reading is
+		 * resumed when the backlog drops to the low watermark. TCP flow
+		 * control slows down the broker in the meantime.
+		 *
+		 * A message leaves the backlog when all its copies in subscribers'
+		 * queues are handled. Messages delivered by custom postmans which
+		 * don't override postman_t::post_tracked() leave the backlog
+		 * when they are posted.
+		 *
+		 * \attention Reading must not be paused for more than keepalive
+		 * interval, otherwise the connection will be closed.
+		 *
+		 * \attention Backpressure requires I/O dispatcher
+		 * (see set_io_dispatcher()). An exception is thrown at the start
+		 * of the agent if I/O dispatcher is not set.
+		 *
+		 * \note This method must be called before agent will be registered.
+		 *
+		 * \throw ex_t if watermarks are not valid.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		void
+		set_backpressure( backpressure_params_t params );
+
+		//! Turn parallel delivery of incoming messages on.
+		/*!
+		 * If a topic filter has more than fan_out_params_t::m_threshold
+		 * postmans the list of postmans is split into chunks of
+		 * fan_out_params_t::m_chunk_size. The first chunk is served
+		 * immediately. Other chunks are placed into
+		 * fan_out_params_t::m_slots slots by their indexes and are served
+		 * by thread-safe event handlers.
+		 *
+		 * Every postman receives messages in the order of receiving
+		 * from the broker while the set of postmans of its topic filter
+		 * isn't changed. Because of that messages from the broker are
+		 * dispatched by not thread-safe event handler.
+		 *
+		 * \attention Chunks are served in parallel only if the agent is
+		 * bound to adv_thread_pool dispatcher.
+		 *
+		 * \note This method must be called before agent will be registered.
+		 *
+		 * \throw ex_t if fan_out_params_t::m_chunk_size or
+		 * fan_out_params_t::m_slots is zero.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		void
+		set_fan_out( fan_out_params_t params );
+
+		//! Get the current values of transport manager's counters.
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		transport_stats_t
+		stats() const;
+
+	private :
+		struct connected_t : public so_5::message_t
+			{
+				// Does the broker hold the session from the previous
+				// connection?
+				const bool m_session_present;
+
+				connected_t( bool session_present )
+					:	m_session_present{ session_present }
+					{}
+			};
+		struct disconnected_t : public so_5::signal_t {};
+		struct pending_subscriptions_timer_t : public so_5::signal_t {};
+		struct standby_connected_t : public so_5::signal_t {};
+		struct standby_disconnected_t : public so_5::signal_t {};
+		struct rpc_timer_t : public so_5::signal_t {};
+		struct endpoints_refresh_timer_t : public so_5::signal_t {};
+		struct flush_conflated_message_t : public so_5::message_t
+			{
+				const std::string m_topic_name;
+
+				flush_conflated_message_t( std::string topic_name )
+					:	m_topic_name{ std::move(topic_name) }
+					{}
+			};
+		struct serve_fan_out_slot_t : public so_5::message_t
+			{
+				const std::size_t m_slot;
+
+				serve_fan_out_slot_t( std::size_t slot )
+					:	m_slot{ slot }
+					{}
+			};
+		struct flush_new_subscriptions_t : public so_5::message_t
+			{
+				// ID of the batch for which the flush is scheduled.
+				const std::uint64_t m_batch_id;
+
+				flush_new_subscriptions_t( std::uint64_t batch_id )
+					:	m_batch_id{ batch_id }
+					{}
+			};
+		struct linger_expired_t : public so_5::message_t
+			{
+				const std::string m_topic_name;
+				const std::chrono::steady_clock::time_point m_expires_at;
+
+				linger_expired_t(
+					std::string topic_name,
+					std::chrono::steady_clock::time_point expires_at )
+					:	m_topic_name{ std::move(topic_name) }
+					,	m_expires_at{ expires_at }
+					{}
+			};
+		struct endpoints_resolved_t : public so_5::message_t
+			{
+				// The main broker and fallback brokers.
+				const std::vector< broker_endpoint_t > m_endpoints;
+				// Is meaningful only if hot-standby is used.
+				const broker_endpoint_t m_standby;
+
+				// Is it the resolution at the start?
+				// Otherwise addresses are resolved again.
+				const bool m_initial;
+
+				endpoints_resolved_t(
+					std::vector< broker_endpoint_t > endpoints,
+					broker_endpoint_t standby,
+					bool initial )
+					:	m_endpoints{ std::move(endpoints) }
+					,	m_standby{ std::move(standby) }
+					,	m_initial{ initial }
+					{}
+			};
+
+		using subscription_info_map_t =
+				std::map< std::string, details::subscription_info_t >;
 
 		using mid_to_topic_map_t =
 				std::map< int, details::pending_subscription_t >;
@@ -234,6 +1178,51 @@ class a_transport_manager_t : public so_5::agent_t
 
 		details::mosquitto_unique_ptr_t m_mosq;
 
+		// I/O dispatcher for serving the connection.
+		// Is empty if mosquitto_loop_start is used.
+		io_dispatcher_handle_t m_io_dispatcher;
+
+		// ID of the connection in I/O dispatcher.
+		io_dispatcher_t::connection_id_t m_io_connection_id{};
+
+		// The main broker and fallback brokers with resolved addresses.
+		std::vector< broker_endpoint_t > m_broker_endpoints;
+
+		// Link with the thread for resolution of brokers' addresses.
+		// Is empty if there is no resolution in progress.
+		std::shared_ptr< impl::resolution_slot_t > m_resolution;
+
+		// Start time of the last resolution of brokers' addresses.
+		std::chrono::steady_clock::time_point m_endpoints_refresh_started_at;
+
+		// Timer for resolution of addresses while there is no connection.
+		so_5::timer_id_t m_endpoints_refresh_timer;
+
+		// Were connections to the brokers initiated?
+		bool m_io_started{ false };
+
+		// Was there a connection to the broker?
+		// Time of the last disconnection is meaningful only if it is true.
+		bool m_was_connected{ false };
+		std::chrono::steady_clock::time_point m_disconnected_at;
+
+		// Counters to be exposed via stats().
+		const std::shared_ptr< details::stats_counters_t > m_stats;
+
+		// Topic filters for publish conflation and min intervals
+		// between publishes.
+		// Is not changed after agent registration.
+		bool m_publish_conflation_enabled{ false };
+		impl::subscriptions_map_t< std::chrono::steady_clock::duration >
+				m_publish_conflation_filters;
+
+		// States of conflated topics published during the last min interval.
+		// Protected by m_conflated_topics_lock because on_publish_message
+		// is a thread-safe event handler.
+		std::mutex m_conflated_topics_lock;
+		std::unordered_map< std::string, details::conflated_topic_t >
+				m_conflated_topics;
+
 		state_t st_working{ this, "working" };
 		state_t st_disconnected{
 				initial_substate_of{ st_working }, "disconnected" };
@@ -247,16 +1236,151 @@ class a_transport_manager_t : public so_5::agent_t
 		// Map of topic filters to be used for incoming message delivery.
 		details::delivery_map_t m_delivery_map;
 
+		// Registered subscription for every topic filter of m_delivery_map.
+		// MQTT 3.1.1 doesn't tell which subscription produced a message.
+		// Because of that '$share/g/a' and 'a' (or '$share/h/a') can't
+		// be used at the same time.
+		std::unordered_map< std::string, std::string > m_delivery_filters;
+
 		// Info about pending subscriptions.
 		mid_to_topic_map_t m_pending_subscriptions;
 
-		// Timer for checking pending subscriptions.
+		// Deadlines for pending subscriptions and repeated attempts.
+		impl::subscription_deadline_queue_t m_subscription_deadlines;
+
+		// Single-shot timer for the nearest deadline.
+		// It is armed only if there are deadlines.
 		so_5::timer_id_t m_pending_subscriptions_timer;
 
+		// Deadline for which m_pending_subscriptions_timer is armed.
+		// m_pending_subscriptions_timer_at is meaningful only if
+		// m_pending_subscriptions_timer_armed is true.
+		bool m_pending_subscriptions_timer_armed{ false };
+		std::chrono::steady_clock::time_point m_pending_subscriptions_timer_at;
+
+		// Are repeated attempts of failed subscriptions turned on?
+		bool m_subscription_retry_enabled{ false };
+		subscription_retry_params_t m_subscription_retry;
+
+		// Failed topics waiting for the next subscription attempt.
+		std::map< std::string, details::subscription_retry_t >
+				m_subscription_retries;
+
+		// Generator for jitter of retry delays.
+		std::mt19937 m_random_engine{ std::random_device{}() };
+
+		// Linger period for topics without subscribers.
+		std::chrono::steady_clock::duration m_unsubscription_linger{};
+
+		// Topics without subscribers and expiration times of
+		// their linger periods.
+		std::map< std::string, std::chrono::steady_clock::time_point >
+				m_lingering_subscriptions;
+
+		// Parameters of hot-standby connection.
+		standby_params_t m_standby;
+
+		// Standby connection. Is empty if hot-standby is not used.
+		details::mosquitto_unique_ptr_t m_standby_mosq;
+
+		// ID of standby connection in I/O dispatcher.
+		io_dispatcher_t::connection_id_t m_standby_io_connection_id{};
+
+		// Is standby connection established?
+		bool m_standby_connected{ false };
+
+		// SUBSCRIBE packets sent via standby connection and waiting
+		// for SUBACK. Key is mid of the packet.
+		std::map< int, std::vector< std::string > >
+				m_standby_pending_subscriptions;
+
+		// Topic filters acknowledged by the standby broker.
+		std::set< std::string > m_standby_subscribed;
+
+		// Count of registered shared subscriptions. They are not
+		// subscribed via standby connection.
+		std::size_t m_shared_subscriptions_count{ 0u };
+
+		// Topic filters subscribed after reconnection and waiting for
+		// SUBACK. Messages from standby connection are delivered until
+		// this set becomes empty. Is used only if hot-standby is used.
+		std::set< std::string > m_subscriptions_to_restore;
+
+		// Is standby connection ready for failover?
+		bool m_standby_ready{ false };
+
+		// Is local delivery of published messages turned on?
+		bool m_local_delivery_enabled{ false };
+		local_delivery_params_t m_local_delivery;
+
+		// Backlog of incoming messages.
+		// Is empty if backpressure is not used.
+		std::shared_ptr< details::backlog_t > m_backlog;
+
+		// Is parallel delivery of incoming messages turned on?
+		bool m_fan_out_enabled{ false };
+		fan_out_params_t m_fan_out;
+		// Slots for chunks of parallel delivery.
+		// The vector isn't changed after agent registration.
+		std::vector< std::unique_ptr< details::fan_out_slot_t > > m_fan_out_slots;
+
+		// Postman for replies to calls.
+		// Is empty if calls via rpc_client_t are not used.
+		std::shared_ptr< details::rpc_postman_t > m_rpc_postman;
+
+		// Single-shot timer for the earliest deadline of pending calls.
+		// Is active only while there are pending calls.
+		// Protected by m_rpc_timer_lock because on_rpc_call and on_rpc_timer
+		// are thread-safe event handlers.
+		std::chrono::steady_clock::duration m_rpc_timeout_resolution{};
+		std::mutex m_rpc_timer_lock;
+		so_5::timer_id_t m_rpc_timer;
+		bool m_rpc_timer_armed{ false };
+		std::chrono::steady_clock::time_point m_rpc_timer_deadline;
+
+		// Recently delivered messages for deduplication.
+		// Protected by m_recent_messages_lock because on_message_received
+		// is a thread-safe event handler.
+		// Is empty if neither hot-standby nor local delivery with
+		// publishing to the broker is used.
+		std::mutex m_recent_messages_lock;
+		std::unique_ptr< impl::recent_messages_t > m_recent_messages;
+
 		// Time for subscription completion.
 		std::chrono::steady_clock::duration m_subscription_timeout{
 			std::chrono::seconds{60} };
 
+		// Limits for SUBSCRIBE packets with several topic filters.
+		subscribe_batching_params_t m_subscribe_batching;
+
+		// Topic filters which were unsubscribed when there was no
+		// connection to the broker. They must be unsubscribed after
+		// reconnection if clean_session is false.
+		std::set< std::string > m_delayed_unsubscriptions;
+
+		// Is the session of the current connection held by the broker
+		// from the previous connection?
+		bool m_session_present{ false };
+
+		// Topic filters acknowledged by the broker in the current session.
+		// They aren't subscribed again after reconnection if the session
+		// is present. Is used only if clean_session is false.
+		std::set< std::string > m_session_subscriptions;
+
+		// Is coalescing of new subscriptions turned on?
+		bool m_subscription_coalescing_enabled{ false };
+		subscription_coalescing_params_t m_subscription_coalescing;
+
+		// New subscriptions collected for sending to the broker.
+		impl::subscription_batch_t m_new_subscriptions;
+
+		// Is minimization of broker-side subscriptions turned on?
+		bool m_subscription_minimization_enabled{ false };
+
+		// Coverage of registered topic filters.
+		// Is used only if m_subscription_minimization_enabled is true.
+		impl::subscriptions_cover_t m_subscriptions_cover;
+
 		void
 		setup_mosq_callbacks();
 
@@ -286,6 +1410,32 @@ class a_transport_manager_t : public so_5::agent_t
 			void * this_object,
 			const mosquitto_message * msg );
 
+		static void
+		on_standby_connect_callback(
+			mosquitto *,
+			void * this_object,
+			int connect_result );
+
+		static void
+		on_standby_disconnect_callback(
+			mosquitto *,
+			void * this_object,
+			int disconnect_result );
+
+		static void
+		on_standby_subscribe_callback(
+			mosquitto *,
+			void * this_object,
+			int mid,
+			int qos_count,
+			const int * qos_items );
+
+		static void
+		on_standby_message_callback(
+			mosquitto *,
+			void * this_object,
+			const mosquitto_message * msg );
+
 		static void
 		on_log_callback(
 			mosquitto *,
@@ -293,8 +1443,51 @@ class a_transport_manager_t : public so_5::agent_t
 			int log_level,
 			const char * log_msg );
 
+		// Checks parameters and starts resolution of brokers' addresses.
+		void
+		start_io();
+
+		// Initiates connections to the brokers.
+		void
+		on_endpoints_resolved( const endpoints_resolved_t & cmd );
+
+		// The main broker and fallback brokers from connection params.
+		std::vector< broker_endpoint_t >
+		configured_endpoints() const;
+
+		// Starts resolution of brokers' addresses on a separate thread.
+		// Addresses from previous are used for host names which
+		// can't be resolved.
+		void
+		start_resolution(
+			std::vector< broker_endpoint_t > previous,
+			bool initial );
+
+		// Starts resolution of brokers' addresses if they are older
+		// than m_address_ttl.
+		void
+		refresh_endpoints_if_stale();
+
+		// Arms the timer for resolution of addresses while
+		// there is no connection.
 		void
-		on_connected();
+		arm_endpoints_refresh_timer();
+
+		void
+		on_endpoints_refresh_timer( mhood_t< endpoints_refresh_timer_t > );
+
+		void
+		start_standby_io( const broker_endpoint_t & broker );
+
+		void
+		stop_io();
+
+		// Informs I/O dispatcher about new outgoing data.
+		void
+		io_wakeup();
+
+		void
+		on_connected( const connected_t & cmd );
 
 		void
 		on_disconnected();
@@ -305,6 +1498,34 @@ class a_transport_manager_t : public so_5::agent_t
 		void
 		on_unsubscribe_topic( const unsubscribe_topic_t & cmd );
 
+		void
+		on_subscribe_topics( const subscribe_topics_t & cmd );
+
+		void
+		on_unsubscribe_topics( const unsubscribe_topics_t & cmd );
+
+		// Registers postman for a topic. Topics to be subscribed and
+		// unsubscribed on the broker are added to actions.
+		void
+		add_topic_postman(
+			const std::string & topic_name,
+			const postman_shared_ptr_t & postman,
+			impl::subscriptions_cover_t::actions_t & actions );
+
+		void
+		remove_topic_postman(
+			const std::string & topic_name,
+			const postman_shared_ptr_t & postman );
+
+		void
+		on_linger_expired( const linger_expired_t & cmd );
+
+		// Removes topic without subscribers from registered subscriptions
+		// and from the broker.
+		void
+		remove_subscription(
+			subscription_info_map_t::iterator ittopic );
+
 		void
 		on_subscription_result(
 			const details::subscription_result_t & cmd );
@@ -317,17 +1538,181 @@ class a_transport_manager_t : public so_5::agent_t
 		on_message_received(
 			const details::message_received_t & cmd );
 
+		void
+		on_flush_incoming_batch(
+			const details::flush_incoming_batch_t & cmd );
+
+		void
+		on_standby_connected();
+
+		void
+		on_standby_disconnected();
+
+		void
+		on_standby_subscription_result(
+			const details::standby_subscription_result_t & cmd );
+
+		// Checks that all registered topic filters are acknowledged
+		// by the standby broker.
+		void
+		update_standby_readiness();
+
+		void
+		on_standby_message_received(
+			const details::standby_message_received_t & cmd );
+
+		// Returns false if message is a duplicate.
+		bool
+		accept_message(
+			const details::message_received_t & cmd,
+			impl::message_source_t source );
+
+		void
+		standby_subscribe(
+			const std::vector< std::string > & topic_names );
+
+		void
+		standby_unsubscribe(
+			const std::string & topic_name );
+
+		void
+		deliver_message(
+			const details::message_received_t & cmd );
+
+		// Delivers a message to all matched subscriptions.
+		void
+		deliver_to_subscribers(
+			std::vector< details::delivery_map_t::match_t > & subscribers,
+			delivery_info_t info );
+
+		// Returns count of postmans which rejected the message
+		// by payload filters.
+		std::size_t
+		deliver_to_subscription(
+			details::subscription_info_t & subscription,
+			const delivery_info_t & info,
+			std::shared_ptr< const details::fan_out_message_t > & shared_msg,
+			impl::payload_filter_results_t & filter_results );
+
+		void
+		place_fan_out_chunk(
+			std::size_t slot,
+			details::fan_out_chunk_t chunk );
+
+		void
+		on_serve_fan_out_slot(
+			const serve_fan_out_slot_t & cmd );
+
 		void
 		on_publish_message(
 			const publish_message_t & cmd );
 
 		void
-		try_subscribe_topic(
+		on_publish_message_when_disconnected(
+			const publish_message_t & cmd );
+
+		// Returns true if message is held for publish later.
+		bool
+		conflate_message(
+			const publish_message_t & cmd,
+			bool delivered_locally );
+
+		void
+		on_flush_conflated_message(
+			const flush_conflated_message_t & cmd );
+
+		// Publish a message to the broker.
+		void
+		publish_to_broker(
+			const std::string & topic_name,
+			const std::string & payload );
+
+		// Returns true if there are local subscribers for the message.
+		bool
+		deliver_locally(
+			const publish_message_t & cmd );
+
+		void
+		on_local_message(
+			const details::local_message_t & cmd );
+
+		void
+		remember_local_delivery(
+			const std::string & topic_name,
+			const std::string & payload );
+
+		void
+		make_recent_messages();
+
+		void
+		start_rpc();
+
+		void
+		on_rpc_call(
+			const rpc_call_t & cmd );
+
+		void
+		on_rpc_timer(
+			mhood_t< rpc_timer_t > );
+
+		// Must be called with m_rpc_timer_lock acquired.
+		void
+		arm_rpc_timer(
+			std::chrono::steady_clock::time_point deadline,
+			std::chrono::steady_clock::duration min_delay );
+
+		void
+		on_flush_new_subscriptions(
+			const flush_new_subscriptions_t & cmd );
+
+		void
+		flush_new_subscriptions();
+
+		// Returns true if message is accepted by libmosquitto.
+		bool
+		do_publish(
+			const std::string & topic_name,
+			const std::string & payload );
+
+		void
+		try_subscribe_topics(
+			const std::vector< std::string > & topic_names );
+
+		void
+		do_unsubscription_actions(
 			const std::string & topic_name );
 
+		// Subscribes and unsubscribes topics on the broker.
+		void
+		do_broker_actions(
+			const impl::subscriptions_cover_t::actions_t & actions );
+
+		// Sets status of a covered topic filter according to
+		// the status of its root.
+		void
+		inherit_root_status(
+			const std::string & topic_name,
+			details::subscription_info_t & info,
+			const details::subscription_info_t & root_info );
+
+		// Sets statuses of all topic filters covered by the root.
+		void
+		propagate_root_status(
+			const std::string & root_name );
+
+		// Sends SUBSCRIBE packets for several topics.
+		// Topics are packed into packets with respect to
+		// m_subscribe_batching limits.
 		void
 		do_subscription_actions(
-			const std::string & topic_name );
+			const std::vector< std::string > & topic_names );
+
+		// Sends one SUBSCRIBE packet for topic_names[first, last).
+		void
+		send_subscribe_packet(
+			const std::vector< std::string > & topic_names,
+			std::size_t first,
+			std::size_t last );
 
 		void
 		process_subscription_result(
@@ -335,11 +1720,42 @@ class a_transport_manager_t : public so_5::agent_t
 			details::subscription_info_t & info,
 			int granted_qos );
 
+		// Marks all topics from the packet as failed.
+		void
+		subscription_timed_out(
+			const details::pending_subscription_t & pending );
+
+		// Schedules the next subscription attempt for failed topic.
+		void
+		schedule_subscription_retry(
+			const std::string & topic_name );
+
+		// Adds a new deadline and arms the timer if necessary.
+		void
+		add_subscription_deadline(
+			impl::subscription_deadline_t deadline );
+
+		// Arms the timer for the nearest deadline.
+		void
+		arm_pending_subscriptions_timer();
+
+		// Removes all deadlines and stops the timer.
+		void
+		drop_subscription_deadlines();
+
 		void
 		drop_subscription_statuses();
 
 		void
 		restore_subscriptions_on_reconnect();
+
+		// Topic is removed from m_subscriptions_to_restore after
+		// SUBACK or timeout.
+		void
+		subscription_restored( const std::string & topic_name );
+
+		void
+		restore_unsubscriptions_on_reconnect();
 	};
 
 } /* namespace mosquitto_transport */
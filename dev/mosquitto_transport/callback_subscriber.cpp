@@ -0,0 +1,98 @@
+/*
+ * mosquitto_transport-1.0
+ */
+
+/*!
+ * \file
+ * \brief Subscriptions with delivery of messages to callbacks.
+ * \since
+ * v.0.7.0
+ */
+
+#include <mosquitto_transport/callback_subscriber.hpp>
+
+namespace mosquitto_transport {
+
+namespace details {
+
+//
+// callback_postman_base_t
+//
+callback_postman_base_t::callback_postman_base_t(
+	const subscription_options_t & options,
+	std::shared_ptr< stats_counters_t > stats,
+	subscription_failure_handler_t on_failure )
+	:	m_selector{ options, std::move(stats) }
+	,	m_on_failure{ std::move(on_failure) }
+	{}
+
+void
+callback_postman_base_t::deactivate()
+	{
+		std::lock_guard< std::mutex > lock{ m_lock };
+		m_active = false;
+	}
+
+void
+callback_postman_base_t::subscription_available( const std::string & )
+	{
+		// There is no receiver for notifications.
+	}
+
+void
+callback_postman_base_t::subscription_unavailable( const std::string & )
+	{
+		// There is no receiver for notifications.
+	}
+
+void
+callback_postman_base_t::subscription_failed(
+	const std::string & topic_name,
+	const std::string & description )
+	{
+		if( !m_on_failure )
+			{
+				postman_t::subscription_failed( topic_name, description );
+				return;
+			}
+
+		std::lock_guard< std::mutex > lock{ m_lock };
+		if( m_active )
+			m_on_failure( topic_name, description );
+	}
+
+bool
+callback_postman_base_t::accept(
+	const std::string & topic_name,
+	const std::string & )
+	{
+		return m_selector.accept( topic_name );
+	}
+
+const payload_filter_t *
+callback_postman_base_t::payload_filter() const
+	{
+		return m_selector.payload_filter();
+	}
+
+void
+callback_postman_base_t::post( std::string topic_name, std::string payload )
+	{
+		deliver( topic_name, payload, delivery_info_t{} );
+	}
+
+void
+callback_postman_base_t::deliver(
+	const std::string & topic_name,
+	const std::string & payload,
+	const delivery_info_t & info )
+	{
+		// Ticket is not kept because the message is handled right now.
+		std::lock_guard< std::mutex > lock{ m_lock };
+		if( m_active )
+			call( topic_name, payload, info.m_topic_params );
+	}
+
+} /* namespace details */
+
+} /* namespace mosquitto_transport */
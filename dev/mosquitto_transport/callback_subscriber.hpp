@@ -0,0 +1,302 @@
+/*
+ * mosquitto_transport-1.0
+ */
+
+/*!
+ * \file
+ * \brief Subscriptions with delivery of messages to callbacks.
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <mosquitto_transport/pub.hpp>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace mosquitto_transport {
+
+//
+// incoming_message_view_t
+//
+/*!
+ * \brief Non-owning view of an incoming message.
+ *
+ * It is valid only during the call of a callback.
+ */
+template< typename DECODER_TAG >
+class incoming_message_view_t
+	{
+		const string_view_t m_topic_name;
+		const string_view_t m_payload;
+		const topic_params_t & m_topic_params;
+
+	public :
+		incoming_message_view_t(
+			string_view_t topic_name,
+			string_view_t payload,
+			const topic_params_t & topic_params )
+			:	m_topic_name{ topic_name }
+			,	m_payload{ payload }
+			,	m_topic_params( topic_params )
+			{}
+
+		string_view_t
+		topic_name() const { return m_topic_name; }
+
+		//! Count of wildcards in topic filter of the subscription.
+		std::size_t
+		topic_params_count() const { return m_topic_params.size(); }
+
+		//! Part of topic name matched by \a index-th wildcard of
+		//! topic filter.
+		/*!
+		 * \pre index < topic_params_count().
+		 */
+		string_view_t
+		topic_param( std::size_t index ) const
+			{
+				const auto & p = m_topic_params[ index ];
+				return string_view_t{ m_topic_name.data() + p.m_offset, p.m_size };
+			}
+
+		string_view_t
+		payload() const { return m_payload; }
+
+		template< typename MSG >
+		MSG decode() const
+			{
+				return decoder_t< DECODER_TAG, MSG >::decode(
+						m_payload.to_string() );
+			}
+	};
+
+//
+// subscription_failure_handler_t
+//
+/*!
+ * \brief Callback for a failure of subscription.
+ *
+ * Receives the topic filter and the description of the failure.
+ */
+using subscription_failure_handler_t = std::function<
+		void( const std::string & topic_name, const std::string & description ) >;
+
+namespace details {
+
+//
+// callback_postman_base_t
+//
+/*!
+ * \brief Part of callback postman which doesn't depend on callback type.
+ */
+class callback_postman_base_t : public postman_t
+	{
+	public :
+		callback_postman_base_t(
+			const subscription_options_t & options,
+			std::shared_ptr< stats_counters_t > stats,
+			subscription_failure_handler_t on_failure );
+
+		//! Stop calling of the callback.
+		/*!
+		 * When this method returns the callback is not running and will
+		 * not be called anymore.
+		 */
+		virtual void
+		deactivate() override;
+
+		virtual void
+		subscription_available( const std::string & topic_name ) override;
+
+		virtual void
+		subscription_unavailable( const std::string & topic_name ) override;
+
+		//! Call the failure handler.
+		/*!
+		 * An exception is thrown if there is no failure handler.
+		 * The handler is not called after deactivation.
+		 */
+		virtual void
+		subscription_failed(
+			const std::string & topic_name,
+			const std::string & description ) override;
+
+		virtual bool
+		accept(
+			const std::string & topic_name,
+			const std::string & payload ) override;
+
+		virtual const payload_filter_t *
+		payload_filter() const override;
+
+		virtual void
+		post( std::string topic_name, std::string payload ) override;
+
+		virtual void
+		deliver(
+			const std::string & topic_name,
+			const std::string & payload,
+			const delivery_info_t & info ) override;
+
+	protected :
+		virtual void
+		call(
+			string_view_t topic_name,
+			string_view_t payload,
+			const topic_params_t & topic_params ) = 0;
+
+	private :
+		message_selector_t m_selector;
+
+		//! Can be empty.
+		const subscription_failure_handler_t m_on_failure;
+
+		//! Serializes calls of the callbacks and deactivation.
+		std::mutex m_lock;
+		bool m_active{ true };
+	};
+
+//
+// callback_postman_t
+//
+template< typename DECODER_TAG, typename HANDLER >
+class callback_postman_t : public callback_postman_base_t
+	{
+		HANDLER m_callback;
+
+	public :
+		callback_postman_t(
+			HANDLER callback,
+			const subscription_options_t & options,
+			std::shared_ptr< stats_counters_t > stats,
+			subscription_failure_handler_t on_failure =
+				subscription_failure_handler_t{} )
+			:	callback_postman_base_t{
+					options, std::move(stats), std::move(on_failure) }
+			,	m_callback( std::move(callback) )
+			{}
+
+	protected :
+		virtual void
+		call(
+			string_view_t topic_name,
+			string_view_t payload,
+			const topic_params_t & topic_params ) override
+			{
+				m_callback( incoming_message_view_t< DECODER_TAG >{
+						topic_name, payload, topic_params } );
+			}
+	};
+
+} /* namespace details */
+
+//
+// callback_subscriber_t
+//
+/*!
+ * \brief Helper for subscriptions which call a callback for every
+ * incoming message.
+ *
+ * Callback is called directly by transport manager. There are no agents,
+ * mboxes and SObjectizer's messages between transport manager and
+ * the callback, topic names and payloads are not copied.
+ *
+ * The callback receives const incoming_message_view_t<DECODER_TAG> &.
+ *
+ * \attention The callback is called on the context of transport manager.
+ * It must not block and must not throw. Calls for one subscription are
+ * serialized but can be made from different threads.
+ *
+ * \note There are no notifications about availability of the
+ * subscription. A subscription failure is reported to the failure
+ * handler or, if there is no handler, by an exception on the context
+ * of transport manager.
+ */
+template< typename DECODER_TAG >
+struct callback_subscriber_t
+	{
+		using view_type = incoming_message_view_t< DECODER_TAG >;
+
+		//! Subscribe a callback to a topic filter.
+		/*!
+		 * subscription_options_t::m_ttl is ignored because messages
+		 * are not queued.
+		 *
+		 * When subscription_handle_t::unsubscribe() returns the callback
+		 * is not running and will not be called anymore. Because of that
+		 * unsubscribe() must not be called from the callback itself.
+		 *
+		 * \throw ex_t if \a topic_name is an invalid shared subscription.
+		 */
+		template< typename HANDLER >
+		static subscription_handle_t
+		subscribe(
+			const instance_t & instance,
+			const std::string & topic_name,
+			HANDLER callback,
+			const subscription_options_t & options = subscription_options_t{} );
+
+		//! Subscribe a callback with a handler of subscription failure.
+		/*!
+		 * \a on_failure is called on the context of transport manager
+		 * with the same guarantees as the callback. It is not called after
+		 * return from subscription_handle_t::unsubscribe().
+		 *
+		 * \throw ex_t if \a topic_name is an invalid shared subscription.
+		 */
+		template< typename HANDLER >
+		static subscription_handle_t
+		subscribe(
+			const instance_t & instance,
+			const std::string & topic_name,
+			HANDLER callback,
+			subscription_failure_handler_t on_failure,
+			const subscription_options_t & options = subscription_options_t{} );
+	};
+
+template< typename DECODER_TAG >
+template< typename HANDLER >
+subscription_handle_t
+callback_subscriber_t< DECODER_TAG >::subscribe(
+	const instance_t & instance,
+	const std::string & topic_name,
+	HANDLER callback,
+	const subscription_options_t & options )
+	{
+		return subscribe( instance, topic_name, std::move(callback),
+				subscription_failure_handler_t{}, options );
+	}
+
+template< typename DECODER_TAG >
+template< typename HANDLER >
+subscription_handle_t
+callback_subscriber_t< DECODER_TAG >::subscribe(
+	const instance_t & instance,
+	const std::string & topic_name,
+	HANDLER callback,
+	subscription_failure_handler_t on_failure,
+	const subscription_options_t & options )
+	{
+		using namespace details;
+
+		if( impl::is_shared_subscription( topic_name ) )
+			impl::parse_shared_subscription( topic_name );
+
+		auto postman = std::make_shared<
+				callback_postman_t< DECODER_TAG, HANDLER > >(
+						std::move(callback), options, instance.stats_counters(),
+						std::move(on_failure) );
+
+		so_5::send< subscribe_topic_t >(
+				instance.mbox(), topic_name, postman );
+
+		return subscription_handle_t{
+				instance.mbox(), topic_name, std::move(postman) };
+	}
+
+} /* namespace mosquitto_transport */
@@ -9,10 +9,79 @@
 
 #pragma once
 
+#include <chrono>
 #include <string>
+#include <vector>
 
 namespace mosquitto_transport {
 
+//
+// broker_endpoint_t
+//
+/*!
+ * \brief Address of MQTT broker.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct broker_endpoint_t
+	{
+		std::string m_host;
+		unsigned int m_port = 1883;
+
+		broker_endpoint_t()
+			{}
+
+		broker_endpoint_t(
+			std::string host,
+			unsigned int port )
+			:	m_host( std::move(host) )
+			,	m_port( port )
+			{}
+	};
+
+//
+// reconnect_params_t
+//
+/*!
+ * \brief Parameters of reconnection to MQTT broker.
+ *
+ * The first reconnection attempt is made after m_initial_delay.
+ * If m_exponential_backoff is true the delay is doubled after every
+ * unsuccessful attempt (but doesn't exceed m_max_delay). Every delay is
+ * randomly changed by up to m_jitter fraction of it.
+ *
+ * \note If I/O dispatcher is not used then reconnection is performed by
+ * libmosquitto itself: delays are rounded up to whole seconds and
+ * libmosquitto's formula of exponential backoff is used. m_jitter must be
+ * zero in that case, otherwise ex_t is thrown at the start of transport
+ * manager.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct reconnect_params_t
+	{
+		std::chrono::steady_clock::duration m_initial_delay{
+				std::chrono::seconds{1} };
+		std::chrono::steady_clock::duration m_max_delay{
+				std::chrono::seconds{1} };
+		bool m_exponential_backoff = false;
+		double m_jitter = 0.0;
+		//! Max age of resolved addresses of brokers.
+		/*!
+		 * Addresses of the main and fallback brokers are resolved again
+		 * after a disconnection if they are older than this value. While
+		 * there is no connection they are resolved every m_address_ttl.
+		 * Zero means that addresses are resolved only once.
+		 *
+		 * \note Is used only with I/O dispatcher. Without it libmosquitto
+		 * reconnects to the address resolved at the start.
+		 */
+		std::chrono::steady_clock::duration m_address_ttl{
+				std::chrono::minutes{5} };
+	};
+
 //
 // connection_params_t
 //
@@ -26,6 +95,47 @@ struct connection_params_t
 		unsigned int m_port = 1883;
 		unsigned int m_keepalive = 30;
 
+		//! Should the broker drop client's session on disconnection?
+		/*!
+		 * If this value is false then the broker keeps subscriptions
+		 * of the client between connections. Topic filters unsubscribed
+		 * while there is no connection are unsubscribed after reconnection.
+		 *
+		 * If the broker reports in CONNACK that it holds the session then
+		 * topic filters acknowledged in that session are not subscribed
+		 * again. They become available right after reconnection.
+		 *
+		 * \note Non-empty m_client_id is required if this value is false.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		bool m_clean_session = true;
+
+		//! Parameters of reconnection.
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		reconnect_params_t m_reconnect;
+
+		//! Brokers to be used if m_host is not available.
+		/*!
+		 * Addresses of m_host and all fallback brokers are resolved at
+		 * the start of transport manager on a separate thread (and then
+		 * again, see reconnect_params_t::m_address_ttl). If the
+		 * connection is lost then reconnection attempts are made to m_host
+		 * first and then to the next brokers in round-robin order.
+		 *
+		 * \attention Fallback brokers require I/O dispatcher
+		 * (see a_transport_manager_t::set_io_dispatcher()). Otherwise
+		 * ex_t is thrown at the start of transport manager.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		std::vector< broker_endpoint_t > m_fallback_brokers;
+
 		//! Default constructor.
 		connection_params_t()
 			{}
@@ -0,0 +1,95 @@
+/*
+ * mosquitto_transport
+ */
+
+/*!
+ * \file
+ * \brief Aggregated availability of topics of a bulk subscription.
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <set>
+#include <string>
+
+namespace mosquitto_transport {
+
+namespace impl {
+
+//
+// bulk_status_t
+//
+/*!
+ * \brief Availability of a set of topics as a whole.
+ *
+ * The set becomes available when every topic is available and becomes
+ * unavailable when any of them is lost. Notifications must be sent only
+ * on these transitions.
+ *
+ * \note This class is not thread safe.
+ */
+class bulk_status_t
+	{
+	public :
+		//! Change of availability of the whole set.
+		enum class change_t
+			{
+				none,
+				all_available,
+				some_unavailable
+			};
+
+		bulk_status_t( std::size_t topics_count )
+			:	m_topics_count{ topics_count }
+			{}
+
+		std::size_t
+		topics_count() const { return m_topics_count; }
+
+		//! Is every topic available?
+		bool
+		all_available() const { return m_all_available; }
+
+		change_t
+		available( const std::string & topic_name )
+			{
+				m_available.insert( topic_name );
+				if( !m_all_available && m_available.size() == m_topics_count )
+					{
+						m_all_available = true;
+						return change_t::all_available;
+					}
+
+				return change_t::none;
+			}
+
+		change_t
+		unavailable( const std::string & topic_name )
+			{
+				m_available.erase( topic_name );
+				if( m_all_available )
+					{
+						m_all_available = false;
+						return change_t::some_unavailable;
+					}
+
+				return change_t::none;
+			}
+
+	private :
+		//! Total count of topics.
+		const std::size_t m_topics_count;
+
+		//! Topics which are available now.
+		std::set< std::string > m_available;
+
+		//! Was the whole set reported as available?
+		bool m_all_available{ false };
+	};
+
+} /* namespace impl */
+
+} /* namespace mosquitto_transport */
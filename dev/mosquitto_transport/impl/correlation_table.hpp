@@ -0,0 +1,230 @@
+/*
+ * mosquitto_transport
+ */
+
+/*!
+ * \file
+ * \brief Table of pending calls with timeouts.
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mosquitto_transport {
+
+namespace impl {
+
+//
+// correlation_table_t
+//
+/*!
+ * \brief Table of pending calls identified by correlation IDs.
+ *
+ * Deadlines are tracked by a hashed timer wheel: every slot holds IDs
+ * whose deadlines fall into the same tick (modulo count of slots).
+ * Insertion and extraction are O(1). Expiration scans only slots for
+ * elapsed ticks.
+ *
+ * IDs of extracted entries are not removed from slots. They are
+ * dropped when their slots are scanned.
+ *
+ * \attention Correlation IDs must not be reused.
+ *
+ * \note This class is not thread safe.
+ */
+template< typename VALUE >
+class correlation_table_t
+	{
+	public :
+		using clock_type = std::chrono::steady_clock;
+		using id_type = std::uint64_t;
+
+		correlation_table_t(
+			//! Resolution of deadlines.
+			clock_type::duration tick,
+			//! Count of slots in the wheel.
+			std::size_t slots,
+			//! Start time of the wheel.
+			clock_type::time_point now )
+			:	m_tick{ tick }
+			,	m_start{ now }
+			,	m_slots( slots )
+			{}
+
+		//! Add a new entry.
+		/*!
+		 * Returns false if there already is an entry with \a id.
+		 */
+		bool
+		insert(
+			id_type id,
+			VALUE value,
+			clock_type::time_point deadline )
+			{
+				auto r = m_entries.emplace( id,
+						entry_t{ std::move(value), deadline } );
+				if( !r.second )
+					return false;
+
+				auto tick = tick_of( deadline );
+				if( tick < m_current_tick )
+					// The deadline is already passed. The entry will be
+					// expired by the next call to expire().
+					tick = m_current_tick;
+
+				m_slots[ tick % m_slots.size() ].push_back( id );
+				return true;
+			}
+
+		//! Remove an entry.
+		/*!
+		 * Returns false if there is no entry with \a id. Otherwise the value
+		 * of the entry is moved to \a value.
+		 */
+		bool
+		extract( id_type id, VALUE & value )
+			{
+				auto it = m_entries.find( id );
+				if( it == m_entries.end() )
+					return false;
+
+				value = std::move( it->second.m_value );
+				m_entries.erase( it );
+				return true;
+			}
+
+		//! Remove all entries with deadlines before or at \a now.
+		/*!
+		 * \a handler is called as handler(id, value) for every expired entry.
+		 */
+		template< typename HANDLER >
+		void
+		expire( clock_type::time_point now, HANDLER && handler )
+			{
+				const auto now_tick = tick_of( now );
+				if( now_tick < m_current_tick )
+					return;
+
+				// There is no need to scan a slot more than once.
+				const auto ticks = std::min< id_type >(
+						now_tick - m_current_tick + 1u, m_slots.size() );
+
+				for( id_type i = 0u; i != ticks; ++i )
+					{
+						auto & slot = m_slots[ ( now_tick - i ) % m_slots.size() ];
+
+						std::size_t kept = 0u;
+						for( const auto id : slot )
+							{
+								auto it = m_entries.find( id );
+								if( it == m_entries.end() )
+									// Entry is already extracted.
+									continue;
+
+								if( it->second.m_deadline > now )
+									// Entry for one of the next rounds of the wheel
+									// or for the rest of the current tick.
+									slot[ kept++ ] = id;
+								else
+									{
+										VALUE value = std::move( it->second.m_value );
+										m_entries.erase( it );
+										handler( id, std::move(value) );
+									}
+							}
+						slot.resize( kept );
+					}
+
+				m_current_tick = now_tick;
+			}
+
+		//! Remove all entries.
+		/*!
+		 * \a handler is called as handler(id, value) for every entry.
+		 */
+		template< typename HANDLER >
+		void
+		clear( HANDLER && handler )
+			{
+				auto entries = std::move( m_entries );
+				m_entries.clear();
+				for( auto & s : m_slots )
+					s.clear();
+
+				for( auto & e : entries )
+					handler( e.first, std::move( e.second.m_value ) );
+			}
+
+		//! Get the time for the next call to expire().
+		/*!
+		 * Returns false if the table is empty. Otherwise \a at is the end
+		 * of the nearest tick whose slot isn't empty.
+		 *
+		 * Entries are expired not later than one tick after their deadlines.
+		 * The slot can contain only extracted entries or entries for
+		 * the next rounds of the wheel. In that case expire() finds nothing
+		 * and the next call to this method returns a later time.
+		 *
+		 * \note Only slots are scanned, so the cost doesn't depend on
+		 * the count of entries.
+		 */
+		bool
+		next_expiration( clock_type::time_point & at ) const
+			{
+				if( m_entries.empty() )
+					return false;
+
+				// Every entry is in one of the slots, so a non-empty slot
+				// is found during one round of the wheel.
+				auto tick = m_current_tick;
+				while( m_slots[ tick % m_slots.size() ].empty() )
+					++tick;
+
+				at = m_start + m_tick * static_cast< clock_type::rep >( tick + 1u );
+				return true;
+			}
+
+		std::size_t
+		size() const { return m_entries.size(); }
+
+		bool
+		empty() const { return m_entries.empty(); }
+
+	private :
+		struct entry_t
+			{
+				VALUE m_value;
+				clock_type::time_point m_deadline;
+			};
+
+		const clock_type::duration m_tick;
+		const clock_type::time_point m_start;
+
+		//! IDs of entries for every slot of the wheel.
+		std::vector< std::vector< id_type > > m_slots;
+
+		//! The last tick processed by expire().
+		id_type m_current_tick{};
+
+		std::unordered_map< id_type, entry_t > m_entries;
+
+		id_type
+		tick_of( clock_type::time_point tp ) const
+			{
+				if( tp <= m_start )
+					return 0u;
+				return static_cast< id_type >( ( tp - m_start ) / m_tick );
+			}
+	};
+
+} /* namespace impl */
+
+} /* namespace mosquitto_transport */
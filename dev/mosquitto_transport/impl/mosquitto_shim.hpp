@@ -0,0 +1,82 @@
+/*
+ * mosquitto_transport-1.0
+ */
+
+/*!
+ * \file
+ * \brief The only place where internal API of libmosquitto is used.
+ *
+ * Public API of libmosquitto v.1.4 doesn't provide some features
+ * required by transport manager. They are implemented in mosquitto_shim.cpp
+ * by internal functions and structures of libmosquitto:
+ *
+ * - subscribe_multiple(): building of SUBSCRIBE packet with several topic
+ *   filters (_mosquitto_packet_alloc(), _mosquitto_write_*(),
+ *   _mosquitto_mid_generate(), _mosquitto_packet_queue());
+ * - connack_session_present(): the 'session present' flag of CONNACK
+ *   (mosquitto::in_packet).
+ *
+ * Internal headers (mosquitto_internal.h, memory_mosq.h, mqtt3_protocol.h,
+ * net_mosq.h, util_mosq.h) are taken from the same source tree as
+ * libmosquitto itself (see libmosquitto/prj.rb). mosquitto_shim.cpp
+ * doesn't compile with other versions of libmosquitto than v.1.4.
+ *
+ * \attention Internal API must not be used anywhere else. If libmosquitto
+ * is updated then only mosquitto_shim.cpp must be reviewed.
+ *
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <mosquitto.h>
+
+#include <vector>
+
+namespace mosquitto_transport {
+
+namespace impl {
+
+//
+// subscribe_multiple
+//
+/*!
+ * \brief Send one SUBSCRIBE packet for several topic filters.
+ *
+ * Public API of libmosquitto v.1.4 allows only one topic filter in
+ * SUBSCRIBE packet. Because of that the packet is built by internal
+ * functions of libmosquitto and is placed into the queue of outgoing
+ * packets of \a mosq. SUBACK for it is passed to the subscribe callback
+ * with granted QoS for every filter.
+ *
+ * \return the same codes as mosquitto_subscribe().
+ */
+int
+subscribe_multiple(
+	mosquitto * mosq,
+	int * mid,
+	const std::vector< char * > & topic_filters,
+	int qos );
+
+//
+// connack_session_present
+//
+/*!
+ * \brief Get the 'session present' flag from CONNACK.
+ *
+ * libmosquitto v.1.4 passes only the return code of CONNACK to the
+ * connect callback. The flag is taken from the packet which is being
+ * handled by libmosquitto during the call of that callback.
+ *
+ * \attention Must be called only from the connect callback of \a mosq.
+ * The result is meaningless in any other place.
+ *
+ * \return false if the current incoming packet isn't CONNACK.
+ */
+bool
+connack_session_present( mosquitto * mosq );
+
+} /* namespace impl */
+
+} /* namespace mosquitto_transport */
@@ -0,0 +1,76 @@
+/*
+ * mosquitto_transport
+ */
+
+/*!
+ * \file
+ * \brief Results of payload filters for one incoming message.
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <mosquitto_transport/payload_filter.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string>
+#include <utility>
+
+namespace mosquitto_transport {
+
+namespace impl {
+
+//
+// payload_filter_results_t
+//
+/*!
+ * \brief Results of payload filters for one message.
+ *
+ * One object is used for all subscriptions matched by the message.
+ * Several postmans can use the same filter. It is evaluated only once.
+ * Only a few results are remembered: there are rarely many different
+ * filters for one message.
+ *
+ * \note This class is not thread safe.
+ */
+class payload_filter_results_t
+	{
+		static constexpr std::size_t max_results = 8u;
+
+		const string_view_t m_payload;
+
+		std::array< std::pair< const payload_filter_t *, bool >, max_results >
+				m_results;
+		std::size_t m_size{};
+
+	public :
+		//! \a payload must live longer than this object.
+		payload_filter_results_t( const std::string & payload )
+			:	m_payload{ payload }
+			{}
+
+		bool
+		accept( const payload_filter_t & filter )
+			{
+				const auto b = m_results.begin();
+				const auto e = b + static_cast< std::ptrdiff_t >( m_size );
+				const auto it = std::find_if( b, e,
+						[&filter]( const std::pair< const payload_filter_t *, bool > & r ) {
+							return r.first == &filter;
+						} );
+				if( it != e )
+					return it->second;
+
+				const bool r = filter.accept( m_payload );
+				if( m_size != max_results )
+					m_results[ m_size++ ] = std::make_pair( &filter, r );
+				return r;
+			}
+	};
+
+} /* namespace impl */
+
+} /* namespace mosquitto_transport */
@@ -0,0 +1,229 @@
+/*
+ * mosquitto_transport
+ */
+
+/*!
+ * \file
+ * \brief Window of recently delivered messages for deduplication.
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+namespace mosquitto_transport {
+
+namespace impl {
+
+//
+// message_source_t
+//
+/*!
+ * \brief Source of a message.
+ */
+enum class message_source_t
+	{
+		//! Main connection to the broker.
+		primary = 0,
+		//! Standby connection.
+		standby = 1,
+		//! Local publish delivered without the broker.
+		local = 2
+	};
+
+//
+// message_hash
+//
+/*!
+ * \brief Hash of message's topic and payload.
+ */
+inline std::size_t
+message_hash( const std::string & topic, const std::string & payload )
+	{
+		const std::hash< std::string > h;
+		const auto t = h( topic );
+		return t ^ (h( payload ) + 0x9e3779b9u + (t << 6) + (t >> 2));
+	}
+
+//
+// recent_messages_t
+//
+/*!
+ * \brief Window of messages delivered from different sources.
+ *
+ * When delivery is switched from one connection to another the new
+ * connection can receive messages which were already delivered via
+ * the old one. A message delivered locally comes back from the broker
+ * if it is also published to the broker. Such messages are detected by
+ * their hashes.
+ *
+ * A message is considered as duplicate if a message with the same hash
+ * from another source was delivered during the window. Every delivered
+ * message can suppress only one duplicate.
+ *
+ * Entries are indexed by hash so a check doesn't depend on the size
+ * of the window.
+ *
+ * \note There are no message IDs for QoS=0 messages. Because of that
+ * a message with the same topic and payload which is really published
+ * twice during the window can be dropped at the moment of switching.
+ */
+class recent_messages_t
+	{
+	public :
+		using clock_type = std::chrono::steady_clock;
+
+		recent_messages_t(
+			clock_type::duration window,
+			std::size_t max_size )
+			:	m_window{ window }
+			,	m_max_size{ max_size }
+			{}
+
+		//! Check a message and remember it if it isn't a duplicate.
+		/*!
+		 * \return false if message is a duplicate and must be dropped.
+		 */
+		bool
+		accept(
+			std::size_t hash,
+			message_source_t source,
+			clock_type::time_point now )
+			{
+				remove_outdated( now );
+
+				const auto it = m_index.find( hash );
+				if( it != m_index.end() )
+					{
+						// The oldest not consumed message from another source
+						// suppresses this one.
+						entry_list_t * oldest = nullptr;
+						for( auto & l : it->second.m_not_consumed )
+							if( !l.empty() && l.front()->m_source != source &&
+									( !oldest ||
+										l.front()->m_at < oldest->front()->m_at ) )
+								oldest = &l;
+
+						if( oldest )
+							{
+								oldest->front()->m_consumed = true;
+								oldest->pop_front();
+								if( it->second.empty() )
+									m_index.erase( it );
+								return false;
+							}
+					}
+
+				add( hash, source, now );
+				return true;
+			}
+
+		//! Remember a message without any checks.
+		void
+		remember(
+			std::size_t hash,
+			message_source_t source,
+			clock_type::time_point now )
+			{
+				remove_outdated( now );
+				add( hash, source, now );
+			}
+
+		std::size_t
+		size() const { return m_entries.size(); }
+
+	private :
+		struct entry_t
+			{
+				std::size_t m_hash;
+				message_source_t m_source;
+				clock_type::time_point m_at;
+				//! Was a duplicate of this message already dropped?
+				bool m_consumed;
+			};
+
+		//! Not consumed entries with the same hash and source.
+		/*!
+		 * Entries are in the order of arrival. Pointers to elements of
+		 * m_entries are stable because m_entries is changed only at its ends.
+		 */
+		using entry_list_t = std::deque< entry_t * >;
+
+		//! Not consumed entries with the same hash from every source.
+		struct same_hash_t
+			{
+				entry_list_t m_not_consumed[ 3 ];
+
+				entry_list_t &
+				of( message_source_t source )
+					{
+						return m_not_consumed[ static_cast< int >(source) ];
+					}
+
+				bool
+				empty() const
+					{
+						for( const auto & l : m_not_consumed )
+							if( !l.empty() )
+								return false;
+						return true;
+					}
+			};
+
+		const clock_type::duration m_window;
+		const std::size_t m_max_size;
+
+		std::deque< entry_t > m_entries;
+
+		//! Index of not consumed entries.
+		std::unordered_map< std::size_t, same_hash_t > m_index;
+
+		void
+		add(
+			std::size_t hash,
+			message_source_t source,
+			clock_type::time_point now )
+			{
+				m_entries.push_back( entry_t{ hash, source, now, false } );
+				m_index[ hash ].of( source ).push_back( &m_entries.back() );
+
+				if( m_entries.size() > m_max_size )
+					pop_front();
+			}
+
+		void
+		remove_outdated( clock_type::time_point now )
+			{
+				while( !m_entries.empty() &&
+						now - m_entries.front().m_at > m_window )
+					pop_front();
+			}
+
+		void
+		pop_front()
+			{
+				const auto & e = m_entries.front();
+				if( !e.m_consumed )
+					{
+						// Entries leave the window in the order of arrival,
+						// so this one is the oldest in its list.
+						const auto it = m_index.find( e.m_hash );
+						it->second.of( e.m_source ).pop_front();
+						if( it->second.empty() )
+							m_index.erase( it );
+					}
+
+				m_entries.pop_front();
+			}
+	};
+
+} /* namespace impl */
+
+} /* namespace mosquitto_transport */
@@ -0,0 +1,97 @@
+/*
+ * mosquitto_transport
+ */
+
+/*!
+ * \file
+ * \brief Resolution of broker's host name.
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include <mutex>
+#include <string>
+
+namespace mosquitto_transport {
+
+namespace impl {
+
+//
+// resolve_host
+//
+/*!
+ * \brief Get numeric address for a host name.
+ *
+ * The first address returned by getaddrinfo() is used. If \a host is
+ * already a numeric address it is returned without DNS lookup.
+ *
+ * \return empty string if \a host can't be resolved.
+ */
+inline std::string
+resolve_host( const std::string & host )
+	{
+		addrinfo hints{};
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+
+		addrinfo * ai = nullptr;
+		if( 0 != getaddrinfo( host.c_str(), nullptr, &hints, &ai ) || !ai )
+			return std::string{};
+
+		char buf[ NI_MAXHOST ];
+		const int rc = getnameinfo( ai->ai_addr, ai->ai_addrlen,
+				buf, sizeof(buf), nullptr, 0, NI_NUMERICHOST );
+		freeaddrinfo( ai );
+
+		return 0 == rc ? std::string{ buf } : std::string{};
+	}
+
+//
+// resolution_slot_t
+//
+/*!
+ * \brief Link between a detached thread for DNS lookups and its owner.
+ *
+ * The thread passes its result via deliver(). The result is dropped if
+ * the owner has called cancel() before. The owner doesn't wait for
+ * a hung DNS lookup: cancel() waits only for a delivery in progress.
+ *
+ * \note The slot must be held by the thread via shared_ptr.
+ */
+class resolution_slot_t
+	{
+	public :
+		//! Call \a delivery if the resolution is not cancelled.
+		template< typename DELIVERY >
+		void
+		deliver( DELIVERY && delivery )
+			{
+				std::lock_guard< std::mutex > lock{ m_lock };
+				if( !m_cancelled )
+					delivery();
+			}
+
+		//! Drop the result.
+		/*!
+		 * There is no call of delivery after return from this method.
+		 */
+		void
+		cancel()
+			{
+				std::lock_guard< std::mutex > lock{ m_lock };
+				m_cancelled = true;
+			}
+
+	private :
+		std::mutex m_lock;
+		bool m_cancelled{ false };
+	};
+
+} /* namespace impl */
+
+} /* namespace mosquitto_transport */
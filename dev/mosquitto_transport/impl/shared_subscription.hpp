@@ -0,0 +1,143 @@
+/*
+ * mosquitto_transport
+ */
+
+/*!
+ * \file
+ * \brief Helpers for handling of shared subscriptions ($share/group/filter).
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <mosquitto_transport/tools.hpp>
+
+#include <string>
+
+namespace mosquitto_transport {
+
+namespace impl {
+
+//
+// shared_subscription_prefix
+//
+/*!
+ * \brief Prefix of topic filter for shared subscriptions.
+ */
+constexpr const char shared_subscription_prefix[] = "$share/";
+
+//
+// is_shared_subscription
+//
+/*!
+ * \brief Does topic filter describe a shared subscription?
+ */
+inline bool
+is_shared_subscription( const std::string & topic_filter )
+	{
+		return 0 == topic_filter.compare(
+				0, sizeof(shared_subscription_prefix) - 1u,
+				shared_subscription_prefix );
+	}
+
+//
+// shared_subscription_t
+//
+/*!
+ * \brief Parsed representation of shared subscription's topic filter.
+ */
+struct shared_subscription_t
+	{
+		//! Name of share group.
+		std::string m_group;
+		//! Underlying topic filter.
+		std::string m_topic_filter;
+	};
+
+//
+// parse_shared_subscription
+//
+/*!
+ * \brief Split shared subscription's topic filter to group name and
+ * underlying topic filter.
+ *
+ * \throw ex_t if \a topic_filter is not a valid shared subscription.
+ */
+inline shared_subscription_t
+parse_shared_subscription( const std::string & topic_filter )
+	{
+		ensure_with_explblock< ex_t >( is_shared_subscription( topic_filter ),
+			[&]{ return fmt::format( "not a shared subscription: '{}'",
+					topic_filter ); } );
+
+		const auto group_start = sizeof(shared_subscription_prefix) - 1u;
+		const auto group_end = topic_filter.find( '/', group_start );
+		ensure_with_explblock< ex_t >(
+				std::string::npos != group_end &&
+				group_end != group_start &&
+				group_end + 1u < topic_filter.size(),
+			[&]{ return fmt::format( "invalid shared subscription: '{}'",
+					topic_filter ); } );
+
+		shared_subscription_t result{
+				topic_filter.substr( group_start, group_end - group_start ),
+				topic_filter.substr( group_end + 1u ) };
+
+		ensure_with_explblock< ex_t >(
+				std::string::npos == result.m_group.find_first_of( "+#" ),
+			[&]{ return fmt::format( "invalid share group name: '{}'",
+					result.m_group ); } );
+
+		return result;
+	}
+
+//
+// make_shared_subscription
+//
+/*!
+ * \brief Make topic filter for shared subscription from group name
+ * and underlying topic filter.
+ *
+ * \throw ex_t if group name or topic filter is not valid.
+ */
+inline std::string
+make_shared_subscription(
+	const std::string & group,
+	const std::string & topic_filter )
+	{
+		ensure_with_explblock< ex_t >(
+				!group.empty() &&
+				std::string::npos == group.find_first_of( "/+#" ),
+			[&]{ return fmt::format( "invalid share group name: '{}'",
+					group ); } );
+		ensure_with_explblock< ex_t >( !topic_filter.empty(),
+			[]{ return "topic_filter for shared subscription is empty"; } );
+
+		return shared_subscription_prefix + group + "/" + topic_filter;
+	}
+
+//
+// delivery_topic_filter
+//
+/*!
+ * \brief Get the topic filter which should be used for local delivery of
+ * messages received via subscription \a topic_filter.
+ *
+ * The broker sends messages received via shared subscription with
+ * the actual topic names. Because of that the '$share/group/' part
+ * must be stripped for local matching. All other topic filters are
+ * returned as is.
+ */
+inline std::string
+delivery_topic_filter( const std::string & topic_filter )
+	{
+		if( is_shared_subscription( topic_filter ) )
+			return parse_shared_subscription( topic_filter ).m_topic_filter;
+		else
+			return topic_filter;
+	}
+
+} /* namespace impl */
+
+} /* namespace mosquitto_transport */
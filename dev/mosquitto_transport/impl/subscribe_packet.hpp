@@ -0,0 +1,81 @@
+/*
+ * mosquitto_transport-1.0
+ */
+
+/*!
+ * \file
+ * \brief Splitting of topic filters into SUBSCRIBE packets.
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace mosquitto_transport {
+
+namespace impl {
+
+//
+// subscribe_filter_bytes
+//
+/*!
+ * \brief Size of topic filter in the payload of SUBSCRIBE packet.
+ *
+ * Length of topic filter, the filter itself and requested QoS byte.
+ */
+inline std::size_t
+subscribe_filter_bytes( const std::string & topic_filter )
+	{
+		return 2u + topic_filter.size() + 1u;
+	}
+
+//
+// for_each_subscribe_packet
+//
+/*!
+ * \brief Split topic filters into SUBSCRIBE packets with respect to
+ * batching limits.
+ *
+ * A packet contains no more than \a max_filters filters and
+ * no more than \a max_bytes bytes of filters (see subscribe_filter_bytes()).
+ * A filter which is greater than \a max_bytes is sent in a separate packet.
+ *
+ * \a sender is called as sender(first, last) for every packet.
+ */
+template< typename SENDER >
+void
+for_each_subscribe_packet(
+	const std::vector< std::string > & topic_names,
+	std::size_t max_filters,
+	std::size_t max_bytes,
+	SENDER && sender )
+	{
+		std::size_t first = 0u;
+		std::size_t packet_bytes = 0u;
+		for( std::size_t i = 0u; i != topic_names.size(); ++i )
+			{
+				const auto filter_bytes = subscribe_filter_bytes( topic_names[ i ] );
+
+				if( i != first &&
+						( i - first == max_filters ||
+						  packet_bytes + filter_bytes > max_bytes ) )
+					{
+						sender( first, i );
+						first = i;
+						packet_bytes = 0u;
+					}
+
+				packet_bytes += filter_bytes;
+			}
+
+		if( first != topic_names.size() )
+			sender( first, topic_names.size() );
+	}
+
+} /* namespace impl */
+
+} /* namespace mosquitto_transport */
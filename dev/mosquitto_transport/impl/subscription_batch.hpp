@@ -0,0 +1,96 @@
+/*
+ * mosquitto_transport
+ */
+
+/*!
+ * \file
+ * \brief Batch of new subscriptions collected during coalescing window.
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mosquitto_transport {
+
+namespace impl {
+
+//
+// subscription_batch_t
+//
+/*!
+ * \brief New subscriptions waiting for sending to the broker.
+ *
+ * Every batch has its own ID. A delayed flush is scheduled for the ID of
+ * the batch when the first topic is added to it. The batch can be sent
+ * earlier because of the size limit. In that case the delayed flush
+ * becomes stale and must not send the next batch before its window ends.
+ *
+ * \note This class is not thread safe.
+ */
+class subscription_batch_t
+	{
+	public :
+		//! ID of the current batch.
+		std::uint64_t
+		id() const { return m_id; }
+
+		bool
+		empty() const { return m_topics.empty(); }
+
+		std::size_t
+		size() const { return m_topics.size(); }
+
+		//! Add topics to the current batch.
+		/*!
+		 * \return true if these are the first topics of the batch.
+		 * A delayed flush for id() must be scheduled in that case.
+		 */
+		bool
+		add( const std::vector< std::string > & topic_names )
+			{
+				const bool first = m_topics.empty() && !topic_names.empty();
+				m_topics.insert( m_topics.end(),
+						topic_names.begin(), topic_names.end() );
+
+				return first;
+			}
+
+		//! Is a delayed flush for \a batch_id still actual?
+		bool
+		is_current( std::uint64_t batch_id ) const
+			{
+				return batch_id == m_id && !m_topics.empty();
+			}
+
+		//! Extract all topics of the current batch and start a new one.
+		std::vector< std::string >
+		take()
+			{
+				std::vector< std::string > topic_names;
+				topic_names.swap( m_topics );
+				++m_id;
+
+				return topic_names;
+			}
+
+		//! Drop all topics of the current batch and start a new one.
+		void
+		clear()
+			{
+				m_topics.clear();
+				++m_id;
+			}
+
+	private :
+		std::uint64_t m_id{};
+		std::vector< std::string > m_topics;
+	};
+
+} /* namespace impl */
+
+} /* namespace mosquitto_transport */
@@ -0,0 +1,107 @@
+/*
+ * mosquitto_transport
+ */
+
+/*!
+ * \file
+ * \brief Deadlines of pending and repeated subscriptions.
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace mosquitto_transport {
+
+namespace impl {
+
+//
+// subscription_deadline_t
+//
+/*!
+ * \brief A moment when something should be done with subscriptions.
+ *
+ * It is either a deadline for a pending SUBSCRIBE packet or a time for
+ * the next attempt of a failed subscription.
+ *
+ * Deadlines are not removed from the queue when the reason disappears
+ * (SUBACK received or topic unsubscribed). Outdated deadlines are just
+ * ignored when they are extracted from the queue.
+ */
+struct subscription_deadline_t
+	{
+		std::chrono::steady_clock::time_point m_at;
+		//! MID of pending SUBSCRIBE packet.
+		/*!
+		 * \note Is used only if m_topic_name is empty.
+		 */
+		int m_mid;
+		//! Topic for the next subscription attempt.
+		std::string m_topic_name;
+
+		bool
+		operator>( const subscription_deadline_t & o ) const
+			{
+				return m_at > o.m_at;
+			}
+	};
+
+//
+// subscription_deadline_queue_t
+//
+/*!
+ * \brief Heap of deadlines with the nearest one at the top.
+ */
+using subscription_deadline_queue_t = std::priority_queue<
+		subscription_deadline_t,
+		std::vector< subscription_deadline_t >,
+		std::greater< subscription_deadline_t > >;
+
+//
+// subscription_retry_delay
+//
+/*!
+ * \brief Delay before the next attempt of a failed subscription.
+ *
+ * The delay is \a initial_delay multiplied by \a multiplier for every
+ * previous attempt but not greater than \a max_delay. Then it is randomly
+ * changed by up to \a jitter fraction of it.
+ */
+template< typename RANDOM_ENGINE >
+std::chrono::steady_clock::duration
+subscription_retry_delay(
+	std::chrono::steady_clock::duration initial_delay,
+	std::chrono::steady_clock::duration max_delay,
+	double multiplier,
+	double jitter,
+	//! Count of attempts already made.
+	unsigned int attempts,
+	RANDOM_ENGINE & random_engine )
+	{
+		using duration = std::chrono::steady_clock::duration;
+
+		const double base_delay = std::min(
+				static_cast< double >( initial_delay.count() ) *
+					std::pow( multiplier, static_cast< double >( attempts ) ),
+				static_cast< double >( max_delay.count() ) );
+
+		std::uniform_real_distribution< double > deviation{
+				1.0 - jitter, 1.0 + jitter };
+
+		return duration{
+				static_cast< duration::rep >(
+						base_delay * deviation( random_engine ) ) };
+	}
+
+} /* namespace impl */
+
+} /* namespace mosquitto_transport */
@@ -0,0 +1,387 @@
+/*
+ * mosquitto_transport
+ */
+
+/*!
+ * \file
+ * \brief Helpers for minimization of broker-side subscriptions.
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <mosquitto_transport/impl/fragments_extractor.hpp>
+#include <mosquitto_transport/impl/shared_subscription.hpp>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace mosquitto_transport {
+
+namespace impl {
+
+//
+// topic_filter_covers
+//
+/*!
+ * \brief Does every topic matched by \a narrow also match \a wide?
+ *
+ * Both arguments are topic filters splitted into parts.
+ *
+ * \note Topic names started with '$' are not matched by wildcards
+ * at the first level.
+ */
+inline bool
+topic_filter_covers(
+	const splitted_topic_name_t & wide,
+	const splitted_topic_name_t & narrow )
+	{
+		const auto is_system_topic = [&narrow] {
+				return !narrow.front().empty() && '$' == narrow.front().front();
+			};
+
+		std::size_t i = 0u;
+		for( ; i != wide.size(); ++i )
+			{
+				if( "#" == wide[ i ] )
+					return !( 0u == i && is_system_topic() );
+
+				if( i == narrow.size() || "#" == narrow[ i ] )
+					// Wide filter requires more levels or narrow filter
+					// matches any number of levels.
+					return false;
+
+				if( "+" == wide[ i ] )
+					{
+						if( 0u == i && is_system_topic() )
+							return false;
+					}
+				else if( wide[ i ] != narrow[ i ] )
+					return false;
+			}
+
+		return i == narrow.size();
+	}
+
+//
+// topic_filter_covers
+//
+/*!
+ * \brief Does every topic matched by \a narrow also match \a wide?
+ *
+ * \note A shared subscription covers only itself and can't be covered
+ * by another filter.
+ */
+inline bool
+topic_filter_covers(
+	const std::string & wide,
+	const std::string & narrow )
+	{
+		if( is_shared_subscription( wide ) || is_shared_subscription( narrow ) )
+			return wide == narrow;
+
+		return topic_filter_covers(
+				split_topic_name( wide ),
+				split_topic_name( narrow ) );
+	}
+
+//
+// subscriptions_cover_t
+//
+/*!
+ * \brief Container for calculation of minimal set of broker subscriptions.
+ *
+ * Every topic filter is either a root (it is subscribed on the broker
+ * by itself) or is covered by some root (all messages for the filter
+ * are received via root's subscription).
+ *
+ * Only filters inserted into the container are used as roots. It means
+ * that the broker doesn't send messages which are not needed by someone.
+ *
+ * Coverage is tracked incrementally: insert() and erase() return
+ * broker subscriptions to be made and removed.
+ *
+ * \note Shared subscriptions are always roots and never cover other
+ * filters.
+ */
+class subscriptions_cover_t
+	{
+		subscriptions_cover_t( const subscriptions_cover_t & ) = delete;
+		subscriptions_cover_t( subscriptions_cover_t && ) = delete;
+
+	public :
+		//! Actions to be performed on the broker.
+		/*!
+		 * \attention Subscriptions must be made before unsubscriptions.
+		 * The broker handles packets in order, so there will be no
+		 * gaps in message delivery.
+		 */
+		struct actions_t
+			{
+				std::vector< std::string > m_subscribe;
+				std::vector< std::string > m_unsubscribe;
+			};
+
+		subscriptions_cover_t()
+			{}
+
+		//! Add a new topic filter.
+		actions_t
+		insert( const std::string & topic_filter );
+
+		//! Remove a topic filter.
+		actions_t
+		erase( const std::string & topic_filter );
+
+		//! Is topic filter subscribed on the broker by itself?
+		bool
+		is_root( const std::string & topic_filter ) const
+			{
+				return m_roots.end() != m_roots.find( topic_filter );
+			}
+
+		//! Get the root which covers topic filter.
+		/*!
+		 * Returns \a topic_filter itself if it is a root.
+		 */
+		const std::string &
+		root_of( const std::string & topic_filter ) const
+			{
+				auto it = m_covered.find( topic_filter );
+				return it != m_covered.end() ? it->second : topic_filter;
+			}
+
+		//! Get filters covered by a root.
+		const std::set< std::string > &
+		covered_by( const std::string & root ) const
+			{
+				static const std::set< std::string > empty;
+
+				auto it = m_roots.find( root );
+				return it != m_roots.end() ? it->second.m_covered : empty;
+			}
+
+		//! Count of broker subscriptions.
+		std::size_t
+		roots_count() const { return m_roots.size(); }
+
+	private :
+		struct root_t
+			{
+				//! Root's topic filter splitted into parts.
+				splitted_topic_name_t m_fragments;
+				//! Can the root cover other filters?
+				bool m_can_cover;
+				//! Filters covered by this root.
+				std::set< std::string > m_covered;
+			};
+
+		//! All roots.
+		std::map< std::string, root_t > m_roots;
+
+		//! Index of roots by the first part of topic filter.
+		/*!
+		 * Only roots which can cover other filters are indexed.
+		 */
+		std::map< std::string, std::set< std::string > > m_heads;
+
+		//! Covered filters and their roots.
+		std::map< std::string, std::string > m_covered;
+
+		static bool
+		is_wildcard( const std::string & fragment )
+			{
+				return "+" == fragment || "#" == fragment;
+			}
+
+		root_t &
+		add_root( const std::string & topic_filter )
+			{
+				const bool can_cover = !is_shared_subscription( topic_filter );
+
+				auto & root = m_roots[ topic_filter ];
+				root.m_can_cover = can_cover;
+				if( can_cover )
+					{
+						root.m_fragments = split_topic_name( topic_filter );
+						m_heads[ root.m_fragments.front() ].insert( topic_filter );
+					}
+
+				return root;
+			}
+
+		void
+		remove_root( std::map< std::string, root_t >::iterator it )
+			{
+				if( it->second.m_can_cover )
+					{
+						auto ithead = m_heads.find( it->second.m_fragments.front() );
+						ithead->second.erase( it->first );
+						if( ithead->second.empty() )
+							m_heads.erase( ithead );
+					}
+
+				m_roots.erase( it );
+			}
+
+		//! Find a root which covers a filter.
+		/*!
+		 * Returns nullptr if there is no such root.
+		 */
+		const std::string *
+		find_covering_root(
+			const std::string & topic_filter,
+			const splitted_topic_name_t & fragments ) const
+			{
+				for( const auto & head : { fragments.front(),
+						std::string{ "+" }, std::string{ "#" } } )
+					{
+						auto ithead = m_heads.find( head );
+						if( ithead == m_heads.end() )
+							continue;
+
+						for( const auto & name : ithead->second )
+							if( name != topic_filter &&
+									topic_filter_covers(
+											m_roots.find( name )->second.m_fragments,
+											fragments ) )
+								return &name;
+					}
+
+				return nullptr;
+			}
+
+		void
+		attach_to_root(
+			const std::string & topic_filter,
+			const std::string & root_name )
+			{
+				m_roots.find( root_name )->second.m_covered.insert( topic_filter );
+				m_covered[ topic_filter ] = root_name;
+			}
+	};
+
+inline subscriptions_cover_t::actions_t
+subscriptions_cover_t::insert( const std::string & topic_filter )
+	{
+		actions_t result;
+
+		if( is_root( topic_filter ) ||
+				m_covered.end() != m_covered.find( topic_filter ) )
+			return result;
+
+		if( !is_shared_subscription( topic_filter ) )
+			{
+				const auto fragments = split_topic_name( topic_filter );
+				if( const auto * root = find_covering_root(
+						topic_filter, fragments ) )
+					{
+						attach_to_root( topic_filter, *root );
+						return result;
+					}
+			}
+
+		auto & new_root = add_root( topic_filter );
+		result.m_subscribe.push_back( topic_filter );
+
+		if( !new_root.m_can_cover )
+			return result;
+
+		// Roots covered by the new root must become covered filters.
+		std::vector< std::string > demoted;
+		const auto & head = new_root.m_fragments.front();
+		for( const auto & h : m_heads )
+			if( is_wildcard( head ) || h.first == head )
+				for( const auto & name : h.second )
+					if( name != topic_filter &&
+							topic_filter_covers(
+									new_root.m_fragments,
+									m_roots.find( name )->second.m_fragments ) )
+						demoted.push_back( name );
+
+		for( const auto & name : demoted )
+			{
+				auto it = m_roots.find( name );
+				for( const auto & c : it->second.m_covered )
+					attach_to_root( c, topic_filter );
+				remove_root( it );
+
+				attach_to_root( name, topic_filter );
+				result.m_unsubscribe.push_back( name );
+			}
+
+		return result;
+	}
+
+inline subscriptions_cover_t::actions_t
+subscriptions_cover_t::erase( const std::string & topic_filter )
+	{
+		actions_t result;
+
+		auto itcovered = m_covered.find( topic_filter );
+		if( itcovered != m_covered.end() )
+			{
+				m_roots.find( itcovered->second )->second.m_covered.erase(
+						topic_filter );
+				m_covered.erase( itcovered );
+				return result;
+			}
+
+		auto itroot = m_roots.find( topic_filter );
+		if( itroot == m_roots.end() )
+			return result;
+
+		const auto orphans = std::move( itroot->second.m_covered );
+		remove_root( itroot );
+		result.m_unsubscribe.push_back( topic_filter );
+
+		// Orphans must be covered by other roots or become roots.
+		std::vector< std::pair< std::string, splitted_topic_name_t > > pending;
+		for( const auto & o : orphans )
+			{
+				m_covered.erase( o );
+
+				auto fragments = split_topic_name( o );
+				if( const auto * root = find_covering_root( o, fragments ) )
+					attach_to_root( o, *root );
+				else
+					pending.emplace_back( o, std::move(fragments) );
+			}
+
+		while( !pending.empty() )
+			{
+				// The widest of pending filters must become a new root.
+				auto itwidest = pending.begin();
+				for( auto it = pending.begin(); it != pending.end(); ++it )
+					if( topic_filter_covers( it->second, itwidest->second ) )
+						itwidest = it;
+
+				const auto new_root_name = itwidest->first;
+				const auto new_root_fragments = itwidest->second;
+				pending.erase( itwidest );
+
+				add_root( new_root_name );
+				result.m_subscribe.push_back( new_root_name );
+
+				auto itrest = std::remove_if( pending.begin(), pending.end(),
+						[&]( const auto & p ) {
+							if( topic_filter_covers( new_root_fragments, p.second ) )
+								{
+									attach_to_root( p.first, new_root_name );
+									return true;
+								}
+							return false;
+						} );
+				pending.erase( itrest, pending.end() );
+			}
+
+		return result;
+	}
+
+} /* namespace impl */
+
+} /* namespace mosquitto_transport */
@@ -11,11 +11,14 @@
 
 #pragma once
 
+#include <mosquitto_transport/topic_params.hpp>
+
 #include <mosquitto_transport/impl/fragments_extractor.hpp>
 
 #include <boost/container/flat_set.hpp>
 #include <boost/container/map.hpp>
 
+#include <algorithm>
 #include <iterator>
 
 namespace mosquitto_transport {
@@ -41,6 +44,17 @@ class subscriptions_map_t
 	public :
 		using postman_type = POSTMAN;
 
+		//! Postman with parts of topic name matched by wildcards.
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		struct match_t
+			{
+				POSTMAN m_postman;
+				topic_params_t m_params;
+			};
+
 		subscriptions_map_t()
 			{}
 
@@ -52,6 +66,15 @@ class subscriptions_map_t
 		std::vector< POSTMAN >
 		match( const std::string & topic_name ) const;
 
+		//! Find postmans and record parts of \a topic_name matched
+		//! by '+' and '#' of their topic filters.
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		std::vector< match_t >
+		match_with_params( const std::string & topic_name ) const;
+
 		void
 		erase(
 			const std::string & topic_filter,
@@ -97,6 +120,20 @@ class subscriptions_map_t
 				const fragments_extractor_t fragments,
 				std::vector< POSTMAN > & result );
 
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		static void
+		collect_matches(
+				const tree_item_t * root,
+				const fragments_extractor_t fragments,
+				//! Offset of the current fragment in topic name.
+				std::size_t offset,
+				std::size_t topic_size,
+				topic_params_t & params,
+				std::vector< match_t > & result );
+
 		static typename tree_item_t::remove_action_t
 		remove_subscription(
 			tree_item_t * root,
@@ -169,6 +206,23 @@ subscriptions_map_t< POSTMAN >::match( const std::string & topic_name ) const
 		return result;
 	}
 
+template< typename POSTMAN >
+std::vector< typename subscriptions_map_t< POSTMAN >::match_t >
+subscriptions_map_t< POSTMAN >::match_with_params(
+	const std::string & topic_name ) const
+	{
+		std::vector< match_t > result;
+		topic_params_t params;
+		collect_matches(
+				&m_root,
+				fragments_extractor_t{ split_topic_name( topic_name ) },
+				0u,
+				topic_name.size(),
+				params,
+				result );
+		return result;
+	}
+
 template< typename POSTMAN >
 void
 subscriptions_map_t< POSTMAN >::erase(
@@ -232,7 +286,7 @@ subscriptions_map_t< POSTMAN >::collect_postmans(
 	{
 		if( !fragments )
 			// All postmans from the current node must go to result.
-			copy( begin(root->m_postmans), end(root->m_postmans),
+			std::copy( begin(root->m_postmans), end(root->m_postmans),
 					back_inserter(result) );
 		else
 			{
@@ -258,10 +312,69 @@ subscriptions_map_t< POSTMAN >::collect_postmans(
 		// This behaviour is necessary for handling cases like:
 		// topic_filter is 'foo/#', topic_name is 'foo'.
 		// In this case '#' must match parent segment (e.g. 'foo').
-		copy( begin(root->m_grid_postmans), end(root->m_grid_postmans),
+		std::copy( begin(root->m_grid_postmans), end(root->m_grid_postmans),
 				back_inserter(result) );
 	}
 
+template< typename POSTMAN >
+void
+subscriptions_map_t< POSTMAN >::collect_matches(
+	const tree_item_t * root,
+	const fragments_extractor_t fragments,
+	std::size_t offset,
+	std::size_t topic_size,
+	topic_params_t & params,
+	std::vector< match_t > & result )
+	{
+		// The same traversal as in collect_postmans() but with
+		// recording of fragments matched by wildcards.
+		if( !fragments )
+			for( const auto & p : root->m_postmans )
+				result.push_back( match_t{ p, params } );
+		else
+			{
+				const auto next_offset = offset + (*fragments).size() + 1u;
+
+				auto itchild = root->m_children.find( *fragments );
+				if( itchild != root->m_children.end() )
+					{
+						collect_matches(
+								&(itchild->second),
+								fragments.next(),
+								next_offset,
+								topic_size,
+								params,
+								result );
+					}
+
+				if( root->m_plus_subtree )
+					{
+						params.push_back(
+								topic_param_t{ offset, (*fragments).size() } );
+						collect_matches(
+								root->m_plus_subtree.get(),
+								fragments.next(),
+								next_offset,
+								topic_size,
+								params,
+								result );
+						params.pop_back();
+					}
+			}
+
+		if( !root->m_grid_postmans.empty() )
+			{
+				// If '#' matches the parent segment the offset is
+				// beyond the end of topic name.
+				const auto rest_offset = std::min( offset, topic_size );
+				params.push_back(
+						topic_param_t{ rest_offset, topic_size - rest_offset } );
+				for( const auto & p : root->m_grid_postmans )
+					result.push_back( match_t{ p, params } );
+				params.pop_back();
+			}
+	}
+
 template< typename POSTMAN >
 typename subscriptions_map_t< POSTMAN >::tree_item_t::remove_action_t
 subscriptions_map_t< POSTMAN >::remove_subscription(
@@ -0,0 +1,155 @@
+/*
+ * mosquitto_transport
+ */
+
+/*!
+ * \file
+ * \brief Rate limiting and sampling of messages for every topic.
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace mosquitto_transport {
+
+namespace impl {
+
+//
+// topic_throttle_t
+//
+/*!
+ * \brief Decides which messages of every concrete topic must be delivered.
+ *
+ * Every Nth message of a topic is selected (starting from the first one).
+ * A selected message is accepted if there were no accepted messages for
+ * the same topic during the last \a min_interval.
+ *
+ * The state for a topic is created when the first message for it arrives.
+ * States of topics without messages during the idle timeout (but not less
+ * than \a min_interval) are removed by a sweep which is performed not more
+ * often than once per idle timeout. Rate limiting isn't affected by that.
+ * Sampling of a removed topic starts from the beginning: the next message
+ * for it is selected.
+ *
+ * \note This class is not thread safe.
+ */
+class topic_throttle_t
+	{
+	public :
+		using clock_type = std::chrono::steady_clock;
+
+		topic_throttle_t(
+			//! Min interval between accepted messages of one topic.
+			//! Zero means no limit.
+			clock_type::duration min_interval,
+			//! Only every Nth message of one topic is accepted.
+			//! Zero and one mean that every message is accepted.
+			std::uint32_t sample_every,
+			//! Time after which the state of a topic without messages
+			//! can be removed.
+			clock_type::duration idle_timeout = std::chrono::minutes{1} )
+			:	m_min_interval{ min_interval }
+			,	m_sample_every{ sample_every > 1u ? sample_every : 1u }
+			,	m_idle_timeout{ std::max( idle_timeout, min_interval ) }
+			{}
+
+		//! Does the throttle drop anything?
+		bool
+		enabled() const
+			{
+				return clock_type::duration::zero() != m_min_interval ||
+						1u != m_sample_every;
+			}
+
+		//! Should a message for \a topic_name be delivered?
+		bool
+		accept( const std::string & topic_name, clock_type::time_point now )
+			{
+				if( !enabled() )
+					return true;
+
+				remove_idle( now );
+
+				auto it = m_topics.find( topic_name );
+				if( it == m_topics.end() )
+					it = m_topics.emplace( topic_name, topic_state_t{} ).first;
+
+				auto & st = it->second;
+				st.m_last_seen = now;
+
+				const bool selected = 0u == st.m_counter;
+				if( ++st.m_counter == m_sample_every )
+					st.m_counter = 0u;
+				if( !selected )
+					return false;
+
+				if( st.m_has_accepted && now < st.m_next_allowed )
+					return false;
+
+				st.m_has_accepted = true;
+				st.m_next_allowed = now + m_min_interval;
+				return true;
+			}
+
+		//! Count of topics with state.
+		std::size_t
+		size() const { return m_topics.size(); }
+
+	private :
+		struct topic_state_t
+			{
+				clock_type::time_point m_next_allowed{};
+				//! Time of the last message for the topic.
+				clock_type::time_point m_last_seen{};
+				std::uint32_t m_counter{};
+				bool m_has_accepted{ false };
+			};
+
+		const clock_type::duration m_min_interval;
+		const std::uint32_t m_sample_every;
+		const clock_type::duration m_idle_timeout;
+
+		std::unordered_map< std::string, topic_state_t > m_topics;
+
+		//! Time of the next sweep of idle topics.
+		/*!
+		 * Is set by the first call to remove_idle().
+		 */
+		bool m_sweep_scheduled{ false };
+		clock_type::time_point m_next_sweep{};
+
+		void
+		remove_idle( clock_type::time_point now )
+			{
+				if( !m_sweep_scheduled )
+					{
+						m_sweep_scheduled = true;
+						m_next_sweep = now + m_idle_timeout;
+						return;
+					}
+
+				if( now < m_next_sweep )
+					return;
+
+				// The state of an idle topic doesn't limit the next message:
+				// its m_next_allowed is already passed.
+				for( auto it = m_topics.begin(); it != m_topics.end(); )
+					if( now - it->second.m_last_seen >= m_idle_timeout )
+						it = m_topics.erase( it );
+					else
+						++it;
+
+				m_next_sweep = now + m_idle_timeout;
+			}
+	};
+
+} /* namespace impl */
+
+} /* namespace mosquitto_transport */
@@ -0,0 +1,679 @@
+/*
+ * mosquitto_transport-1.0
+ */
+
+/*!
+ * \file
+ * \brief I/O dispatcher for serving connections of several transport managers.
+ * \since
+ * v.0.7.0
+ */
+
+#include <mosquitto_transport/io_dispatcher.hpp>
+#include <mosquitto_transport/tools.hpp>
+
+#include <fmt/format.h>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace mosquitto_transport {
+
+//
+// io_dispatcher_t
+//
+io_dispatcher_t::io_dispatcher_t() {}
+io_dispatcher_t::~io_dispatcher_t() {}
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+//! Period for calling mosquitto_loop_misc().
+const auto misc_period = std::chrono::seconds{1};
+
+//! Max count of events to be extracted by one epoll_wait() call.
+constexpr int max_events = 64;
+
+//! ID to be used for wakeup events.
+constexpr io_dispatcher_t::connection_id_t wakeup_id = 0u;
+
+//
+// connection_data_t
+//
+struct connection_data_t
+	{
+		mosquitto * m_mosq;
+		io_dispatcher_t::connection_lost_handler_t m_lost_handler;
+		io_dispatcher_t::reconnect_options_t m_reconnect_options;
+
+		//! Socket registered in epoll. -1 if there is no such socket.
+		int m_fd{ -1 };
+		//! Events for m_fd registered in epoll.
+		std::uint32_t m_events{};
+
+		//! Is connection lost and waiting for reconnection?
+		bool m_broken{ false };
+		//! Is reconnection attempt performed right now?
+		/*!
+		 * Reconnection is performed without holding the worker's lock.
+		 * The connection can't be detached while this flag is set.
+		 */
+		bool m_reconnecting{ false };
+		//! Is reading from the socket paused?
+		bool m_read_paused{ false };
+
+		//! Time for the next reconnection attempt.
+		clock_type::time_point m_reconnect_at;
+		//! Count of reconnection attempts since the connection loss.
+		unsigned int m_reconnect_attempts{};
+		//! Index of endpoint of the current connection.
+		std::size_t m_current_endpoint{};
+	};
+
+//
+// worker_t
+//
+/*!
+ * \brief Single thread with its own epoll instance.
+ */
+class worker_t
+	{
+	public :
+		worker_t()
+			:	m_epoll_fd{ epoll_create1( EPOLL_CLOEXEC ) }
+			,	m_wakeup_fd{ eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) }
+			{
+				if( -1 == m_epoll_fd || -1 == m_wakeup_fd )
+					{
+						const auto error_code = errno;
+						if( -1 != m_epoll_fd ) ::close( m_epoll_fd );
+						if( -1 != m_wakeup_fd ) ::close( m_wakeup_fd );
+
+						throw ex_t{ fmt::format(
+								"unable to create epoll or eventfd, errno: {}",
+								error_code ) };
+					}
+
+				epoll_event ev{};
+				ev.events = EPOLLIN;
+				ev.data.u64 = wakeup_id;
+				epoll_ctl( m_epoll_fd, EPOLL_CTL_ADD, m_wakeup_fd, &ev );
+			}
+
+		~worker_t()
+			{
+				::close( m_wakeup_fd );
+				::close( m_epoll_fd );
+			}
+
+		void
+		start()
+			{
+				m_thread = std::thread{ [this]{ body(); } };
+			}
+
+		void
+		shutdown()
+			{
+				m_shutdown.store( true, std::memory_order_release );
+				send_wakeup();
+				m_thread.join();
+			}
+
+		void
+		attach(
+			io_dispatcher_t::connection_id_t id,
+			mosquitto * mosq,
+			io_dispatcher_t::connection_lost_handler_t lost_handler,
+			io_dispatcher_t::reconnect_options_t reconnect_options )
+			{
+				{
+					std::lock_guard< std::mutex > lock{ m_lock };
+					auto & data = m_connections[ id ];
+					data.m_mosq = mosq;
+					data.m_lost_handler = std::move(lost_handler);
+					data.m_reconnect_options = std::move(reconnect_options);
+
+					std::lock_guard< std::mutex > pause_lock{ m_pause_lock };
+					m_attached.insert( id );
+				}
+				wakeup();
+			}
+
+		void
+		detach( io_dispatcher_t::connection_id_t id )
+			{
+				std::unique_lock< std::mutex > lock{ m_lock };
+
+				auto it = m_connections.find( id );
+				if( it == m_connections.end() )
+					return;
+
+				auto & data = it->second;
+				// mosquitto instance can be used by reconnection attempt
+				// at this moment.
+				m_reconnect_finished.wait( lock,
+						[&data]{ return !data.m_reconnecting; } );
+
+				// Last chance to send pending data (DISCONNECT for example).
+				if( !data.m_broken && -1 != mosquitto_socket( data.m_mosq ) &&
+						mosquitto_want_write( data.m_mosq ) )
+					mosquitto_loop_write( data.m_mosq, 1 );
+
+				deregister_socket( data );
+				m_connections.erase( it );
+
+				std::lock_guard< std::mutex > pause_lock{ m_pause_lock };
+				m_attached.erase( id );
+				m_paused.erase( id );
+			}
+
+		void
+		set_endpoints(
+			io_dispatcher_t::connection_id_t id,
+			std::vector< broker_endpoint_t > endpoints )
+			{
+				std::unique_lock< std::mutex > lock{ m_lock };
+
+				auto it = m_connections.find( id );
+				if( it == m_connections.end() )
+					return;
+
+				auto & data = it->second;
+				// Endpoints are used by reconnection attempt without the lock.
+				m_reconnect_finished.wait( lock,
+						[&data]{ return !data.m_reconnecting; } );
+
+				data.m_reconnect_options.m_endpoints = std::move(endpoints);
+				if( data.m_current_endpoint >=
+						data.m_reconnect_options.m_endpoints.size() )
+					data.m_current_endpoint = 0u;
+			}
+
+		void
+		set_reading_paused(
+			io_dispatcher_t::connection_id_t id,
+			bool paused )
+			{
+				// m_lock can't be used here because this method can be
+				// called from libmosquitto's callbacks on the worker's thread.
+				{
+					std::lock_guard< std::mutex > lock{ m_pause_lock };
+					if( m_attached.end() == m_attached.find( id ) )
+						// Unknown or already detached connection.
+						// Its state must not be kept.
+						return;
+
+					if( paused )
+						m_paused.insert( id );
+					else
+						m_paused.erase( id );
+				}
+				wakeup();
+			}
+
+		void
+		wakeup()
+			{
+				if( !m_wakeup_pending.exchange( true, std::memory_order_acq_rel ) )
+					send_wakeup();
+			}
+
+	private :
+		const int m_epoll_fd;
+		const int m_wakeup_fd;
+
+		std::thread m_thread;
+		std::atomic< bool > m_shutdown{ false };
+		std::atomic< bool > m_wakeup_pending{ false };
+
+		//! Protects m_connections and all actions with mosquitto instances.
+		std::mutex m_lock;
+		std::map< io_dispatcher_t::connection_id_t, connection_data_t >
+				m_connections;
+		//! Is notified when reconnection attempts are finished.
+		std::condition_variable m_reconnect_finished;
+
+		//! Protects m_attached and m_paused.
+		/*!
+		 * \note Must never be acquired before m_lock.
+		 */
+		std::mutex m_pause_lock;
+		//! IDs of attached connections.
+		/*!
+		 * Copy of keys of m_connections for set_reading_paused().
+		 */
+		std::set< io_dispatcher_t::connection_id_t > m_attached;
+		//! Connections with paused reading.
+		std::set< io_dispatcher_t::connection_id_t > m_paused;
+
+		//! Generator for jitter of reconnection delays.
+		std::mt19937 m_random_engine{ std::random_device{}() };
+
+		void
+		send_wakeup()
+			{
+				const std::uint64_t v = 1u;
+				// Result is ignored: if eventfd counter is already
+				// not zero the worker will be woken up anyway.
+				(void)::write( m_wakeup_fd, &v, sizeof(v) );
+			}
+
+		void
+		body()
+			{
+				epoll_event events[ max_events ];
+				std::vector< connection_data_t * > due_reconnects;
+				auto next_misc_at = clock_type::now() + misc_period;
+
+				auto next_reconnect_at = clock_type::time_point::max();
+
+				while( !m_shutdown.load( std::memory_order_acquire ) )
+					{
+						// Reconnection attempts can be more frequent than
+						// calls to mosquitto_loop_misc().
+						const auto timeout = std::chrono::duration_cast<
+								std::chrono::milliseconds >(
+										std::min( next_misc_at, next_reconnect_at ) -
+										clock_type::now() ).count();
+
+						const int n = epoll_wait( m_epoll_fd, events, max_events,
+								static_cast< int >( std::max< decltype(timeout) >(
+										0, timeout ) ) );
+
+						std::unique_lock< std::mutex > lock{ m_lock };
+
+						for( int i = 0; i < n; ++i )
+							handle_event( events[ i ] );
+
+						auto now = clock_type::now();
+						if( now >= next_misc_at )
+							{
+								handle_misc();
+								next_misc_at = now + misc_period;
+							}
+
+						collect_reconnects( now, due_reconnects );
+						if( !due_reconnects.empty() )
+							{
+								// mosquitto_connect_async() and
+								// mosquitto_reconnect_async() can block on
+								// the lookup of broker's name. attach(), detach()
+								// and set_reading_paused() must not wait for that.
+								lock.unlock();
+								const auto results = perform_reconnects(
+										due_reconnects );
+								lock.lock();
+
+								now = clock_type::now();
+								finish_reconnects( now, due_reconnects, results );
+							}
+
+						sync_registrations( now );
+
+						next_reconnect_at = nearest_reconnect();
+					}
+			}
+
+		void
+		handle_event( const epoll_event & ev )
+			{
+				if( wakeup_id == ev.data.u64 )
+					{
+						std::uint64_t v;
+						(void)::read( m_wakeup_fd, &v, sizeof(v) );
+						m_wakeup_pending.store( false, std::memory_order_release );
+						return;
+					}
+
+				// Connection can be detached after return from epoll_wait().
+				auto it = m_connections.find( ev.data.u64 );
+				if( it == m_connections.end() || it->second.m_broken )
+					return;
+
+				auto & data = it->second;
+				int rc = MOSQ_ERR_SUCCESS;
+				// Reading could be paused after return from epoll_wait().
+				// Errors must be handled anyway.
+				if( (!data.m_read_paused && (ev.events & EPOLLIN)) ||
+						(ev.events & (EPOLLERR | EPOLLHUP)) )
+					rc = mosquitto_loop_read( data.m_mosq, 1 );
+				if( MOSQ_ERR_SUCCESS == rc && (ev.events & EPOLLOUT) )
+					rc = mosquitto_loop_write( data.m_mosq, 1 );
+
+				if( MOSQ_ERR_SUCCESS != rc )
+					{
+						// libmosquitto has already closed the socket and
+						// called its on_disconnect callback.
+						connection_broken( data, clock_type::now() );
+						data.m_lost_handler( rc );
+					}
+				else if( !data.m_read_paused && (ev.events & EPOLLIN) )
+					// Something is received from the broker. It means that
+					// connection is really established.
+					data.m_reconnect_attempts = 0u;
+			}
+
+		void
+		handle_misc()
+			{
+				for( auto & c : m_connections )
+					if( !c.second.m_broken )
+						mosquitto_loop_misc( c.second.m_mosq );
+			}
+
+		//! Find broken connections for which it is time to reconnect.
+		/*!
+		 * Found connections are marked as being reconnected. They can't
+		 * be detached until finish_reconnects() is called.
+		 *
+		 * \note Must be called with m_lock acquired.
+		 */
+		void
+		collect_reconnects(
+			clock_type::time_point now,
+			std::vector< connection_data_t * > & due )
+			{
+				due.clear();
+				for( auto & c : m_connections )
+					{
+						auto & data = c.second;
+						if( data.m_broken && now >= data.m_reconnect_at )
+							{
+								data.m_reconnecting = true;
+								due.push_back( &data );
+							}
+					}
+			}
+
+		//! Make reconnection attempts.
+		/*!
+		 * \note Must be called without m_lock.
+		 */
+		std::vector< int >
+		perform_reconnects( const std::vector< connection_data_t * > & due )
+			{
+				std::vector< int > results;
+				results.reserve( due.size() );
+				for( auto * data : due )
+					results.push_back( reconnect( *data ) );
+
+				return results;
+			}
+
+		//! Handle results of reconnection attempts.
+		/*!
+		 * \note Must be called with m_lock acquired.
+		 */
+		void
+		finish_reconnects(
+			clock_type::time_point now,
+			const std::vector< connection_data_t * > & due,
+			const std::vector< int > & results )
+			{
+				for( std::size_t i = 0; i != due.size(); ++i )
+					{
+						auto & data = *(due[ i ]);
+						data.m_reconnecting = false;
+						if( MOSQ_ERR_SUCCESS == results[ i ] )
+							data.m_broken = false;
+						else
+							data.m_reconnect_at = now + reconnect_delay( data );
+					}
+
+				m_reconnect_finished.notify_all();
+			}
+
+		//! Time of the nearest reconnection attempt.
+		clock_type::time_point
+		nearest_reconnect() const
+			{
+				auto nearest = clock_type::time_point::max();
+				for( const auto & c : m_connections )
+					if( c.second.m_broken )
+						nearest = std::min( nearest, c.second.m_reconnect_at );
+
+				return nearest;
+			}
+
+		int
+		reconnect( connection_data_t & data )
+			{
+				const auto & endpoints = data.m_reconnect_options.m_endpoints;
+				const auto attempt = data.m_reconnect_attempts++;
+
+				if( endpoints.empty() )
+					return mosquitto_reconnect_async( data.m_mosq );
+
+				// The first attempt goes to the current broker.
+				// Next attempts go to other brokers.
+				// The address of the broker could be changed by set_endpoints(),
+				// so mosquitto_reconnect_async() can't be used.
+				if( 0u != attempt )
+					data.m_current_endpoint =
+							(data.m_current_endpoint + 1u) % endpoints.size();
+
+				const auto & ep = endpoints[ data.m_current_endpoint ];
+				return mosquitto_connect_async( data.m_mosq,
+						ep.m_host.c_str(),
+						static_cast< int >( ep.m_port ),
+						static_cast< int >( data.m_reconnect_options.m_keepalive ) );
+			}
+
+		clock_type::duration
+		reconnect_delay( const connection_data_t & data )
+			{
+				const auto & params = data.m_reconnect_options.m_reconnect;
+
+				double delay = static_cast< double >(
+						params.m_initial_delay.count() );
+				if( params.m_exponential_backoff && data.m_reconnect_attempts )
+					delay *= std::pow( 2.0,
+							static_cast< double >( data.m_reconnect_attempts ) );
+				delay = std::min( delay,
+						static_cast< double >( params.m_max_delay.count() ) );
+
+				if( params.m_jitter > 0.0 )
+					{
+						std::uniform_real_distribution< double > jitter{
+								1.0 - params.m_jitter, 1.0 + params.m_jitter };
+						delay *= jitter( m_random_engine );
+					}
+
+				return clock_type::duration{
+						static_cast< clock_type::duration::rep >( delay ) };
+			}
+
+		void
+		sync_registrations( clock_type::time_point now )
+			{
+				{
+					std::lock_guard< std::mutex > pause_lock{ m_pause_lock };
+					for( auto & c : m_connections )
+						c.second.m_read_paused =
+								m_paused.end() != m_paused.find( c.first );
+				}
+
+				for( auto & c : m_connections )
+					{
+						auto & data = c.second;
+						if( data.m_broken )
+							continue;
+
+						const int fd = mosquitto_socket( data.m_mosq );
+						if( -1 == fd )
+							{
+								// Socket was closed by libmosquitto itself
+								// (keep-alive failure for example). Disconnection
+								// callback is already called in that case.
+								connection_broken( data, now );
+								continue;
+							}
+
+						const std::uint32_t events =
+								(data.m_read_paused ? 0u : EPOLLIN) |
+								(mosquitto_want_write( data.m_mosq ) ? EPOLLOUT : 0u);
+
+						if( fd != data.m_fd )
+							{
+								deregister_socket( data );
+
+								epoll_event ev{};
+								ev.events = events;
+								ev.data.u64 = c.first;
+								if( 0 == epoll_ctl( m_epoll_fd, EPOLL_CTL_ADD, fd, &ev ) )
+									{
+										data.m_fd = fd;
+										data.m_events = events;
+									}
+							}
+						else if( events != data.m_events )
+							{
+								epoll_event ev{};
+								ev.events = events;
+								ev.data.u64 = c.first;
+								epoll_ctl( m_epoll_fd, EPOLL_CTL_MOD, fd, &ev );
+								data.m_events = events;
+							}
+					}
+			}
+
+		void
+		connection_broken(
+			connection_data_t & data,
+			clock_type::time_point now )
+			{
+				deregister_socket( data );
+				data.m_broken = true;
+				data.m_reconnect_at = now + reconnect_delay( data );
+			}
+
+		void
+		deregister_socket( connection_data_t & data )
+			{
+				if( -1 == data.m_fd )
+					return;
+
+				// Socket could be closed and its descriptor could be reused
+				// by another connection of this worker. It must not be
+				// removed from epoll in that case.
+				const bool reused = std::any_of(
+						m_connections.begin(), m_connections.end(),
+						[&]( const auto & c ) {
+							return &(c.second) != &data && c.second.m_fd == data.m_fd;
+						} );
+				if( !reused )
+					epoll_ctl( m_epoll_fd, EPOLL_CTL_DEL, data.m_fd, nullptr );
+
+				data.m_fd = -1;
+				data.m_events = 0u;
+			}
+	};
+
+//
+// epoll_io_dispatcher_t
+//
+class epoll_io_dispatcher_t : public io_dispatcher_t
+	{
+	public :
+		epoll_io_dispatcher_t( unsigned int thread_count )
+			{
+				m_workers.reserve( thread_count );
+				for( unsigned int i = 0; i != thread_count; ++i )
+					m_workers.emplace_back( std::make_unique< worker_t >() );
+
+				for( auto & w : m_workers )
+					w->start();
+			}
+
+		~epoll_io_dispatcher_t()
+			{
+				for( auto & w : m_workers )
+					w->shutdown();
+			}
+
+		virtual connection_id_t
+		attach(
+			mosquitto * mosq,
+			connection_lost_handler_t lost_handler,
+			reconnect_options_t reconnect_options ) override
+			{
+				const auto id = ++m_last_id;
+
+				// Mutexes inside libmosquitto must be used because
+				// the instance is accessed from different threads.
+				mosquitto_threaded_set( mosq, true );
+
+				worker_for( id ).attach( id, mosq, std::move(lost_handler),
+						std::move(reconnect_options) );
+
+				return id;
+			}
+
+		virtual void
+		detach( connection_id_t id ) override
+			{
+				worker_for( id ).detach( id );
+			}
+
+		virtual void
+		set_endpoints(
+			connection_id_t id,
+			std::vector< broker_endpoint_t > endpoints ) override
+			{
+				worker_for( id ).set_endpoints( id, std::move(endpoints) );
+			}
+
+		virtual void
+		wakeup( connection_id_t id ) override
+			{
+				worker_for( id ).wakeup();
+			}
+
+		virtual void
+		set_reading_paused( connection_id_t id, bool paused ) override
+			{
+				worker_for( id ).set_reading_paused( id, paused );
+			}
+
+	private :
+		std::vector< std::unique_ptr< worker_t > > m_workers;
+
+		std::atomic< connection_id_t > m_last_id{ wakeup_id };
+
+		worker_t &
+		worker_for( connection_id_t id )
+			{
+				return *(m_workers[ id % m_workers.size() ]);
+			}
+	};
+
+} /* namespace anonymous */
+
+//
+// make_epoll_io_dispatcher
+//
+io_dispatcher_handle_t
+make_epoll_io_dispatcher( unsigned int thread_count )
+	{
+		ensure_with_explblock< ex_t >( 0u != thread_count,
+			[]{ return "thread_count for io_dispatcher must be greater than 0"; } );
+
+		return std::make_shared< epoll_io_dispatcher_t >( thread_count );
+	}
+
+} /* namespace mosquitto_transport */
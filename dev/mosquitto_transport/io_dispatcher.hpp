@@ -0,0 +1,190 @@
+/*
+ * mosquitto_transport-1.0
+ */
+
+/*!
+ * \file
+ * \brief I/O dispatcher for serving connections of several transport managers.
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <mosquitto_transport/connection_params.hpp>
+
+#include <mosquitto.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace mosquitto_transport {
+
+//
+// io_dispatcher_t
+//
+/*!
+ * \brief Interface of I/O dispatcher.
+ *
+ * I/O dispatcher performs all I/O operations for several mosquitto
+ * instances on a small set of its own threads. It is used instead of
+ * mosquitto_loop_start() which creates a separate thread for every
+ * mosquitto instance.
+ *
+ * An instance of I/O dispatcher can be shared between any number of
+ * transport managers (see a_transport_manager_t::set_io_dispatcher()).
+ *
+ * \note All methods of I/O dispatcher are thread safe.
+ */
+class io_dispatcher_t
+	{
+	public :
+		//! Type of ID of a connection served by I/O dispatcher.
+		using connection_id_t = std::uint64_t;
+
+		//! Type of handler to be called when connection is lost.
+		/*!
+		 * Receives the return code of mosquitto_loop_read() or
+		 * mosquitto_loop_write().
+		 *
+		 * \attention This handler is called on the context of I/O
+		 * dispatcher's thread. It must not block.
+		 *
+		 * \attention libmosquitto calls its on_disconnect callback
+		 * before this handler. The loss of connection must not be
+		 * reported by this handler one more time.
+		 */
+		using connection_lost_handler_t = std::function< void(int) >;
+
+		//! Parameters for reconnection of a mosquitto instance.
+		struct reconnect_options_t
+			{
+				//! Brokers for reconnection attempts.
+				/*!
+				 * If there are several endpoints then reconnection is
+				 * made via mosquitto_connect_async(): the first attempt
+				 * goes to the current endpoint, the next ones go to
+				 * other endpoints in round-robin order.
+				 *
+				 * If this list contains only one endpoint then every attempt
+				 * goes to it via mosquitto_connect_async(). If this list is
+				 * empty then mosquitto_reconnect_async() is used.
+				 *
+				 * \note Reconnection attempts are made on I/O dispatcher's
+				 * thread but without holding its internal lock. A lookup of
+				 * broker's name doesn't block attach(), detach() and
+				 * other methods, but other connections served by the same
+				 * thread wait for it. Because of that endpoints should
+				 * contain numeric addresses.
+				 */
+				std::vector< broker_endpoint_t > m_endpoints;
+				//! Keepalive for mosquitto_connect_async().
+				unsigned int m_keepalive = 30;
+				//! Delays between attempts.
+				reconnect_params_t m_reconnect;
+			};
+
+		io_dispatcher_t( const io_dispatcher_t & ) = delete;
+		io_dispatcher_t( io_dispatcher_t && ) = delete;
+
+		io_dispatcher_t();
+		virtual ~io_dispatcher_t();
+
+		//! Start serving of a mosquitto instance.
+		/*!
+		 * \attention A connection for \a mosq must be initiated by
+		 * mosquitto_connect_async() before call to attach().
+		 * I/O dispatcher will reconnect \a mosq if connection is lost.
+		 */
+		virtual connection_id_t
+		attach(
+			mosquitto * mosq,
+			connection_lost_handler_t lost_handler,
+			reconnect_options_t reconnect_options ) = 0;
+
+		//! Stop serving of a mosquitto instance.
+		/*!
+		 * Pending outgoing data for the connection will be written
+		 * if it is possible to do that without blocking.
+		 *
+		 * After return from detach() there is no any activity for
+		 * the connection on I/O dispatcher's threads.
+		 *
+		 * \note If a reconnection attempt for the connection is in
+		 * progress detach() waits for its completion.
+		 */
+		virtual void
+		detach( connection_id_t id ) = 0;
+
+		//! Replace brokers for the next reconnection attempts.
+		/*!
+		 * Is used when addresses of brokers are resolved again.
+		 *
+		 * \note Is ignored if there is no attached connection with \a id.
+		 *
+		 * \note If a reconnection attempt for the connection is in
+		 * progress this method waits for its completion.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		virtual void
+		set_endpoints(
+			connection_id_t id,
+			std::vector< broker_endpoint_t > endpoints ) = 0;
+
+		//! Inform I/O dispatcher that there is new outgoing data for
+		//! the connection.
+		/*!
+		 * Must be called after mosquitto_publish(), mosquitto_subscribe()
+		 * and similar calls.
+		 */
+		virtual void
+		wakeup( connection_id_t id ) = 0;
+
+		//! Stop or resume reading from the connection's socket.
+		/*!
+		 * While reading is paused incoming data stays in the socket's
+		 * buffer and TCP flow control slows down the broker.
+		 *
+		 * \attention libmosquitto doesn't receive PINGRESP while reading
+		 * is paused. If reading is paused for more than keepalive interval
+		 * the connection will be closed by libmosquitto.
+		 *
+		 * \note Can be called from any thread including callbacks of
+		 * libmosquitto.
+		 *
+		 * \note Is ignored if there is no attached connection with \a id.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		virtual void
+		set_reading_paused( connection_id_t id, bool paused ) = 0;
+	};
+
+/*!
+ * \brief Alias of shared_ptr for I/O dispatcher.
+ */
+using io_dispatcher_handle_t = std::shared_ptr< io_dispatcher_t >;
+
+//
+// make_epoll_io_dispatcher
+//
+/*!
+ * \brief Create an I/O dispatcher based on epoll.
+ *
+ * Connections are distributed between \a thread_count threads.
+ * Threads are started immediately and stopped when the last handle
+ * to I/O dispatcher is destroyed.
+ *
+ * \note This I/O dispatcher is available on Linux only.
+ *
+ * \throw ex_t if epoll or eventfd can't be created.
+ */
+io_dispatcher_handle_t
+make_epoll_io_dispatcher( unsigned int thread_count = 1u );
+
+} /* namespace mosquitto_transport */
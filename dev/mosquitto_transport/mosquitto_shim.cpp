@@ -0,0 +1,110 @@
+/*
+ * mosquitto_transport-1.0
+ */
+
+/*!
+ * \file
+ * \brief The only place where internal API of libmosquitto is used.
+ * \since
+ * v.0.7.0
+ */
+
+#include <mosquitto_transport/impl/mosquitto_shim.hpp>
+
+#include <cstdint>
+#include <cstring>
+
+// Internal headers of libmosquitto.
+extern "C" {
+#include <mosquitto_internal.h>
+#include <memory_mosq.h>
+#include <mqtt3_protocol.h>
+#include <net_mosq.h>
+#include <util_mosq.h>
+}
+
+#if LIBMOSQUITTO_MAJOR != 1 || LIBMOSQUITTO_MINOR != 4
+	#error "mosquitto_shim.cpp supports internal API of libmosquitto v.1.4 only"
+#endif
+
+namespace mosquitto_transport {
+
+namespace impl {
+
+//
+// subscribe_multiple
+//
+int
+subscribe_multiple(
+	mosquitto * mosq,
+	int * mid,
+	const std::vector< char * > & topic_filters,
+	int qos )
+	{
+		if( !mosq || topic_filters.empty() )
+			return MOSQ_ERR_INVAL;
+		if( -1 == mosquitto_socket( mosq ) )
+			return MOSQ_ERR_NO_CONN;
+
+		// Message ID and then length, text and requested QoS of every filter.
+		std::uint32_t remaining_length = 2u;
+		for( const char * filter : topic_filters )
+			{
+				const auto length = std::strlen( filter );
+				if( length > 0xFFFFu ||
+						MOSQ_ERR_SUCCESS != mosquitto_sub_topic_check( filter ) )
+					return MOSQ_ERR_INVAL;
+				remaining_length += static_cast< std::uint32_t >( 2u + length + 1u );
+			}
+
+		auto packet = static_cast< _mosquitto_packet * >(
+				_mosquitto_calloc( 1, sizeof( _mosquitto_packet ) ) );
+		if( !packet )
+			return MOSQ_ERR_NOMEM;
+
+		// Bit 1 of SUBSCRIBE's fixed header is reserved and must be set.
+		packet->command = SUBSCRIBE | (1 << 1);
+		packet->remaining_length = remaining_length;
+		const int rc = _mosquitto_packet_alloc( packet );
+		if( MOSQ_ERR_SUCCESS != rc )
+			{
+				_mosquitto_free( packet );
+				return rc;
+			}
+
+		const auto local_mid = _mosquitto_mid_generate( mosq );
+		if( mid )
+			*mid = static_cast< int >( local_mid );
+		_mosquitto_write_uint16( packet, local_mid );
+
+		for( const char * filter : topic_filters )
+			{
+				_mosquitto_write_string( packet, filter,
+						static_cast< std::uint16_t >( std::strlen( filter ) ) );
+				_mosquitto_write_byte( packet, static_cast< std::uint8_t >( qos ) );
+			}
+
+		// The packet is owned by mosq from now.
+		return _mosquitto_packet_queue( mosq, packet );
+	}
+
+//
+// connack_session_present
+//
+bool
+connack_session_present( mosquitto * mosq )
+	{
+		// The connect callback is called by _mosquitto_handle_connack()
+		// before the packet is cleaned up. The first byte of variable
+		// header contains 'session present' flag in bit 0.
+		const auto & packet = mosq->in_packet;
+
+		return CONNACK == ( packet.command & 0xF0 ) &&
+				2u <= packet.remaining_length &&
+				nullptr != packet.payload &&
+				0 != ( packet.payload[ 0 ] & 0x01 );
+	}
+
+} /* namespace impl */
+
+} /* namespace mosquitto_transport */
@@ -0,0 +1,115 @@
+/*
+ * mosquitto_transport-1.0
+ */
+
+/*!
+ * \file
+ * \brief Filters for payloads of incoming messages.
+ * \since
+ * v.0.7.0
+ */
+
+#include <mosquitto_transport/payload_filter.hpp>
+#include <mosquitto_transport/tools.hpp>
+
+#include <fmt/format.h>
+
+namespace mosquitto_transport {
+
+//
+// payload_filter_t
+//
+payload_filter_t::~payload_filter_t() {}
+
+namespace details {
+
+//
+// prefix_payload_filter_t
+//
+class prefix_payload_filter_t : public payload_filter_t
+	{
+		const std::string m_prefix;
+
+	public :
+		prefix_payload_filter_t( std::string prefix )
+			:	m_prefix{ std::move(prefix) }
+			{}
+
+		virtual bool
+		accept( string_view_t payload ) const override
+			{
+				return payload.starts_with( m_prefix );
+			}
+	};
+
+//
+// byte_mask_payload_filter_t
+//
+class byte_mask_payload_filter_t : public payload_filter_t
+	{
+		const std::size_t m_offset;
+		const std::string m_mask;
+		//! Expected bytes with the mask already applied.
+		std::string m_expected;
+
+	public :
+		byte_mask_payload_filter_t(
+			std::size_t offset,
+			std::string mask,
+			std::string expected )
+			:	m_offset{ offset }
+			,	m_mask{ std::move(mask) }
+			,	m_expected{ std::move(expected) }
+			{
+				for( std::size_t i = 0; i != m_mask.size(); ++i )
+					m_expected[ i ] = static_cast< char >(
+							m_expected[ i ] & m_mask[ i ] );
+			}
+
+		virtual bool
+		accept( string_view_t payload ) const override
+			{
+				if( payload.size() < m_offset ||
+						payload.size() - m_offset < m_mask.size() )
+					return false;
+
+				for( std::size_t i = 0; i != m_mask.size(); ++i )
+					if( ( payload[ m_offset + i ] & m_mask[ i ] ) != m_expected[ i ] )
+						return false;
+
+				return true;
+			}
+	};
+
+} /* namespace details */
+
+//
+// make_prefix_filter
+//
+payload_filter_shared_ptr_t
+make_prefix_filter( std::string prefix )
+	{
+		return std::make_shared< details::prefix_payload_filter_t >(
+				std::move(prefix) );
+	}
+
+//
+// make_byte_mask_filter
+//
+payload_filter_shared_ptr_t
+make_byte_mask_filter(
+	std::size_t offset,
+	std::string mask,
+	std::string expected )
+	{
+		ensure_with_explblock< ex_t >( mask.size() == expected.size(), [&]{
+				return fmt::format( "sizes of mask and expected bytes differ, "
+						"mask_size={}, expected_size={}",
+						mask.size(), expected.size() );
+			} );
+
+		return std::make_shared< details::byte_mask_payload_filter_t >(
+				offset, std::move(mask), std::move(expected) );
+	}
+
+} /* namespace mosquitto_transport */
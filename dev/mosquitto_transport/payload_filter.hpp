@@ -0,0 +1,121 @@
+/*
+ * mosquitto_transport-1.0
+ */
+
+/*!
+ * \file
+ * \brief Filters for payloads of incoming messages.
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <mosquitto_transport/string_view.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace mosquitto_transport {
+
+//
+// payload_filter_t
+//
+/*!
+ * \brief Interface of a predicate for payloads of incoming messages.
+ *
+ * Filters are evaluated by transport manager before an incoming message
+ * is copied for a subscriber. If several subscriptions use the same filter
+ * object it is evaluated only once for every incoming message (even if
+ * the subscriptions have different topic filters). The exception is
+ * parallel delivery (see a_transport_manager_t::set_fan_out()): every
+ * chunk of postmans served on another thread evaluates filters again.
+ *
+ * \attention accept() is called on several threads at the same time.
+ * It must not block and must not throw.
+ *
+ * \see subscription_options_t::m_payload_filter.
+ */
+struct payload_filter_t
+	{
+		virtual ~payload_filter_t();
+
+		virtual bool
+		accept( string_view_t payload ) const = 0;
+	};
+
+/*!
+ * \brief Alias of shared_ptr for payload filter.
+ */
+using payload_filter_shared_ptr_t = std::shared_ptr< const payload_filter_t >;
+
+//
+// make_prefix_filter
+//
+/*!
+ * \brief Create a filter which accepts payloads started with \a prefix.
+ */
+payload_filter_shared_ptr_t
+make_prefix_filter( std::string prefix );
+
+//
+// make_byte_mask_filter
+//
+/*!
+ * \brief Create a filter which checks bytes of payloads by mask.
+ *
+ * A payload is accepted if
+ * (payload[offset + i] & mask[i]) == (expected[i] & mask[i])
+ * for every i in mask. Payloads shorter than offset + mask.size()
+ * are not accepted.
+ *
+ * \throw ex_t if sizes of \a mask and \a expected differ.
+ */
+payload_filter_shared_ptr_t
+make_byte_mask_filter(
+	std::size_t offset,
+	std::string mask,
+	std::string expected );
+
+namespace details {
+
+//
+// functor_payload_filter_t
+//
+template< typename FUNCTOR >
+class functor_payload_filter_t : public payload_filter_t
+	{
+		const FUNCTOR m_functor;
+
+	public :
+		functor_payload_filter_t( FUNCTOR functor )
+			:	m_functor( std::move(functor) )
+			{}
+
+		virtual bool
+		accept( string_view_t payload ) const override
+			{
+				return m_functor( payload );
+			}
+	};
+
+} /* namespace details */
+
+//
+// make_payload_filter
+//
+/*!
+ * \brief Create a filter from a functor with signature
+ * bool(string_view_t).
+ */
+template< typename FUNCTOR >
+payload_filter_shared_ptr_t
+make_payload_filter( FUNCTOR functor )
+	{
+		return std::make_shared< details::functor_payload_filter_t< FUNCTOR > >(
+				std::move(functor) );
+	}
+
+} /* namespace mosquitto_transport */
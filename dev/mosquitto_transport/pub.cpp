@@ -33,6 +33,43 @@ failed_subscription_ex_t::failed_subscription_ex_t(
 //
 postman_t::~postman_t() {}
 
+bool
+postman_t::accept(
+	const std::string &,
+	const std::string & )
+	{
+		return true;
+	}
+
+const payload_filter_t *
+postman_t::payload_filter() const
+	{
+		return nullptr;
+	}
+
+void
+postman_t::post_tracked(
+	std::string topic_name,
+	std::string payload,
+	const delivery_info_t & )
+	{
+		post( std::move(topic_name), std::move(payload) );
+	}
+
+void
+postman_t::deliver(
+	const std::string & topic_name,
+	const std::string & payload,
+	const delivery_info_t & info )
+	{
+		post_tracked( topic_name, payload, info );
+	}
+
+void
+postman_t::deactivate()
+	{
+	}
+
 void
 postman_t::subscription_failed(
 	const std::string & topic_name,
@@ -41,6 +78,44 @@ postman_t::subscription_failed(
 		throw failed_subscription_ex_t{ topic_name, description };
 	}
 
+namespace details {
+
+//
+// batch_flusher_t
+//
+batch_flusher_t::~batch_flusher_t() {}
+
+//
+// message_selector_t
+//
+message_selector_t::message_selector_t(
+	const subscription_options_t & options,
+	std::shared_ptr< stats_counters_t > stats )
+	:	m_stats{ std::move(stats) }
+	,	m_payload_filter{ options.m_payload_filter }
+	,	m_throttle{ options.m_min_interval, options.m_sample_every }
+	{}
+
+bool
+message_selector_t::accept( const std::string & topic_name )
+	{
+		if( !m_throttle.enabled() )
+			return true;
+
+		bool accepted = false;
+		{
+			std::lock_guard< std::mutex > lock{ m_throttle_lock };
+			accepted = m_throttle.accept(
+					topic_name, std::chrono::steady_clock::now() );
+		}
+
+		if( !accepted && m_stats )
+			++(m_stats->m_throttled_messages);
+		return accepted;
+	}
+
+} /* namespace details */
+
 //
 // topic_mbox_t
 //
@@ -49,7 +124,19 @@ topic_mbox_t::topic_mbox_t(
 	so_5::mbox_t manager,
 	so_5::mbox_t actual_mbox,
 	postman_shared_ptr_t postman )
-	:	m_topic_name{ std::move(topic_name) }
+	:	m_topic_names{ std::move(topic_name) }
+	,	m_manager{ std::move(manager) }
+	,	m_actual_mbox{ std::move(actual_mbox) }
+	,	m_postman{ std::move(postman) }
+	{
+	}
+
+topic_mbox_t::topic_mbox_t(
+	std::vector< std::string > topic_names,
+	so_5::mbox_t manager,
+	so_5::mbox_t actual_mbox,
+	postman_shared_ptr_t postman )
+	:	m_topic_names{ std::move(topic_names) }
 	,	m_manager{ std::move(manager) }
 	,	m_actual_mbox{ std::move(actual_mbox) }
 	,	m_postman{ std::move(postman) }
@@ -85,8 +172,14 @@ topic_mbox_t::unsubscribe_event_handlers(
 	{
 		m_actual_mbox->unsubscribe_event_handlers( type_index, subscriber );
 		if( 0 == --m_subscribers )
-			so_5::send< unsubscribe_topic_t >( m_manager,
-					m_topic_name, m_postman );
+			{
+				if( 1u == m_topic_names.size() )
+					so_5::send< unsubscribe_topic_t >( m_manager,
+							m_topic_names.front(), m_postman );
+				else
+					so_5::send< unsubscribe_topics_t >( m_manager,
+							m_topic_names, m_postman );
+			}
 	}
 
 std::string
@@ -142,5 +235,68 @@ topic_mbox_t::drop_delivery_filter(
 		m_actual_mbox->drop_delivery_filter( msg_type, subscriber );
 	}
 
+//
+// subscription_handle_t
+//
+subscription_handle_t::subscription_handle_t(
+	so_5::mbox_t manager,
+	std::string topic_name,
+	postman_shared_ptr_t postman )
+	:	m_manager{ std::move(manager) }
+	,	m_topic_name{ std::move(topic_name) }
+	,	m_postman{ std::move(postman) }
+	{}
+
+subscription_handle_t::subscription_handle_t(
+	subscription_handle_t && other )
+	:	m_manager{ std::move(other.m_manager) }
+	,	m_topic_name{ std::move(other.m_topic_name) }
+	,	m_postman{ std::move(other.m_postman) }
+	{
+		other.m_postman.reset();
+	}
+
+subscription_handle_t &
+subscription_handle_t::operator=( subscription_handle_t && other )
+	{
+		if( this != &other )
+			{
+				unsubscribe();
+
+				m_manager = std::move(other.m_manager);
+				m_topic_name = std::move(other.m_topic_name);
+				m_postman = std::move(other.m_postman);
+				other.m_postman.reset();
+			}
+
+		return *this;
+	}
+
+subscription_handle_t::~subscription_handle_t()
+	{
+		try
+			{
+				unsubscribe();
+			}
+		catch( ... )
+			{
+				// Exception can't be reported from destructor.
+				// The postman is deactivated anyway.
+			}
+	}
+
+void
+subscription_handle_t::unsubscribe()
+	{
+		if( !m_postman )
+			return;
+
+		auto postman = std::move(m_postman);
+		m_postman.reset();
+
+		postman->deactivate();
+		so_5::send< unsubscribe_topic_t >( m_manager, m_topic_name, postman );
+	}
+
 } /* namespace mosquitto_transport */
 
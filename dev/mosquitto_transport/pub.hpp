@@ -11,13 +11,26 @@
 
 #include <mosquitto_transport/encoder_decoder.hpp>
 #include <mosquitto_transport/ex.hpp>
+#include <mosquitto_transport/payload_filter.hpp>
+#include <mosquitto_transport/stats.hpp>
+#include <mosquitto_transport/string_view.hpp>
+#include <mosquitto_transport/topic_params.hpp>
+
+#include <mosquitto_transport/impl/bulk_status.hpp>
+#include <mosquitto_transport/impl/shared_subscription.hpp>
+#include <mosquitto_transport/impl/topic_throttle.hpp>
 
 #include <so_5/all.hpp>
 
 #include <mosquitto.h>
 
+#include <algorithm>
+#include <chrono>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <atomic>
 
 namespace mosquitto_transport {
@@ -34,9 +47,11 @@ class instance_t
 		instance_t() {}
 		instance_t(
 			so_5::environment_t & env,
-			so_5::mbox_t mbox )
+			so_5::mbox_t mbox,
+			std::shared_ptr< details::stats_counters_t > stats = {} )
 			:	m_env{ &env }
 			,	m_mbox{ std::move(mbox) }
+			,	m_stats{ std::move(stats) }
 			{}
 
 		so_5::environment_t &
@@ -47,9 +62,31 @@ class instance_t
 
 		operator bool() const { return nullptr != m_env; }
 
+		//! Get the current values of transport manager's counters.
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		transport_stats_t
+		stats() const
+			{
+				return m_stats ? m_stats->snapshot() : transport_stats_t{};
+			}
+
+		//! Counters of transport manager.
+		/*!
+		 * \note For internal use only. Can be empty.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		const std::shared_ptr< details::stats_counters_t > &
+		stats_counters() const { return m_stats; }
+
 	private :
 		so_5::environment_t * m_env{};
 		so_5::mbox_t m_mbox;
+		std::shared_ptr< details::stats_counters_t > m_stats;
 	};
 
 //
@@ -92,6 +129,150 @@ class failed_subscription_ex_t : public ex_t
 			const std::string & description );
 	};
 
+//
+// delivery_ticket_t
+//
+/*!
+ * \brief An object which must be kept while an incoming message waits
+ * for handling.
+ *
+ * Is used for accounting of incoming messages in queues
+ * (see a_transport_manager_t::set_backpressure()). Can be empty.
+ *
+ * \since
+ * v.0.7.0
+ */
+using delivery_ticket_t = std::shared_ptr< void >;
+
+//
+// message_body_t
+//
+/*!
+ * \brief Topic name and payload of an incoming message.
+ *
+ * One immutable body is created for a message received from the broker
+ * and is shared by incoming messages for all subscribers.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct message_body_t
+	{
+		const std::string m_topic_name;
+		const std::string m_payload;
+
+		message_body_t( std::string topic_name, std::string payload )
+			:	m_topic_name{ std::move(topic_name) }
+			,	m_payload{ std::move(payload) }
+			{}
+	};
+
+/*!
+ * \brief Alias of shared_ptr for message body.
+ *
+ * \since
+ * v.0.7.0
+ */
+using message_body_shared_ptr_t = std::shared_ptr< const message_body_t >;
+
+//
+// delivery_info_t
+//
+/*!
+ * \brief Additional information about an incoming message.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct delivery_info_t
+	{
+		//! Shared topic name and payload of the message. Can be empty.
+		message_body_shared_ptr_t m_body;
+		//! Ticket to be kept while the message waits for handling.
+		delivery_ticket_t m_ticket;
+		//! Time when the message was received from the broker.
+		std::chrono::steady_clock::time_point m_received_at{
+				std::chrono::steady_clock::now() };
+		//! Parts of topic name matched by wildcards of topic filter.
+		topic_params_t m_topic_params;
+	};
+
+//
+// subscription_options_t
+//
+/*!
+ * \brief Additional options of a subscription.
+ *
+ * \see topic_subscriber_t::subscribe().
+ *
+ * \since
+ * v.0.7.0
+ */
+struct subscription_options_t
+	{
+		//! Max age of an incoming message.
+		/*!
+		 * Age is counted from the moment of receiving the message from
+		 * the broker. A message older than this value is dropped when
+		 * it is about to be posted to the subscriber and when it is about
+		 * to be handled.
+		 *
+		 * Zero means that age of messages is not limited.
+		 */
+		std::chrono::steady_clock::duration m_ttl{};
+
+		//! Min interval between messages of one concrete topic.
+		/*!
+		 * Messages for a topic received earlier than this interval after
+		 * the previous delivered message for the same topic are dropped.
+		 *
+		 * Zero means that rate of messages is not limited.
+		 */
+		std::chrono::steady_clock::duration m_min_interval{};
+
+		//! Only every Nth message of one concrete topic is delivered.
+		/*!
+		 * The first message for a topic is always delivered.
+		 * Zero and one mean that every message is delivered.
+		 *
+		 * \note If m_min_interval is set too then it is applied to messages
+		 * selected by sampling.
+		 */
+		std::uint32_t m_sample_every{};
+
+		//! Predicate for payloads of incoming messages.
+		/*!
+		 * Only messages accepted by this filter are delivered.
+		 * Can be empty.
+		 */
+		payload_filter_shared_ptr_t m_payload_filter;
+	};
+
+//
+// batch_params_t
+//
+/*!
+ * \brief Parameters of delivery of incoming messages in batches.
+ *
+ * A batch is sent when it reaches m_max_messages or m_max_bytes or when
+ * m_max_age passed since the first message was added to it.
+ *
+ * \see topic_subscriber_t::subscribe_batched().
+ *
+ * \since
+ * v.0.7.0
+ */
+struct batch_params_t
+	{
+		//! Max count of messages in one batch.
+		std::size_t m_max_messages{ 1000u };
+		//! Max total size of topic names and payloads in one batch.
+		std::size_t m_max_bytes{ 1024u * 1024u };
+		//! Max time between adding the first message and sending of a batch.
+		std::chrono::steady_clock::duration m_max_age{
+				std::chrono::milliseconds{ 100 } };
+	};
+
 //
 // postman_t
 //
@@ -108,9 +289,84 @@ struct postman_t
 		virtual void
 		subscription_unavailable( const std::string & topic_name ) = 0;
 
+		/*!
+		 * \brief Should a message be posted to this postman?
+		 *
+		 * Is called before post() or post_tracked(). Allows to drop
+		 * a message before copying of its topic name and payload.
+		 * Every message is accepted by default.
+		 *
+		 * \note Can be called on several threads at the same time.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		virtual bool
+		accept(
+			const std::string & topic_name,
+			const std::string & payload );
+
+		/*!
+		 * \brief Filter for payloads of messages for this postman.
+		 *
+		 * Is checked before accept(). Results of the same filter are
+		 * shared between postmans. There is no filter by default.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		virtual const payload_filter_t *
+		payload_filter() const;
+
 		virtual void
 		post( std::string topic_name, std::string payload ) = 0;
 
+		/*!
+		 * \brief Post a message with additional delivery information.
+		 *
+		 * The ticket from \a info should be kept while the message waits
+		 * for handling. By default the ticket is released immediately and
+		 * post() is called.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		virtual void
+		post_tracked(
+			std::string topic_name,
+			std::string payload,
+			const delivery_info_t & info );
+
+		/*!
+		 * \brief Deliver a message accepted by accept() and payload_filter().
+		 *
+		 * Receives references to the data of transport manager. Postmans
+		 * which don't need their own copy of a message can use them without
+		 * copying. By default copies are passed to post_tracked().
+		 *
+		 * \note Can be called on several threads at the same time.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		virtual void
+		deliver(
+			const std::string & topic_name,
+			const std::string & payload,
+			const delivery_info_t & info );
+
+		/*!
+		 * \brief Stop delivery of messages.
+		 *
+		 * Is called by subscription_handle_t::unsubscribe() before
+		 * unsubscription. Does nothing by default.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		virtual void
+		deactivate();
+
 		/*!
 		 * \brief Reaction on subscription failure.
 		 *
@@ -215,6 +471,55 @@ class subscription_failed_t : public so_5::message_t
 		description() const { return m_description; }
 	};
 
+//
+// bulk_subscription_available_t
+//
+/*!
+ * A message about availability of all subscriptions made by
+ * topic_subscriber_t::subscribe_bulk().
+ *
+ * \since
+ * v.0.7.0
+ */
+class bulk_subscription_available_t : public so_5::message_t
+	{
+		const std::size_t m_topics_count;
+
+	public :
+		bulk_subscription_available_t( std::size_t topics_count )
+			:	m_topics_count{ topics_count }
+			{}
+
+		std::size_t
+		topics_count() const { return m_topics_count; }
+	};
+
+//
+// bulk_subscription_unavailable_t
+//
+/*!
+ * A message about unavailability of some subscriptions made by
+ * topic_subscriber_t::subscribe_bulk().
+ *
+ * It is sent when the first of subscriptions is lost after all of them
+ * became available.
+ *
+ * \since
+ * v.0.7.0
+ */
+class bulk_subscription_unavailable_t : public so_5::message_t
+	{
+		const std::size_t m_topics_count;
+
+	public :
+		bulk_subscription_unavailable_t( std::size_t topics_count )
+			:	m_topics_count{ topics_count }
+			{}
+
+		std::size_t
+		topics_count() const { return m_topics_count; }
+	};
+
 //
 // subscribe_topic_t
 //
@@ -253,6 +558,50 @@ struct unsubscribe_topic_t : public so_5::message_t
 			{}
 	};
 
+//
+// subscribe_topics_t
+//
+/*!
+ * \brief Message for subscription of one postman to several topics.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct subscribe_topics_t : public so_5::message_t
+	{
+		const std::vector< std::string > m_topic_names;
+		const postman_shared_ptr_t m_postman;
+
+		subscribe_topics_t(
+			std::vector< std::string > topic_names,
+			postman_shared_ptr_t postman )
+			:	m_topic_names{ std::move(topic_names) }
+			,	m_postman{ std::move(postman) }
+			{}
+	};
+
+//
+// unsubscribe_topics_t
+//
+/*!
+ * \brief Message for unsubscription of one postman from several topics.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct unsubscribe_topics_t : public so_5::message_t
+	{
+		const std::vector< std::string > m_topic_names;
+		const postman_shared_ptr_t m_postman;
+
+		unsubscribe_topics_t(
+			std::vector< std::string > topic_names,
+			postman_shared_ptr_t postman )
+			:	m_topic_names{ std::move(topic_names) }
+			,	m_postman{ std::move(postman) }
+			{}
+	};
+
 //
 // topic_mbox_t
 //
@@ -275,6 +624,21 @@ class topic_mbox_t : public so_5::abstract_message_box_t
 			//! Postman for message delivery.
 			postman_shared_ptr_t postman );
 
+		//! Constructor for mbox with several topics.
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		topic_mbox_t(
+			//! Topics to be subscribed.
+			std::vector< std::string > topic_names,
+			//! Manager's mbox.
+			so_5::mbox_t manager,
+			//! Actual mbox.
+			so_5::mbox_t actual_mbox,
+			//! Postman for message delivery.
+			postman_shared_ptr_t postman );
+
 		unsigned int
 		subscribers_count() const;
 
@@ -322,8 +686,11 @@ class topic_mbox_t : public so_5::abstract_message_box_t
 			so_5::agent_t & subscriber ) SO_5_NOEXCEPT override;
 
 	private :
-		//! Topic to be subscribed.
-		const std::string m_topic_name;
+		//! Topics to be subscribed.
+		/*!
+		 * \note Since v.0.7.0 there can be several topics.
+		 */
+		const std::vector< std::string > m_topic_names;
 		//! Manager's mbox.
 		const so_5::mbox_t m_manager;
 		//! Actual mbox for all mbox-related actions.
@@ -334,58 +701,419 @@ class topic_mbox_t : public so_5::abstract_message_box_t
 		std::atomic< unsigned int > m_subscribers;
 	};
 
+//
+// subscription_handle_t
+//
+/*!
+ * \brief Handle of a subscription which is not bound to subscriptions
+ * of agents.
+ *
+ * The subscription is removed when the handle is destroyed or when
+ * unsubscribe() is called.
+ *
+ * \see callback_subscriber_t, topic_subscriber_t::subscribe_to_mchain().
+ *
+ * \since
+ * v.0.7.0
+ */
+class subscription_handle_t
+	{
+	public :
+		subscription_handle_t() = default;
+
+		subscription_handle_t(
+			so_5::mbox_t manager,
+			std::string topic_name,
+			postman_shared_ptr_t postman );
+
+		subscription_handle_t( const subscription_handle_t & ) = delete;
+		subscription_handle_t &
+		operator=( const subscription_handle_t & ) = delete;
+
+		subscription_handle_t( subscription_handle_t && other );
+		subscription_handle_t &
+		operator=( subscription_handle_t && other );
+
+		~subscription_handle_t();
+
+		//! Remove the subscription.
+		/*!
+		 * postman_t::deactivate() is called before sending of
+		 * unsubscribe_topic_t to transport manager.
+		 */
+		void
+		unsubscribe();
+
+		operator bool() const { return static_cast< bool >( m_postman ); }
+
+	private :
+		so_5::mbox_t m_manager;
+		std::string m_topic_name;
+		postman_shared_ptr_t m_postman;
+	};
+
 //
 // incoming_message_t
 //
 template< typename DECODER_TAG >
 class incoming_message_t : public so_5::message_t
 	{
-		const std::string m_topic_name;
-		const std::string m_payload;
+		//! Topic name and payload.
+		/*!
+		 * Since v.0.7.0 they can be shared with incoming messages
+		 * for other subscribers.
+		 */
+		const message_body_shared_ptr_t m_body;
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		const delivery_ticket_t m_ticket;
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		const topic_params_t m_topic_params;
 
 	public :
 		incoming_message_t( std::string topic_name, std::string payload )
-			:	m_topic_name{ std::move(topic_name) }
-			,	m_payload{ std::move(payload) }
+			:	m_body{ make_body( std::move(topic_name), std::move(payload) ) }
+			{}
+
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		incoming_message_t(
+			std::string topic_name,
+			std::string payload,
+			delivery_ticket_t ticket )
+			:	m_body{ make_body( std::move(topic_name), std::move(payload) ) }
+			,	m_ticket{ std::move(ticket) }
+			{}
+
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		incoming_message_t(
+			std::string topic_name,
+			std::string payload,
+			delivery_ticket_t ticket,
+			topic_params_t topic_params )
+			:	m_body{ make_body( std::move(topic_name), std::move(payload) ) }
+			,	m_ticket{ std::move(ticket) }
+			,	m_topic_params{ std::move(topic_params) }
+			{}
+
+		//! Constructor for a shared body.
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		incoming_message_t(
+			message_body_shared_ptr_t body,
+			delivery_ticket_t ticket,
+			topic_params_t topic_params )
+			:	m_body{ std::move(body) }
+			,	m_ticket{ std::move(ticket) }
+			,	m_topic_params{ std::move(topic_params) }
 			{}
 
 		const std::string &
-		topic_name() const { return m_topic_name; }
+		topic_name() const { return m_body->m_topic_name; }
+
+		//! Count of wildcards in topic filter of the subscription.
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		std::size_t
+		topic_params_count() const { return m_topic_params.size(); }
+
+		//! Part of topic name matched by \a index-th wildcard of
+		//! topic filter.
+		/*!
+		 * For filter 'devices/+/telemetry/+' and topic
+		 * 'devices/d1/telemetry/t' topic_param(0) is 'd1' and
+		 * topic_param(1) is 't'.
+		 *
+		 * The view is valid while the message exists.
+		 *
+		 * \pre index < topic_params_count().
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		string_view_t
+		topic_param( std::size_t index ) const
+			{
+				const auto & p = m_topic_params[ index ];
+				return string_view_t{
+						topic_name().data() + p.m_offset, p.m_size };
+			}
 
 		const std::string &
-		payload() const { return m_payload; }
+		payload() const { return m_body->m_payload; }
 
 		template< typename MSG >
 		MSG decode() const
 			{
 				return decoder_t< DECODER_TAG, MSG >::decode( this->payload() );
 			}
-	};
 
-namespace details {
+	private :
+		static message_body_shared_ptr_t
+		make_body( std::string topic_name, std::string payload )
+			{
+				return std::make_shared< const message_body_t >(
+						std::move(topic_name), std::move(payload) );
+			}
+	};
 
 //
-// actual_postman_t
+// incoming_batch_t
 //
+/*!
+ * \brief A batch of incoming messages.
+ *
+ * All topic names and payloads are stored in one contiguous buffer.
+ * Views returned by topic_name() and payload() are valid while the batch
+ * exists.
+ *
+ * \see topic_subscriber_t::subscribe_batched().
+ *
+ * \since
+ * v.0.7.0
+ */
 template< typename DECODER_TAG >
-class actual_postman_t : public postman_t
+class incoming_batch_t : public so_5::message_t
 	{
-		//! Destination for incoming messages.
-		const so_5::mbox_t m_dest;
-
-		//! Reaction on failed subscription.
+	public :
+		//! Location of one message in the buffer.
+		struct entry_t
+			{
+				std::size_t m_topic_offset;
+				std::size_t m_topic_size;
+				std::size_t m_payload_offset;
+				std::size_t m_payload_size;
+			};
+
+		incoming_batch_t(
+			std::string data,
+			std::vector< entry_t > entries,
+			std::vector< delivery_ticket_t > tickets )
+			:	m_data{ std::move(data) }
+			,	m_entries{ std::move(entries) }
+			,	m_tickets{ std::move(tickets) }
+			{}
+
+		std::size_t
+		size() const { return m_entries.size(); }
+
+		string_view_t
+		topic_name( std::size_t index ) const
+			{
+				const auto & e = m_entries[ index ];
+				return string_view_t{ m_data.data() + e.m_topic_offset,
+						e.m_topic_size };
+			}
+
+		string_view_t
+		payload( std::size_t index ) const
+			{
+				const auto & e = m_entries[ index ];
+				return string_view_t{ m_data.data() + e.m_payload_offset,
+						e.m_payload_size };
+			}
+
+		template< typename MSG >
+		MSG decode( std::size_t index ) const
+			{
+				return decoder_t< DECODER_TAG, MSG >::decode(
+						payload( index ).to_string() );
+			}
+
+	private :
+		const std::string m_data;
+		const std::vector< entry_t > m_entries;
+		//! Tickets of all messages in the batch.
+		const std::vector< delivery_ticket_t > m_tickets;
+	};
+
+namespace details {
+
+//
+// batch_flusher_t
+//
+/*!
+ * \brief Interface of object which sends batches by timer.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct batch_flusher_t
+	{
+		virtual ~batch_flusher_t();
+
+		//! Send the batch \a batch_id if it is not sent yet.
+		/*!
+		 * Is called on the context of transport manager.
+		 */
+		virtual void
+		flush( std::uint64_t batch_id ) = 0;
+	};
+
+//
+// flush_incoming_batch_t
+//
+/*!
+ * \brief Delayed message for sending a batch by its age.
+ *
+ * It is sent to transport manager because postmans have no their own
+ * context.
+ *
+ * \since
+ * v.0.7.0
+ */
+struct flush_incoming_batch_t : public so_5::message_t
+	{
+		const std::shared_ptr< batch_flusher_t > m_flusher;
+		const std::uint64_t m_batch_id;
+
+		flush_incoming_batch_t(
+			std::shared_ptr< batch_flusher_t > flusher,
+			std::uint64_t batch_id )
+			:	m_flusher{ std::move(flusher) }
+			,	m_batch_id{ batch_id }
+			{}
+	};
+
+//
+// message_selector_t
+//
+/*!
+ * \brief Rate limiting, sampling and payload filter of a subscription.
+ *
+ * \see subscription_options_t.
+ *
+ * \note Is thread safe.
+ *
+ * \since
+ * v.0.7.0
+ */
+class message_selector_t
+	{
+		const std::shared_ptr< stats_counters_t > m_stats;
+		const payload_filter_shared_ptr_t m_payload_filter;
+
+		impl::topic_throttle_t m_throttle;
+		std::mutex m_throttle_lock;
+
+	public :
+		message_selector_t(
+			const subscription_options_t & options,
+			std::shared_ptr< stats_counters_t > stats );
+
+		//! Check rate limit and sampling for a message.
+		bool
+		accept( const std::string & topic_name );
+
+		const payload_filter_t *
+		payload_filter() const { return m_payload_filter.get(); }
+	};
+
+//
+// ttl_envelope_t
+//
+/*!
+ * \brief Envelope which drops the message if it is expired at the moment
+ * of handling.
+ *
+ * \since
+ * v.0.7.0
+ */
+class ttl_envelope_t : public so_5::enveloped_msg::envelope_t
+	{
+		const so_5::message_ref_t m_message;
+		const std::chrono::steady_clock::time_point m_expires_at;
+		const std::shared_ptr< stats_counters_t > m_stats;
+
+	public :
+		ttl_envelope_t(
+			so_5::message_ref_t message,
+			std::chrono::steady_clock::time_point expires_at,
+			std::shared_ptr< stats_counters_t > stats )
+			:	m_message{ std::move(message) }
+			,	m_expires_at{ expires_at }
+			,	m_stats{ std::move(stats) }
+			{}
+
+		virtual void
+		access_hook(
+			access_context_t context,
+			so_5::enveloped_msg::handler_invoker_t & invoker ) SO_5_NOEXCEPT override
+			{
+				if( access_context_t::handler_found == context &&
+						std::chrono::steady_clock::now() > m_expires_at )
+					{
+						if( m_stats )
+							++(m_stats->m_expired_messages);
+						return;
+					}
+
+				invoker.invoke( so_5::enveloped_msg::payload_info_t{ m_message } );
+			}
+	};
+
+//
+// actual_postman_t
+//
+template< typename DECODER_TAG >
+class actual_postman_t : public postman_t
+	{
+		//! Destination for incoming messages.
+		const so_5::mbox_t m_dest;
+
+		//! Reaction on failed subscription.
 		/*!
 		 * \since
 		 * v.0.4.0
 		 */
 		failed_subscription_react_t m_on_failure;
 
+		//! Max age of incoming messages.
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		const std::chrono::steady_clock::duration m_ttl;
+
+		//! Counters for expired messages.
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		const std::shared_ptr< stats_counters_t > m_stats;
+
+		//! Rate limiting, sampling and payload filter.
+		/*!
+		 * \since
+		 * v.0.7.0
+		 */
+		message_selector_t m_selector;
+
 	public :
 		actual_postman_t(
 			so_5::mbox_t dest,
-			failed_subscription_react_t on_failure )
+			failed_subscription_react_t on_failure,
+			const subscription_options_t & options = subscription_options_t{},
+			std::shared_ptr< stats_counters_t > stats = {} )
 			:	m_dest{ std::move(dest) }
 			,	m_on_failure{ on_failure }
+			,	m_ttl{ options.m_ttl }
+			,	m_stats{ stats }
+			,	m_selector{ options, std::move(stats) }
 			{}
 
 		virtual void
@@ -400,6 +1128,20 @@ class actual_postman_t : public postman_t
 				so_5::send< subscription_unavailable_t >( m_dest, topic_name );
 			}
 
+		virtual bool
+		accept(
+			const std::string & topic_name,
+			const std::string & ) override
+			{
+				return m_selector.accept( topic_name );
+			}
+
+		virtual const payload_filter_t *
+		payload_filter() const override
+			{
+				return m_selector.payload_filter();
+			}
+
 		virtual void
 		post( std::string topic_name, std::string payload ) override
 			{
@@ -407,6 +1149,45 @@ class actual_postman_t : public postman_t
 						m_dest, std::move(topic_name), std::move(payload) );
 			}
 
+		virtual void
+		post_tracked(
+			std::string topic_name,
+			std::string payload,
+			const delivery_info_t & info ) override
+			{
+				send_tracked( info, [&] {
+						return new incoming_message_t< DECODER_TAG >{
+								std::move(topic_name), std::move(payload),
+								info.m_ticket, info.m_topic_params };
+					} );
+			}
+
+		//! Send a message which refers to the shared body.
+		/*!
+		 * Topic name and payload are not copied if \a info contains
+		 * the body of the message.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		virtual void
+		deliver(
+			const std::string & topic_name,
+			const std::string & payload,
+			const delivery_info_t & info ) override
+			{
+				if( !info.m_body )
+					{
+						postman_t::deliver( topic_name, payload, info );
+						return;
+					}
+
+				send_tracked( info, [&] {
+						return new incoming_message_t< DECODER_TAG >{
+								info.m_body, info.m_ticket, info.m_topic_params };
+					} );
+			}
+
 		virtual void
 		subscription_failed(
 			const std::string & topic_name,
@@ -420,58 +1201,1051 @@ class actual_postman_t : public postman_t
 					// Exception will be thrown by default implementation.
 					postman_t::subscription_failed( topic_name, description );
 			}
+
+	protected :
+		//! Is the message older than subscription_options_t::m_ttl?
+		/*!
+		 * Expired message is counted in transport_stats_t::m_expired_messages.
+		 */
+		bool
+		expired( const delivery_info_t & info ) const
+			{
+				if( std::chrono::steady_clock::duration::zero() == m_ttl ||
+						std::chrono::steady_clock::now() <=
+								info.m_received_at + m_ttl )
+					return false;
+
+				if( m_stats )
+					++(m_stats->m_expired_messages);
+				return true;
+			}
+
+	private :
+		//! Send a message created by \a make_message.
+		/*!
+		 * Ticket will be released with the message. If max age is set
+		 * the message is sent in ttl_envelope_t.
+		 */
+		template< typename MESSAGE_FACTORY >
+		void
+		send_tracked(
+			const delivery_info_t & info,
+			MESSAGE_FACTORY && make_message )
+			{
+				if( expired( info ) )
+					return;
+
+				so_5::message_ref_t msg{ make_message() };
+				if( std::chrono::steady_clock::duration::zero() != m_ttl )
+					// Message will be checked again just before handling.
+					msg = so_5::message_ref_t{ new ttl_envelope_t{
+							std::move(msg), info.m_received_at + m_ttl, m_stats } };
+
+				m_dest->do_deliver_message(
+						std::type_index{ typeid(incoming_message_t< DECODER_TAG >) },
+						msg,
+						1u );
+			}
 	};
 
-} /* namespace details */
+//
+// bulk_postman_t
+//
+/*!
+ * \brief Postman for subscriptions made by
+ * topic_subscriber_t::subscribe_bulk().
+ *
+ * Availability of subscriptions is aggregated: only one
+ * bulk_subscription_available_t is sent when all topics become available
+ * and only one bulk_subscription_unavailable_t is sent when some of them
+ * are lost. Failures are reported for every topic separately.
+ *
+ * \note Status of subscriptions is changed only on the context of
+ * transport manager. There is no need for synchronization.
+ *
+ * \since
+ * v.0.7.0
+ */
+template< typename DECODER_TAG >
+class bulk_postman_t : public actual_postman_t< DECODER_TAG >
+	{
+		using base_type_t = actual_postman_t< DECODER_TAG >;
+
+		//! Destination for notifications.
+		const so_5::mbox_t m_dest;
+
+		//! Availability of all topics.
+		impl::bulk_status_t m_status;
+
+	public :
+		bulk_postman_t(
+			so_5::mbox_t dest,
+			std::size_t topics_count,
+			failed_subscription_react_t on_failure )
+			:	base_type_t{ dest, on_failure }
+			,	m_dest{ std::move(dest) }
+			,	m_status{ topics_count }
+			{}
+
+		virtual void
+		subscription_available( const std::string & topic_name ) override
+			{
+				if( impl::bulk_status_t::change_t::all_available ==
+						m_status.available( topic_name ) )
+					so_5::send< bulk_subscription_available_t >(
+							m_dest, m_status.topics_count() );
+			}
+
+		virtual void
+		subscription_unavailable( const std::string & topic_name ) override
+			{
+				if( impl::bulk_status_t::change_t::some_unavailable ==
+						m_status.unavailable( topic_name ) )
+					so_5::send< bulk_subscription_unavailable_t >(
+							m_dest, m_status.topics_count() );
+			}
+	};
 
 //
-// topic_subscriber_t
+// conflation_queue_t
 //
+/*!
+ * \brief Storage for the newest undelivered messages of a conflating
+ * subscription.
+ *
+ * There is at most one message for every concrete topic in
+ * SObjectizer's queue. While this message is waiting for handling newer
+ * messages for the same topic are kept here and every new message replaces
+ * the previous one. When the message in the queue is handled the newest
+ * kept message is sent.
+ *
+ * Delivery ticket and topic params of a kept message are kept with it.
+ * The ticket of a replaced message is released.
+ *
+ * If max age of messages is set then a sent message is checked again
+ * just before handling. The next kept message is sent when an expired
+ * message is dropped.
+ *
+ * \note Methods are called on different threads: post() on the context of
+ * transport manager, delivered() on the context of the receiver.
+ *
+ * \since
+ * v.0.7.0
+ */
 template< typename DECODER_TAG >
-struct topic_subscriber_t
+class conflation_queue_t
+	:	public std::enable_shared_from_this< conflation_queue_t< DECODER_TAG > >
 	{
-		using msg_type = incoming_message_t< DECODER_TAG >;
+		//! Destination for incoming messages.
+		const so_5::mbox_t m_dest;
+		//! Max age of incoming messages. Zero means no limit.
+		const std::chrono::steady_clock::duration m_ttl;
+		//! Counters for expired messages.
+		const std::shared_ptr< stats_counters_t > m_stats;
 
-		template< typename LAMBDA >
-		static void
-		subscribe(
-			const instance_t & instance,
-			const std::string & topic_name,
-			LAMBDA subscription_actions,
-			failed_subscription_react_t on_failure =
-				failed_subscription_react_t::throw_exception );
+		struct topic_state_t
+			{
+				//! Is there a newer message?
+				bool m_has_pending{ false };
+				std::string m_payload;
+				delivery_info_t m_info;
+			};
+
+		std::mutex m_lock;
+
+		//! Topics with messages in SObjectizer's queue.
+		std::map< std::string, topic_state_t > m_topics;
+
+		void
+		send(
+			std::string topic_name,
+			std::string payload,
+			delivery_info_t info );
+
+	public :
+		conflation_queue_t(
+			so_5::mbox_t dest,
+			std::chrono::steady_clock::duration ttl,
+			std::shared_ptr< stats_counters_t > stats )
+			:	m_dest{ std::move(dest) }
+			,	m_ttl{ ttl }
+			,	m_stats{ std::move(stats) }
+			{}
+
+		void
+		post(
+			std::string topic_name,
+			std::string payload,
+			delivery_info_t info )
+			{
+				{
+					std::lock_guard< std::mutex > lock{ m_lock };
+					auto r = m_topics.emplace( topic_name, topic_state_t{} );
+					if( !r.second )
+						{
+							// There already is a message for this topic in the queue.
+							// Ticket of the replaced message is released here.
+							r.first->second.m_has_pending = true;
+							r.first->second.m_payload = std::move(payload);
+							r.first->second.m_info = std::move(info);
+							return;
+						}
+				}
+
+				send( std::move(topic_name), std::move(payload), std::move(info) );
+			}
+
+		//! Message for the topic is handled by the receiver.
+		void
+		delivered( const std::string & topic_name )
+			{
+				std::string payload;
+				delivery_info_t info;
+				{
+					std::lock_guard< std::mutex > lock{ m_lock };
+					auto it = m_topics.find( topic_name );
+					if( it == m_topics.end() )
+						return;
+
+					if( !it->second.m_has_pending )
+						{
+							m_topics.erase( it );
+							return;
+						}
+
+					it->second.m_has_pending = false;
+					payload.swap( it->second.m_payload );
+					info = std::move( it->second.m_info );
+					it->second.m_info = delivery_info_t{};
+				}
+
+				send( topic_name, std::move(payload), std::move(info) );
+			}
+	};
+
+//
+// conflated_message_t
+//
+/*!
+ * \brief Incoming message which informs conflation_queue_t about
+ * its handling.
+ *
+ * It is delivered as incoming_message_t<DECODER_TAG>. It is destroyed
+ * when all receivers handled it (or when it was thrown out).
+ *
+ * \since
+ * v.0.7.0
+ */
+template< typename DECODER_TAG >
+class conflated_message_t : public incoming_message_t< DECODER_TAG >
+	{
+		const std::shared_ptr< conflation_queue_t< DECODER_TAG > > m_queue;
+
+	public :
+		conflated_message_t(
+			std::shared_ptr< conflation_queue_t< DECODER_TAG > > queue,
+			std::string topic_name,
+			std::string payload,
+			delivery_ticket_t ticket,
+			topic_params_t topic_params )
+			:	incoming_message_t< DECODER_TAG >{
+					std::move(topic_name), std::move(payload),
+					std::move(ticket), std::move(topic_params) }
+			,	m_queue{ std::move(queue) }
+			{}
+
+		~conflated_message_t()
+			{
+				try
+					{
+						m_queue->delivered( this->topic_name() );
+					}
+				catch( ... )
+					{
+						// Exception can't be reported from destructor.
+						// The newer message for the topic is lost.
+					}
+			}
 	};
 
 template< typename DECODER_TAG >
-template< typename LAMBDA >
 void
-topic_subscriber_t< DECODER_TAG >::subscribe(
-	const instance_t & instance,
-	const std::string & topic_name,
-	LAMBDA subscription_actions,
-	failed_subscription_react_t on_failure )
+conflation_queue_t< DECODER_TAG >::send(
+	std::string topic_name,
+	std::string payload,
+	delivery_info_t info )
 	{
-		using namespace details;
+		const auto received_at = info.m_received_at;
+		so_5::message_ref_t msg{ new conflated_message_t< DECODER_TAG >{
+				this->shared_from_this(),
+				std::move(topic_name),
+				std::move(payload),
+				std::move(info.m_ticket),
+				std::move(info.m_topic_params) } };
+
+		if( std::chrono::steady_clock::duration::zero() != m_ttl )
+			// Dropping of the envelope destroys the message and
+			// the next kept message is sent.
+			msg = so_5::message_ref_t{ new ttl_envelope_t{
+					std::move(msg), received_at + m_ttl, m_stats } };
+
+		// Message must be delivered as an ordinary incoming message.
+		m_dest->do_deliver_message(
+				std::type_index{ typeid(incoming_message_t< DECODER_TAG >) },
+				msg,
+				1u );
+	}
 
-		auto actual_mbox = instance.environment().create_mbox();
+//
+// conflating_postman_t
+//
+/*!
+ * \brief Postman for subscriptions made by
+ * topic_subscriber_t::subscribe_conflated().
+ *
+ * \since
+ * v.0.7.0
+ */
+template< typename DECODER_TAG >
+class conflating_postman_t : public actual_postman_t< DECODER_TAG >
+	{
+		using base_type_t = actual_postman_t< DECODER_TAG >;
 
-		postman_shared_ptr_t postman =
-				std::make_shared< actual_postman_t< DECODER_TAG > >( actual_mbox, on_failure );
+		const std::shared_ptr< conflation_queue_t< DECODER_TAG > > m_queue;
 
-		auto tm = new topic_mbox_t{
-				topic_name,
-				instance.mbox(), 
-				actual_mbox,
-				postman };
-		so_5::mbox_t tm_mbox{ tm };
+	public :
+		conflating_postman_t(
+			so_5::mbox_t dest,
+			failed_subscription_react_t on_failure,
+			const subscription_options_t & options,
+			std::shared_ptr< stats_counters_t > stats )
+			:	base_type_t{ dest, on_failure, options, stats }
+			,	m_queue{ std::make_shared< conflation_queue_t< DECODER_TAG > >(
+					std::move(dest), options.m_ttl, std::move(stats) ) }
+			{}
 
-		subscription_actions( tm_mbox );
+		virtual void
+		post( std::string topic_name, std::string payload ) override
+			{
+				m_queue->post( std::move(topic_name), std::move(payload),
+						delivery_info_t{} );
+			}
 
-		if( 0 != tm->subscribers_count() )
-			// There are some subscriptions.
-			// Manager should handle this subscription.
-			so_5::send< subscribe_topic_t >(
-					instance.mbox(), topic_name, postman );
+		virtual void
+		post_tracked(
+			std::string topic_name,
+			std::string payload,
+			const delivery_info_t & info ) override
+			{
+				if( this->expired( info ) )
+					return;
+
+				// Ticket is kept while the message is waiting in the queue
+				// or in SObjectizer's queue.
+				m_queue->post( std::move(topic_name), std::move(payload), info );
+			}
+
+		virtual void
+		deliver(
+			const std::string & topic_name,
+			const std::string & payload,
+			const delivery_info_t & info ) override
+			{
+				// The queue keeps its own copy of the newest payload.
+				post_tracked( topic_name, payload, info );
+			}
+	};
+
+//
+// incoming_batcher_t
+//
+/*!
+ * \brief Collector of incoming messages into batches.
+ *
+ * \note post() is called on several threads of transport manager.
+ *
+ * \since
+ * v.0.7.0
+ */
+template< typename DECODER_TAG >
+class incoming_batcher_t
+	:	public batch_flusher_t
+	,	public std::enable_shared_from_this< incoming_batcher_t< DECODER_TAG > >
+	{
+		using batch_type_t = incoming_batch_t< DECODER_TAG >;
+
+		so_5::environment_t & m_env;
+		//! Manager's mbox for flush_incoming_batch_t.
+		const so_5::mbox_t m_manager;
+		//! Destination for batches.
+		const so_5::mbox_t m_dest;
+		const batch_params_t m_params;
+		const std::shared_ptr< stats_counters_t > m_stats;
+
+		std::mutex m_lock;
+
+		//! ID of the current batch.
+		std::uint64_t m_batch_id{};
+
+		std::string m_data;
+		std::vector< typename batch_type_t::entry_t > m_entries;
+		std::vector< delivery_ticket_t > m_tickets;
+
+		void
+		send(
+			std::string data,
+			std::vector< typename batch_type_t::entry_t > entries,
+			std::vector< delivery_ticket_t > tickets )
+			{
+				so_5::send< batch_type_t >( m_dest,
+						std::move(data), std::move(entries), std::move(tickets) );
+
+				if( m_stats )
+					++(m_stats->m_incoming_batches);
+			}
+
+	public :
+		incoming_batcher_t(
+			so_5::environment_t & env,
+			so_5::mbox_t manager,
+			so_5::mbox_t dest,
+			const batch_params_t & params,
+			std::shared_ptr< stats_counters_t > stats )
+			:	m_env( env )
+			,	m_manager{ std::move(manager) }
+			,	m_dest{ std::move(dest) }
+			,	m_params( params )
+			,	m_stats{ std::move(stats) }
+			{}
+
+		void
+		post(
+			const std::string & topic_name,
+			const std::string & payload,
+			const delivery_ticket_t & ticket )
+			{
+				std::string data;
+				std::vector< typename batch_type_t::entry_t > entries;
+				std::vector< delivery_ticket_t > tickets;
+				std::uint64_t new_batch_id{};
+
+				{
+					std::lock_guard< std::mutex > lock{ m_lock };
+
+					if( m_entries.empty() )
+						// The first message of a new batch. Timer must be started.
+						new_batch_id = ++m_batch_id;
+
+					const auto topic_offset = m_data.size();
+					m_data.append( topic_name );
+					const auto payload_offset = m_data.size();
+					m_data.append( payload );
+					m_entries.push_back( typename batch_type_t::entry_t{
+							topic_offset, topic_name.size(),
+							payload_offset, payload.size() } );
+					if( ticket )
+						m_tickets.push_back( ticket );
+
+					if( m_entries.size() >= m_params.m_max_messages ||
+							m_data.size() >= m_params.m_max_bytes )
+						{
+							data.swap( m_data );
+							entries.swap( m_entries );
+							tickets.swap( m_tickets );
+							// Timer for this batch must be ignored.
+							++m_batch_id;
+							new_batch_id = 0u;
+						}
+				}
+
+				if( !entries.empty() )
+					send( std::move(data), std::move(entries), std::move(tickets) );
+				else if( 0u != new_batch_id )
+					so_5::send_delayed< flush_incoming_batch_t >(
+							m_env, m_manager,
+							m_params.m_max_age,
+							this->shared_from_this(),
+							new_batch_id );
+			}
+
+		virtual void
+		flush( std::uint64_t batch_id ) override
+			{
+				std::string data;
+				std::vector< typename batch_type_t::entry_t > entries;
+				std::vector< delivery_ticket_t > tickets;
+
+				{
+					std::lock_guard< std::mutex > lock{ m_lock };
+					if( batch_id != m_batch_id || m_entries.empty() )
+						// The batch is already sent.
+						return;
+
+					data.swap( m_data );
+					entries.swap( m_entries );
+					tickets.swap( m_tickets );
+				}
+
+				send( std::move(data), std::move(entries), std::move(tickets) );
+			}
+	};
+
+//
+// batching_postman_t
+//
+/*!
+ * \brief Postman for subscriptions made by
+ * topic_subscriber_t::subscribe_batched().
+ *
+ * Max age of messages is checked when a message is added to a batch.
+ * Batches themselves don't expire.
+ *
+ * \since
+ * v.0.7.0
+ */
+template< typename DECODER_TAG >
+class batching_postman_t : public actual_postman_t< DECODER_TAG >
+	{
+		using base_type_t = actual_postman_t< DECODER_TAG >;
+
+		const std::shared_ptr< incoming_batcher_t< DECODER_TAG > > m_batcher;
+
+	public :
+		batching_postman_t(
+			const instance_t & instance,
+			so_5::mbox_t dest,
+			const batch_params_t & params,
+			const subscription_options_t & options,
+			failed_subscription_react_t on_failure )
+			:	base_type_t{ dest, on_failure, options, instance.stats_counters() }
+			,	m_batcher{ std::make_shared< incoming_batcher_t< DECODER_TAG > >(
+					instance.environment(),
+					instance.mbox(),
+					std::move(dest),
+					params,
+					instance.stats_counters() ) }
+			{}
+
+		virtual void
+		post( std::string topic_name, std::string payload ) override
+			{
+				m_batcher->post( topic_name, payload, delivery_ticket_t{} );
+			}
+
+		virtual void
+		post_tracked(
+			std::string topic_name,
+			std::string payload,
+			const delivery_info_t & info ) override
+			{
+				if( this->expired( info ) )
+					return;
+
+				// Tickets are kept by the batch.
+				m_batcher->post( topic_name, payload, info.m_ticket );
+			}
+
+		virtual void
+		deliver(
+			const std::string & topic_name,
+			const std::string & payload,
+			const delivery_info_t & info ) override
+			{
+				if( this->expired( info ) )
+					return;
+
+				// Data is copied into the batch's buffer directly.
+				m_batcher->post( topic_name, payload, info.m_ticket );
+			}
+	};
+
+//
+// check_topic_filter
+//
+/*!
+ * \brief Check a topic filter before subscription.
+ *
+ * Shared subscription must be checked here because
+ * the manager can't report an error to the subscriber.
+ *
+ * \throw ex_t if \a topic_name is an invalid shared subscription.
+ *
+ * \since
+ * v.0.7.0
+ */
+inline void
+check_topic_filter( const std::string & topic_name )
+	{
+		if( impl::is_shared_subscription( topic_name ) )
+			impl::parse_shared_subscription( topic_name );
+	}
+
+inline void
+check_topic_filter( const std::vector< std::string > & topic_names )
+	{
+		for( const auto & topic_name : topic_names )
+			check_topic_filter( topic_name );
+	}
+
+//
+// send_subscription
+//
+inline void
+send_subscription(
+	const so_5::mbox_t & manager,
+	std::string topic_name,
+	postman_shared_ptr_t postman )
+	{
+		so_5::send< subscribe_topic_t >(
+				manager, std::move(topic_name), std::move(postman) );
+	}
+
+inline void
+send_subscription(
+	const so_5::mbox_t & manager,
+	std::vector< std::string > topic_names,
+	postman_shared_ptr_t postman )
+	{
+		so_5::send< subscribe_topics_t >(
+				manager, std::move(topic_names), std::move(postman) );
+	}
+
+//
+// subscribe_via_postman
+//
+/*!
+ * \brief Common part of all subscriptions with topic_mbox_t.
+ *
+ * Topic filters are checked, a new mbox for incoming messages is
+ * created and a postman is made for it by \a make_postman. Subscription
+ * actions are performed on topic_mbox_t. The subscription is sent to
+ * the manager only if there are subscribers.
+ *
+ * \a topics is std::string or std::vector<std::string>.
+ *
+ * \since
+ * v.0.7.0
+ */
+template< typename TOPICS, typename POSTMAN_FACTORY, typename LAMBDA >
+void
+subscribe_via_postman(
+	const instance_t & instance,
+	TOPICS topics,
+	POSTMAN_FACTORY make_postman,
+	LAMBDA subscription_actions )
+	{
+		check_topic_filter( topics );
+
+		auto actual_mbox = instance.environment().create_mbox();
+
+		postman_shared_ptr_t postman = make_postman( actual_mbox );
+
+		auto tm = new topic_mbox_t{
+				topics,
+				instance.mbox(),
+				actual_mbox,
+				postman };
+		so_5::mbox_t tm_mbox{ tm };
+
+		subscription_actions( tm_mbox );
+
+		if( 0 != tm->subscribers_count() )
+			// There are some subscriptions.
+			// Manager should handle this subscription.
+			send_subscription( instance.mbox(), std::move(topics), postman );
+	}
+
+} /* namespace details */
+
+//
+// topic_subscriber_t
+//
+template< typename DECODER_TAG >
+struct topic_subscriber_t
+	{
+		using msg_type = incoming_message_t< DECODER_TAG >;
+
+		template< typename LAMBDA >
+		static void
+		subscribe(
+			const instance_t & instance,
+			const std::string & topic_name,
+			LAMBDA subscription_actions,
+			failed_subscription_react_t on_failure =
+				failed_subscription_react_t::throw_exception );
+
+		//! Subscribe to a topic filter with additional options.
+		/*!
+		 * Messages dropped because of subscription_options_t::m_ttl are
+		 * counted in transport_stats_t::m_expired_messages. Messages
+		 * dropped by rate limiting and sampling are counted in
+		 * transport_stats_t::m_throttled_messages. Messages rejected by
+		 * payload filter are counted in transport_stats_t::m_filtered_messages.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		template< typename LAMBDA >
+		static void
+		subscribe(
+			const instance_t & instance,
+			const std::string & topic_name,
+			const subscription_options_t & options,
+			LAMBDA subscription_actions,
+			failed_subscription_react_t on_failure =
+				failed_subscription_react_t::throw_exception );
+
+		//! Subscribe to a topic filter via shared subscription.
+		/*!
+		 * Subscription '$share/<group>/<topic_name>' will be sent to the
+		 * broker. Messages will be delivered with their actual topic names.
+		 * Notifications about subscription status will contain
+		 * the '$share/<group>/<topic_name>' filter.
+		 *
+		 * \throw ex_t if \a group or \a topic_name is not valid.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		template< typename LAMBDA >
+		static void
+		subscribe_shared(
+			const instance_t & instance,
+			const std::string & group,
+			const std::string & topic_name,
+			LAMBDA subscription_actions,
+			failed_subscription_react_t on_failure =
+				failed_subscription_react_t::throw_exception );
+
+		//! Subscribe to several topic filters at once.
+		/*!
+		 * All topics share one mbox and one postman. Only one message is
+		 * sent to the transport manager. Instead of per-topic
+		 * subscription_available_t and subscription_unavailable_t
+		 * notifications bulk_subscription_available_t and
+		 * bulk_subscription_unavailable_t are sent.
+		 *
+		 * Duplicates in \a topic_names are ignored.
+		 *
+		 * \throw ex_t if \a topic_names is empty or contains an invalid
+		 * shared subscription.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		template< typename LAMBDA >
+		static void
+		subscribe_bulk(
+			const instance_t & instance,
+			std::vector< std::string > topic_names,
+			LAMBDA subscription_actions,
+			failed_subscription_react_t on_failure =
+				failed_subscription_react_t::throw_exception );
+
+		//! Subscribe to a topic filter with conflation of incoming messages.
+		/*!
+		 * Only one message for every concrete topic can wait in the
+		 * receiver's queue. While it is waiting newer messages for the same
+		 * topic are not sent: only the newest of them is kept and it is
+		 * sent when the waiting message is handled.
+		 *
+		 * It keeps memory and latency bounded for slow receivers of
+		 * state-like topics. Intermediate messages are lost.
+		 *
+		 * \throw ex_t if \a topic_name is an invalid shared subscription.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		template< typename LAMBDA >
+		static void
+		subscribe_conflated(
+			const instance_t & instance,
+			const std::string & topic_name,
+			LAMBDA subscription_actions,
+			failed_subscription_react_t on_failure =
+				failed_subscription_react_t::throw_exception );
+
+		//! Subscribe to a topic filter with conflation and additional options.
+		/*!
+		 * Rate limiting, sampling and payload filter are applied before
+		 * conflation. Max age of messages is checked when a message is
+		 * received and just before handling. If the waiting message is
+		 * dropped as expired the newest kept message is sent.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		template< typename LAMBDA >
+		static void
+		subscribe_conflated(
+			const instance_t & instance,
+			const std::string & topic_name,
+			const subscription_options_t & options,
+			LAMBDA subscription_actions,
+			failed_subscription_react_t on_failure =
+				failed_subscription_react_t::throw_exception );
+
+		//! Subscribe to a topic filter with delivery of messages in batches.
+		/*!
+		 * Messages are delivered as incoming_batch_t<DECODER_TAG> instead of
+		 * incoming_message_t<DECODER_TAG>.
+		 *
+		 * \throw ex_t if \a params are not valid or \a topic_name is
+		 * an invalid shared subscription.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		template< typename LAMBDA >
+		static void
+		subscribe_batched(
+			const instance_t & instance,
+			const std::string & topic_name,
+			const batch_params_t & params,
+			LAMBDA subscription_actions,
+			failed_subscription_react_t on_failure =
+				failed_subscription_react_t::throw_exception );
+
+		//! Subscribe to a topic filter with batches and additional options.
+		/*!
+		 * Rate limiting, sampling and payload filter are applied before
+		 * a message is added to a batch. Max age of messages is checked
+		 * only when a message is added to a batch: batches themselves
+		 * don't expire.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		template< typename LAMBDA >
+		static void
+		subscribe_batched(
+			const instance_t & instance,
+			const std::string & topic_name,
+			const batch_params_t & params,
+			const subscription_options_t & options,
+			LAMBDA subscription_actions,
+			failed_subscription_react_t on_failure =
+				failed_subscription_react_t::throw_exception );
+
+		//! Subscribe to a topic filter with delivery of messages to mchain.
+		/*!
+		 * Incoming messages and notifications are sent to \a chain as to
+		 * an ordinary mbox. Thread which doesn't host agents can read them
+		 * via so_5::receive().
+		 *
+		 * Messages are sent on the context of transport manager. For
+		 * size-limited chains an overflow reaction which doesn't block and
+		 * doesn't throw must be used (so_5::mchain_props::overflow_reaction_t
+		 * drop_newest or remove_oldest) without waiting on overflow.
+		 *
+		 * \throw ex_t if \a topic_name is an invalid shared subscription.
+		 *
+		 * \since
+		 * v.0.7.0
+		 */
+		static subscription_handle_t
+		subscribe_to_mchain(
+			const instance_t & instance,
+			const std::string & topic_name,
+			const so_5::mchain_t & chain,
+			const subscription_options_t & options = subscription_options_t{},
+			failed_subscription_react_t on_failure =
+				failed_subscription_react_t::throw_exception );
+	};
+
+template< typename DECODER_TAG >
+template< typename LAMBDA >
+void
+topic_subscriber_t< DECODER_TAG >::subscribe(
+	const instance_t & instance,
+	const std::string & topic_name,
+	LAMBDA subscription_actions,
+	failed_subscription_react_t on_failure )
+	{
+		subscribe(
+				instance,
+				topic_name,
+				subscription_options_t{},
+				std::move(subscription_actions),
+				on_failure );
+	}
+
+template< typename DECODER_TAG >
+template< typename LAMBDA >
+void
+topic_subscriber_t< DECODER_TAG >::subscribe(
+	const instance_t & instance,
+	const std::string & topic_name,
+	const subscription_options_t & options,
+	LAMBDA subscription_actions,
+	failed_subscription_react_t on_failure )
+	{
+		using namespace details;
+
+		subscribe_via_postman( instance, topic_name,
+				[&]( const so_5::mbox_t & actual_mbox ) {
+					return std::make_shared< actual_postman_t< DECODER_TAG > >(
+							actual_mbox, on_failure, options,
+							instance.stats_counters() );
+				},
+				std::move(subscription_actions) );
+	}
+
+template< typename DECODER_TAG >
+template< typename LAMBDA >
+void
+topic_subscriber_t< DECODER_TAG >::subscribe_shared(
+	const instance_t & instance,
+	const std::string & group,
+	const std::string & topic_name,
+	LAMBDA subscription_actions,
+	failed_subscription_react_t on_failure )
+	{
+		subscribe(
+				instance,
+				impl::make_shared_subscription( group, topic_name ),
+				std::move(subscription_actions),
+				on_failure );
+	}
+
+template< typename DECODER_TAG >
+template< typename LAMBDA >
+void
+topic_subscriber_t< DECODER_TAG >::subscribe_bulk(
+	const instance_t & instance,
+	std::vector< std::string > topic_names,
+	LAMBDA subscription_actions,
+	failed_subscription_react_t on_failure )
+	{
+		using namespace details;
+
+		ensure_with_explblock< ex_t >( !topic_names.empty(),
+			[]{ return "topic_names for bulk subscription is empty"; } );
+
+		std::sort( topic_names.begin(), topic_names.end() );
+		topic_names.erase(
+				std::unique( topic_names.begin(), topic_names.end() ),
+				topic_names.end() );
+
+		const auto topics_count = topic_names.size();
+		subscribe_via_postman( instance, std::move(topic_names),
+				[&]( const so_5::mbox_t & actual_mbox ) {
+					return std::make_shared< bulk_postman_t< DECODER_TAG > >(
+							actual_mbox, topics_count, on_failure );
+				},
+				std::move(subscription_actions) );
+	}
+
+template< typename DECODER_TAG >
+template< typename LAMBDA >
+void
+topic_subscriber_t< DECODER_TAG >::subscribe_conflated(
+	const instance_t & instance,
+	const std::string & topic_name,
+	LAMBDA subscription_actions,
+	failed_subscription_react_t on_failure )
+	{
+		subscribe_conflated(
+				instance,
+				topic_name,
+				subscription_options_t{},
+				std::move(subscription_actions),
+				on_failure );
+	}
+
+template< typename DECODER_TAG >
+template< typename LAMBDA >
+void
+topic_subscriber_t< DECODER_TAG >::subscribe_conflated(
+	const instance_t & instance,
+	const std::string & topic_name,
+	const subscription_options_t & options,
+	LAMBDA subscription_actions,
+	failed_subscription_react_t on_failure )
+	{
+		using namespace details;
+
+		subscribe_via_postman( instance, topic_name,
+				[&]( const so_5::mbox_t & actual_mbox ) {
+					return std::make_shared< conflating_postman_t< DECODER_TAG > >(
+							actual_mbox, on_failure, options,
+							instance.stats_counters() );
+				},
+				std::move(subscription_actions) );
+	}
+
+template< typename DECODER_TAG >
+template< typename LAMBDA >
+void
+topic_subscriber_t< DECODER_TAG >::subscribe_batched(
+	const instance_t & instance,
+	const std::string & topic_name,
+	const batch_params_t & params,
+	LAMBDA subscription_actions,
+	failed_subscription_react_t on_failure )
+	{
+		subscribe_batched(
+				instance,
+				topic_name,
+				params,
+				subscription_options_t{},
+				std::move(subscription_actions),
+				on_failure );
+	}
+
+template< typename DECODER_TAG >
+template< typename LAMBDA >
+void
+topic_subscriber_t< DECODER_TAG >::subscribe_batched(
+	const instance_t & instance,
+	const std::string & topic_name,
+	const batch_params_t & params,
+	const subscription_options_t & options,
+	LAMBDA subscription_actions,
+	failed_subscription_react_t on_failure )
+	{
+		using namespace details;
+
+		ensure_with_explblock< ex_t >( 0u != params.m_max_messages &&
+				0u != params.m_max_bytes &&
+				std::chrono::steady_clock::duration::zero() < params.m_max_age,
+			[]{ return "invalid batch_params for batched subscription"; } );
+
+		subscribe_via_postman( instance, topic_name,
+				[&]( const so_5::mbox_t & actual_mbox ) {
+					return std::make_shared< batching_postman_t< DECODER_TAG > >(
+							instance, actual_mbox, params, options, on_failure );
+				},
+				std::move(subscription_actions) );
+	}
+
+template< typename DECODER_TAG >
+subscription_handle_t
+topic_subscriber_t< DECODER_TAG >::subscribe_to_mchain(
+	const instance_t & instance,
+	const std::string & topic_name,
+	const so_5::mchain_t & chain,
+	const subscription_options_t & options,
+	failed_subscription_react_t on_failure )
+	{
+		using namespace details;
+
+		check_topic_filter( topic_name );
+
+		// There is no topic_mbox_t: the chain is the destination and
+		// the subscription is removed via subscription_handle_t.
+		postman_shared_ptr_t postman =
+				std::make_shared< actual_postman_t< DECODER_TAG > >(
+						chain->as_mbox(),
+						on_failure,
+						options,
+						instance.stats_counters() );
+
+		send_subscription( instance.mbox(), topic_name, postman );
+
+		return subscription_handle_t{
+				instance.mbox(), topic_name, std::move(postman) };
 	}
 
 //
@@ -0,0 +1,69 @@
+/*
+ * mosquitto_transport-1.0
+ */
+
+/*!
+ * \file
+ * \brief Request/reply calls over MQTT.
+ * \since
+ * v.0.7.0
+ */
+
+#include <mosquitto_transport/rpc.hpp>
+#include <mosquitto_transport/tools.hpp>
+
+#include <fmt/format.h>
+
+#include <atomic>
+
+namespace mosquitto_transport {
+
+//
+// rpc_failed_ex_t
+//
+rpc_failed_ex_t::rpc_failed_ex_t( const std::string & description )
+	:	ex_t{ fmt::format( "call failed, description='{}'", description ) }
+	{}
+
+//
+// rpc_completion_t
+//
+rpc_completion_t::~rpc_completion_t() {}
+
+//
+// rpc_reply_topic
+//
+std::string
+rpc_reply_topic(
+	const std::string & service_topic,
+	const std::string & request_topic )
+	{
+		const auto prefix_size = service_topic.size() + 1u;
+
+		ensure_with_explblock< ex_t >(
+				request_topic.size() > prefix_size &&
+				0 == request_topic.compare(
+						0, service_topic.size(), service_topic ) &&
+				'/' == request_topic[ service_topic.size() ],
+				[&]{ return fmt::format( "not a request to service '{}': '{}'",
+						service_topic, request_topic ); } );
+
+		return request_topic.substr( prefix_size );
+	}
+
+namespace details {
+
+//
+// next_rpc_call_id
+//
+rpc_call_id_t
+next_rpc_call_id()
+	{
+		static std::atomic< rpc_call_id_t > last_id{ 0u };
+
+		return ++last_id;
+	}
+
+} /* namespace details */
+
+} /* namespace mosquitto_transport */
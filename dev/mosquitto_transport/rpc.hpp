@@ -0,0 +1,346 @@
+/*
+ * mosquitto_transport-1.0
+ */
+
+/*!
+ * \file
+ * \brief Request/reply calls over MQTT.
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <mosquitto_transport/pub.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <string>
+
+namespace mosquitto_transport {
+
+//
+// rpc_call_id_t
+//
+/*!
+ * \brief Type of ID of a call.
+ *
+ * IDs are unique in the process.
+ */
+using rpc_call_id_t = std::uint64_t;
+
+//
+// rpc_failed_ex_t
+//
+/*!
+ * \brief An exception to be stored in a future if a call failed.
+ */
+class rpc_failed_ex_t : public ex_t
+	{
+	public :
+		rpc_failed_ex_t( const std::string & description );
+	};
+
+//
+// rpc_completion_t
+//
+/*!
+ * \brief Interface of object which receives the result of a call.
+ *
+ * \attention Methods are called on the context of transport manager.
+ * They must not block.
+ */
+struct rpc_completion_t
+	{
+		virtual ~rpc_completion_t();
+
+		virtual void
+		completed( rpc_call_id_t call_id, std::string payload ) = 0;
+
+		virtual void
+		failed( rpc_call_id_t call_id, const std::string & description ) = 0;
+	};
+
+/*!
+ * \brief Alias of shared_ptr for completion.
+ */
+using rpc_completion_shared_ptr_t = std::shared_ptr< rpc_completion_t >;
+
+//
+// rpc_call_t
+//
+/*!
+ * \brief Message for making a call.
+ */
+struct rpc_call_t : public so_5::message_t
+	{
+		const rpc_call_id_t m_call_id;
+		//! Topic of the service.
+		const std::string m_topic_name;
+		const std::string m_payload;
+		const std::chrono::steady_clock::duration m_timeout;
+		const rpc_completion_shared_ptr_t m_completion;
+
+		rpc_call_t(
+			rpc_call_id_t call_id,
+			std::string topic_name,
+			std::string payload,
+			std::chrono::steady_clock::duration timeout,
+			rpc_completion_shared_ptr_t completion )
+			:	m_call_id{ call_id }
+			,	m_topic_name{ std::move(topic_name) }
+			,	m_payload{ std::move(payload) }
+			,	m_timeout{ timeout }
+			,	m_completion{ std::move(completion) }
+			{}
+	};
+
+//
+// rpc_reply_t
+//
+/*!
+ * \brief A message with reply to a call.
+ */
+template< typename DECODER_TAG >
+class rpc_reply_t : public so_5::message_t
+	{
+		const rpc_call_id_t m_call_id;
+		const std::string m_payload;
+
+	public :
+		rpc_reply_t( rpc_call_id_t call_id, std::string payload )
+			:	m_call_id{ call_id }
+			,	m_payload{ std::move(payload) }
+			{}
+
+		rpc_call_id_t
+		call_id() const { return m_call_id; }
+
+		const std::string &
+		payload() const { return m_payload; }
+
+		template< typename MSG >
+		MSG decode() const
+			{
+				return decoder_t< DECODER_TAG, MSG >::decode( this->payload() );
+			}
+	};
+
+//
+// rpc_failed_t
+//
+/*!
+ * \brief A message about failure of a call.
+ */
+class rpc_failed_t : public so_5::message_t
+	{
+		const rpc_call_id_t m_call_id;
+		const std::string m_description;
+
+	public :
+		rpc_failed_t( rpc_call_id_t call_id, std::string description )
+			:	m_call_id{ call_id }
+			,	m_description{ std::move(description) }
+			{}
+
+		rpc_call_id_t
+		call_id() const { return m_call_id; }
+
+		const std::string &
+		description() const { return m_description; }
+	};
+
+//
+// rpc_reply_topic
+//
+/*!
+ * \brief Get the topic for reply from the topic of request.
+ *
+ * A request to service \a service_topic is published to
+ * '<service_topic>/<reply_topic>'. A service should be subscribed to
+ * '<service_topic>/#' and should publish its replies to topics returned
+ * by this function.
+ *
+ * \throw ex_t if \a request_topic is not a request to \a service_topic.
+ */
+std::string
+rpc_reply_topic(
+	const std::string & service_topic,
+	const std::string & request_topic );
+
+namespace details {
+
+//
+// next_rpc_call_id
+//
+rpc_call_id_t
+next_rpc_call_id();
+
+//
+// mbox_rpc_completion_t
+//
+/*!
+ * \brief Completion which sends the result to mbox.
+ */
+template< typename DECODER_TAG >
+class mbox_rpc_completion_t : public rpc_completion_t
+	{
+		const so_5::mbox_t m_dest;
+
+	public :
+		mbox_rpc_completion_t( so_5::mbox_t dest )
+			:	m_dest{ std::move(dest) }
+			{}
+
+		virtual void
+		completed( rpc_call_id_t call_id, std::string payload ) override
+			{
+				so_5::send< rpc_reply_t< DECODER_TAG > >(
+						m_dest, call_id, std::move(payload) );
+			}
+
+		virtual void
+		failed(
+			rpc_call_id_t call_id,
+			const std::string & description ) override
+			{
+				so_5::send< rpc_failed_t >( m_dest, call_id, description );
+			}
+	};
+
+//
+// future_rpc_completion_t
+//
+/*!
+ * \brief Completion which sets the value of a future.
+ *
+ * Reply is decoded on the context of transport manager. A decoding
+ * error is stored in the future.
+ */
+template< typename DECODER_TAG, typename REPLY >
+class future_rpc_completion_t : public rpc_completion_t
+	{
+		std::promise< REPLY > m_promise;
+
+	public :
+		std::future< REPLY >
+		get_future() { return m_promise.get_future(); }
+
+		virtual void
+		completed( rpc_call_id_t, std::string payload ) override
+			{
+				try
+					{
+						m_promise.set_value(
+								decoder_t< DECODER_TAG, REPLY >::decode( payload ) );
+					}
+				catch( ... )
+					{
+						m_promise.set_exception( std::current_exception() );
+					}
+			}
+
+		virtual void
+		failed( rpc_call_id_t, const std::string & description ) override
+			{
+				m_promise.set_exception(
+						std::make_exception_ptr( rpc_failed_ex_t{ description } ) );
+			}
+	};
+
+} /* namespace details */
+
+//
+// rpc_client_t
+//
+/*!
+ * \brief Helper for making calls to services via transport manager.
+ *
+ * Transport manager must be configured by
+ * a_transport_manager_t::set_rpc().
+ */
+template< typename ENCODER_TAG, typename DECODER_TAG = ENCODER_TAG >
+struct rpc_client_t
+	{
+		using reply_msg_type = rpc_reply_t< DECODER_TAG >;
+
+		//! Make a call with the result sent to mbox.
+		/*!
+		 * The result is sent to \a reply_to as rpc_reply_t<DECODER_TAG> or
+		 * rpc_failed_t with the returned call ID.
+		 */
+		template< typename MSG >
+		static rpc_call_id_t
+		call(
+			const instance_t & instance,
+			std::string topic_name,
+			const MSG & request,
+			so_5::mbox_t reply_to,
+			std::chrono::steady_clock::duration timeout );
+
+		//! Make a call with the result stored in a future.
+		/*!
+		 * If the call failed the future holds rpc_failed_ex_t.
+		 */
+		template< typename REPLY, typename MSG >
+		static std::future< REPLY >
+		call_future(
+			const instance_t & instance,
+			std::string topic_name,
+			const MSG & request,
+			std::chrono::steady_clock::duration timeout );
+	};
+
+template< typename ENCODER_TAG, typename DECODER_TAG >
+template< typename MSG >
+rpc_call_id_t
+rpc_client_t< ENCODER_TAG, DECODER_TAG >::call(
+	const instance_t & instance,
+	std::string topic_name,
+	const MSG & request,
+	so_5::mbox_t reply_to,
+	std::chrono::steady_clock::duration timeout )
+	{
+		const auto call_id = details::next_rpc_call_id();
+
+		so_5::send< rpc_call_t >(
+				instance.mbox(),
+				call_id,
+				std::move(topic_name),
+				encoder_t< ENCODER_TAG, MSG >::encode( request ),
+				timeout,
+				std::make_shared<
+						details::mbox_rpc_completion_t< DECODER_TAG > >(
+								std::move(reply_to) ) );
+
+		return call_id;
+	}
+
+template< typename ENCODER_TAG, typename DECODER_TAG >
+template< typename REPLY, typename MSG >
+std::future< REPLY >
+rpc_client_t< ENCODER_TAG, DECODER_TAG >::call_future(
+	const instance_t & instance,
+	std::string topic_name,
+	const MSG & request,
+	std::chrono::steady_clock::duration timeout )
+	{
+		auto completion = std::make_shared<
+				details::future_rpc_completion_t< DECODER_TAG, REPLY > >();
+		auto result = completion->get_future();
+
+		so_5::send< rpc_call_t >(
+				instance.mbox(),
+				details::next_rpc_call_id(),
+				std::move(topic_name),
+				encoder_t< ENCODER_TAG, MSG >::encode( request ),
+				timeout,
+				std::move(completion) );
+
+		return result;
+	}
+
+} /* namespace mosquitto_transport */
@@ -0,0 +1,287 @@
+/*
+ * mosquitto_transport-1.0
+ */
+
+/*!
+ * \file
+ * \brief Run-time statistics of transport manager.
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace mosquitto_transport {
+
+//
+// transport_stats_t
+//
+/*!
+ * \brief Snapshot of transport manager's counters.
+ *
+ * All values are accumulated since the start of transport manager.
+ */
+struct transport_stats_t
+	{
+		//! Count of messages passed to mosquitto_publish.
+		std::uint64_t m_published_messages{};
+		//! Total size of payloads passed to mosquitto_publish.
+		std::uint64_t m_published_bytes{};
+		//! Count of messages not published because there was no
+		//! connection to the broker.
+		/*!
+		 * Such messages are lost for subscribers in other processes
+		 * (but they can be delivered to local subscribers, see
+		 * a_transport_manager_t::set_local_delivery()).
+		 */
+		std::uint64_t m_unpublished_messages{};
+
+		//! Count of topic filters acknowledged by the broker.
+		std::uint64_t m_subscription_acks{};
+		//! Total time between SUBSCRIBE and SUBACK for acknowledged filters.
+		std::chrono::microseconds m_total_subscription_ack_time{};
+		//! Max time between SUBSCRIBE and SUBACK.
+		std::chrono::microseconds m_max_subscription_ack_time{};
+		//! Count of topic filters without SUBACK in subscription timeout.
+		std::uint64_t m_subscription_timeouts{};
+		//! Count of repeated attempts of subscription.
+		/*!
+		 * \see a_transport_manager_t::set_subscription_retry().
+		 */
+		std::uint64_t m_subscription_retries{};
+
+		//! Count of reconnections to the broker.
+		std::uint64_t m_reconnects{};
+		//! Time from the last disconnection to the next successful connection.
+		std::chrono::microseconds m_last_reconnect_time{};
+		//! Max time from disconnection to the next successful connection.
+		std::chrono::microseconds m_max_reconnect_time{};
+
+		//! Count of messages delivered via standby connection.
+		/*!
+		 * \see a_transport_manager_t::set_standby_broker().
+		 */
+		std::uint64_t m_standby_deliveries{};
+		//! Is standby connection ready for failover?
+		/*!
+		 * It is true if standby connection is established and all
+		 * registered topic filters are acknowledged by the standby broker.
+		 *
+		 * \see a_transport_manager_t::set_standby_broker().
+		 */
+		bool m_standby_ready{};
+		//! Count of topic filters rejected by the standby broker.
+		std::uint64_t m_standby_subscription_failures{};
+		//! Count of duplicates dropped at switching between connections
+		//! and copies of locally delivered messages received from the broker.
+		std::uint64_t m_duplicates_dropped{};
+
+		//! Count of published messages delivered to local subscribers.
+		/*!
+		 * \see a_transport_manager_t::set_local_delivery().
+		 */
+		std::uint64_t m_local_deliveries{};
+
+		//! Count of messages replaced by newer ones in publish
+		//! conflation mode.
+		/*!
+		 * \see a_transport_manager_t::set_publish_conflation().
+		 */
+		std::uint64_t m_conflated_messages{};
+
+		//! Count of pauses of reading because of backlog of incoming
+		//! messages.
+		/*!
+		 * \see a_transport_manager_t::set_backpressure().
+		 */
+		std::uint64_t m_read_pauses{};
+
+		//! Count of incoming messages dropped because of their age.
+		/*!
+		 * \see subscription_options_t::m_ttl.
+		 */
+		std::uint64_t m_expired_messages{};
+		//! Count of incoming messages dropped by rate limiting and sampling.
+		/*!
+		 * \see subscription_options_t::m_min_interval,
+		 * subscription_options_t::m_sample_every.
+		 */
+		std::uint64_t m_throttled_messages{};
+		//! Count of incoming messages rejected by payload filters.
+		/*!
+		 * Is incremented for every subscription which rejected a message.
+		 *
+		 * \see subscription_options_t::m_payload_filter.
+		 */
+		std::uint64_t m_filtered_messages{};
+
+		//! Count of batches sent to subscribers.
+		/*!
+		 * \see topic_subscriber_t::subscribe_batched().
+		 */
+		std::uint64_t m_incoming_batches{};
+
+		//! Count of chunks of postmans served by separate events.
+		/*!
+		 * \see a_transport_manager_t::set_fan_out().
+		 */
+		std::uint64_t m_fan_out_chunks{};
+
+		//! Count of calls made via rpc_client_t.
+		/*!
+		 * \see a_transport_manager_t::set_rpc().
+		 */
+		std::uint64_t m_rpc_calls{};
+		//! Count of replies to calls.
+		std::uint64_t m_rpc_replies{};
+		//! Count of calls failed because of timeout.
+		std::uint64_t m_rpc_timeouts{};
+	};
+
+namespace details {
+
+//
+// stats_counters_t
+//
+/*!
+ * \brief Thread safe storage for transport manager's counters.
+ */
+struct stats_counters_t
+	{
+		std::atomic< std::uint64_t > m_published_messages{};
+		std::atomic< std::uint64_t > m_published_bytes{};
+		std::atomic< std::uint64_t > m_unpublished_messages{};
+
+		std::atomic< std::uint64_t > m_subscription_acks{};
+		//! Values in microseconds.
+		std::atomic< std::uint64_t > m_total_subscription_ack_time{};
+		std::atomic< std::uint64_t > m_max_subscription_ack_time{};
+		std::atomic< std::uint64_t > m_subscription_timeouts{};
+		std::atomic< std::uint64_t > m_subscription_retries{};
+
+		std::atomic< std::uint64_t > m_reconnects{};
+		//! Values in microseconds.
+		std::atomic< std::uint64_t > m_last_reconnect_time{};
+		std::atomic< std::uint64_t > m_max_reconnect_time{};
+
+		std::atomic< std::uint64_t > m_standby_deliveries{};
+		std::atomic< bool > m_standby_ready{};
+		std::atomic< std::uint64_t > m_standby_subscription_failures{};
+		std::atomic< std::uint64_t > m_duplicates_dropped{};
+		std::atomic< std::uint64_t > m_local_deliveries{};
+
+		std::atomic< std::uint64_t > m_conflated_messages{};
+
+		std::atomic< std::uint64_t > m_read_pauses{};
+		std::atomic< std::uint64_t > m_expired_messages{};
+		std::atomic< std::uint64_t > m_throttled_messages{};
+		std::atomic< std::uint64_t > m_filtered_messages{};
+		std::atomic< std::uint64_t > m_incoming_batches{};
+		std::atomic< std::uint64_t > m_fan_out_chunks{};
+
+		std::atomic< std::uint64_t > m_rpc_calls{};
+		std::atomic< std::uint64_t > m_rpc_replies{};
+		std::atomic< std::uint64_t > m_rpc_timeouts{};
+
+		//! Account time from disconnection to the next connection.
+		/*!
+		 * \note Must be called from one thread only.
+		 */
+		void
+		reconnected( std::chrono::steady_clock::duration d )
+			{
+				const auto us = static_cast< std::uint64_t >(
+						std::chrono::duration_cast< std::chrono::microseconds >(
+								d ).count() );
+
+				++m_reconnects;
+				m_last_reconnect_time.store( us, std::memory_order_relaxed );
+				if( us > m_max_reconnect_time.load( std::memory_order_relaxed ) )
+					m_max_reconnect_time.store( us, std::memory_order_relaxed );
+			}
+
+		//! Account time between SUBSCRIBE and SUBACK.
+		/*!
+		 * \note Must be called from one thread only.
+		 */
+		void
+		subscription_acknowledged( std::chrono::steady_clock::duration d )
+			{
+				const auto us = static_cast< std::uint64_t >(
+						std::chrono::duration_cast< std::chrono::microseconds >(
+								d ).count() );
+
+				++m_subscription_acks;
+				m_total_subscription_ack_time += us;
+				if( us > m_max_subscription_ack_time.load(
+						std::memory_order_relaxed ) )
+					m_max_subscription_ack_time.store(
+							us, std::memory_order_relaxed );
+			}
+
+		transport_stats_t
+		snapshot() const
+			{
+				transport_stats_t r;
+				r.m_published_messages = m_published_messages.load(
+						std::memory_order_relaxed );
+				r.m_published_bytes = m_published_bytes.load(
+						std::memory_order_relaxed );
+				r.m_unpublished_messages = m_unpublished_messages.load(
+						std::memory_order_relaxed );
+				r.m_subscription_acks = m_subscription_acks.load(
+						std::memory_order_relaxed );
+				r.m_total_subscription_ack_time = std::chrono::microseconds{
+						m_total_subscription_ack_time.load(
+								std::memory_order_relaxed ) };
+				r.m_max_subscription_ack_time = std::chrono::microseconds{
+						m_max_subscription_ack_time.load(
+								std::memory_order_relaxed ) };
+				r.m_subscription_timeouts = m_subscription_timeouts.load(
+						std::memory_order_relaxed );
+				r.m_subscription_retries = m_subscription_retries.load(
+						std::memory_order_relaxed );
+				r.m_reconnects = m_reconnects.load( std::memory_order_relaxed );
+				r.m_last_reconnect_time = std::chrono::microseconds{
+						m_last_reconnect_time.load( std::memory_order_relaxed ) };
+				r.m_max_reconnect_time = std::chrono::microseconds{
+						m_max_reconnect_time.load( std::memory_order_relaxed ) };
+				r.m_standby_deliveries = m_standby_deliveries.load(
+						std::memory_order_relaxed );
+				r.m_standby_ready = m_standby_ready.load(
+						std::memory_order_relaxed );
+				r.m_standby_subscription_failures =
+						m_standby_subscription_failures.load(
+								std::memory_order_relaxed );
+				r.m_duplicates_dropped = m_duplicates_dropped.load(
+						std::memory_order_relaxed );
+				r.m_local_deliveries = m_local_deliveries.load(
+						std::memory_order_relaxed );
+				r.m_conflated_messages = m_conflated_messages.load(
+						std::memory_order_relaxed );
+				r.m_read_pauses = m_read_pauses.load( std::memory_order_relaxed );
+				r.m_expired_messages = m_expired_messages.load(
+						std::memory_order_relaxed );
+				r.m_throttled_messages = m_throttled_messages.load(
+						std::memory_order_relaxed );
+				r.m_filtered_messages = m_filtered_messages.load(
+						std::memory_order_relaxed );
+				r.m_incoming_batches = m_incoming_batches.load(
+						std::memory_order_relaxed );
+				r.m_fan_out_chunks = m_fan_out_chunks.load(
+						std::memory_order_relaxed );
+				r.m_rpc_calls = m_rpc_calls.load( std::memory_order_relaxed );
+				r.m_rpc_replies = m_rpc_replies.load( std::memory_order_relaxed );
+				r.m_rpc_timeouts = m_rpc_timeouts.load(
+						std::memory_order_relaxed );
+				return r;
+			}
+	};
+
+} /* namespace details */
+
+} /* namespace mosquitto_transport */
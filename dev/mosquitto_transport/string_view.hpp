@@ -0,0 +1,96 @@
+/*
+ * mosquitto_transport-1.0
+ */
+
+/*!
+ * \file
+ * \brief Non-owning reference to a sequence of characters.
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace mosquitto_transport {
+
+//
+// string_view_t
+//
+/*!
+ * \brief Non-owning reference to a topic name or a payload.
+ *
+ * The referenced data must outlive the view.
+ *
+ * \note There is no std::string_view in C++14.
+ */
+class string_view_t
+	{
+	public :
+		string_view_t() = default;
+
+		string_view_t( const char * data, std::size_t size )
+			:	m_data{ data }
+			,	m_size{ size }
+			{}
+
+		string_view_t( const char * s )
+			:	m_data{ s }
+			,	m_size{ std::strlen( s ) }
+			{}
+
+		string_view_t( const std::string & s )
+			:	m_data{ s.data() }
+			,	m_size{ s.size() }
+			{}
+
+		const char *
+		data() const { return m_data; }
+
+		std::size_t
+		size() const { return m_size; }
+
+		bool
+		empty() const { return 0u == m_size; }
+
+		const char *
+		begin() const { return m_data; }
+
+		const char *
+		end() const { return m_data + m_size; }
+
+		char
+		operator[]( std::size_t index ) const { return m_data[ index ]; }
+
+		std::string
+		to_string() const { return std::string( m_data, m_size ); }
+
+		bool
+		starts_with( string_view_t prefix ) const
+			{
+				return prefix.m_size <= m_size &&
+						0 == std::memcmp( m_data, prefix.m_data, prefix.m_size );
+			}
+
+		friend bool
+		operator==( string_view_t a, string_view_t b )
+			{
+				return a.m_size == b.m_size &&
+						0 == std::memcmp( a.m_data, b.m_data, a.m_size );
+			}
+
+		friend bool
+		operator!=( string_view_t a, string_view_t b )
+			{
+				return !( a == b );
+			}
+
+	private :
+		const char * m_data{ "" };
+		std::size_t m_size{};
+	};
+
+} /* namespace mosquitto_transport */
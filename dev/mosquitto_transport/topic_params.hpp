@@ -0,0 +1,55 @@
+/*
+ * mosquitto_transport-1.0
+ */
+
+/*!
+ * \file
+ * \brief Parts of topic names matched by wildcards of topic filters.
+ * \since
+ * v.0.7.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace mosquitto_transport {
+
+//
+// topic_param_t
+//
+/*!
+ * \brief Location of a part of topic name matched by '+' or '#'.
+ *
+ * For '+' it is one level of topic name. For '#' it is all remaining
+ * levels with separators between them. It is empty if '#' matched
+ * the parent level (e.g. filter 'a/#' and topic 'a').
+ */
+struct topic_param_t
+	{
+		//! Offset of the first character in topic name.
+		std::size_t m_offset;
+		//! Count of characters.
+		std::size_t m_size;
+	};
+
+inline bool
+operator==( const topic_param_t & a, const topic_param_t & b )
+	{
+		return a.m_offset == b.m_offset && a.m_size == b.m_size;
+	}
+
+inline bool
+operator!=( const topic_param_t & a, const topic_param_t & b )
+	{
+		return !( a == b );
+	}
+
+/*!
+ * \brief Locations of all wildcards of topic filter in the order
+ * of their appearance in the filter.
+ */
+using topic_params_t = std::vector< topic_param_t >;
+
+} /* namespace mosquitto_transport */
@@ -0,0 +1,171 @@
+#include <iostream>
+#include <vector>
+
+#include <mosquitto_transport/a_transport_manager.hpp>
+
+#include <so_5/all.hpp>
+
+using namespace std::chrono_literals;
+
+// A batch which doesn't reach size limits must be sent when max_age
+// passed since the first message was added to it.
+
+struct raw_decoder {};
+
+namespace mosqt = mosquitto_transport;
+
+using topic_subscriber = mosqt::topic_subscriber_t< raw_decoder >;
+using batch_type = mosqt::incoming_batch_t< raw_decoder >;
+
+const std::string topic_name{ "test/batch_max_age/data" };
+
+class a_receiver_t : public so_5::agent_t
+{
+	struct too_early : public so_5::signal_t {};
+	struct check : public so_5::signal_t {};
+
+public :
+	a_receiver_t(
+		context_t ctx,
+		mosqt::instance_t transport,
+		bool & ok )
+		:	so_5::agent_t{ ctx }
+		,	m_transport{ std::move(transport) }
+		,	m_ok( ok )
+	{}
+
+	virtual void
+	so_define_agent() override
+	{
+		mosqt::batch_params_t params;
+		params.m_max_messages = 1000u;
+		params.m_max_age = 500ms;
+
+		topic_subscriber::subscribe_batched(
+			m_transport,
+			topic_name,
+			params,
+			[this]( const so_5::mbox_t & mbox ) {
+				so_subscribe( mbox ).event( &a_receiver_t::on_batch );
+				so_subscribe( mbox ).event( &a_receiver_t::on_topic_available );
+			} );
+
+		so_subscribe_self()
+			.event( &a_receiver_t::on_too_early )
+			.event( &a_receiver_t::on_check );
+	}
+
+private :
+	const mosqt::instance_t m_transport;
+	bool & m_ok;
+
+	std::vector< std::vector< std::string > > m_batches;
+
+	void
+	on_topic_available( const mosqt::subscription_available_t & cmd )
+	{
+		std::cout << cmd.topic_name() << ": subscribed!" << std::endl;
+
+		for( const char * payload : { "1", "2", "3" } )
+			so_5::send< mosqt::publish_message_t >( m_transport.mbox(),
+					topic_name, payload );
+
+		so_5::send_delayed< too_early >( *this, 250ms );
+		so_5::send_delayed< check >( *this, 1s );
+	}
+
+	void
+	on_batch( const batch_type & batch )
+	{
+		std::cout << "batch of " << batch.size() << " messages" << std::endl;
+
+		std::vector< std::string > payloads;
+		for( std::size_t i = 0; i != batch.size(); ++i )
+			payloads.push_back( batch.payload( i ).to_string() );
+		m_batches.push_back( std::move(payloads) );
+	}
+
+	void
+	on_too_early( mhood_t< too_early > )
+	{
+		if( !m_batches.empty() )
+		{
+			std::cout << "batch is sent before max_age" << std::endl;
+			m_ok = false;
+		}
+	}
+
+	void
+	on_check( mhood_t< check > )
+	{
+		const std::vector< std::vector< std::string > > expected{
+				{ "1", "2", "3" } };
+		if( expected != m_batches )
+		{
+			std::cout << "unexpected batches received: " << m_batches.size()
+					<< std::endl;
+			m_ok = false;
+		}
+
+		const auto stats = m_transport.stats();
+		std::cout << "incoming_batches=" << stats.m_incoming_batches
+				<< std::endl;
+		if( 1u != stats.m_incoming_batches )
+		{
+			std::cout << "unexpected count of batches" << std::endl;
+			m_ok = false;
+		}
+
+		so_deregister_agent_coop_normally();
+	}
+};
+
+bool
+do_test()
+{
+	mosquitto_transport::lib_initializer_t mosq_lib;
+
+	bool ok = true;
+
+	so_5::launch( [&mosq_lib, &ok]( auto & env ) {
+		env.introduce_coop( [&]( so_5::coop_t & coop ) {
+			using namespace mosquitto_transport;
+
+			auto logger = spdlog::stdout_logger_mt( "mosqt" );
+			logger->set_level( spdlog::level::debug );
+
+			auto tm = coop.make_agent< a_transport_manager_t >(
+					std::ref(mosq_lib),
+					connection_params_t{
+							"test-batch-max-age",
+							"localhost",
+							1883u,
+							5u },
+					logger );
+
+			coop.make_agent< a_receiver_t >( tm->instance(), std::ref(ok) );
+		} );
+	} );
+
+	return ok;
+}
+
+int main()
+{
+	try
+	{
+		if( do_test() )
+		{
+			std::cout << "OK" << std::endl;
+			return 0;
+		}
+
+		std::cout << "FAILED" << std::endl;
+	}
+	catch( const std::exception & ex )
+	{
+		std::cerr << "Oops! " << ex.what() << std::endl;
+	}
+
+	return 1;
+}
@@ -0,0 +1,67 @@
+#define CATCH_CONFIG_MAIN
+#include <catch/catch.hpp>
+
+#include <mosquitto_transport/impl/bulk_status.hpp>
+
+using namespace std;
+
+using namespace mosquitto_transport::impl;
+
+using change_t = bulk_status_t::change_t;
+
+TEST_CASE( "One notification when all topics are available", "available" )
+{
+	bulk_status_t status{ 3u };
+	REQUIRE( 3u == status.topics_count() );
+
+	REQUIRE( change_t::none == status.available( "a" ) );
+	REQUIRE( change_t::none == status.available( "b" ) );
+	// Repeated SUBACK for the same topic doesn't count twice.
+	REQUIRE( change_t::none == status.available( "b" ) );
+	REQUIRE( !status.all_available() );
+
+	REQUIRE( change_t::all_available == status.available( "c" ) );
+	REQUIRE( status.all_available() );
+
+	// There is no second notification.
+	REQUIRE( change_t::none == status.available( "a" ) );
+}
+
+TEST_CASE( "One notification when topics are lost", "unavailable" )
+{
+	bulk_status_t status{ 2u };
+
+	REQUIRE( change_t::none == status.available( "a" ) );
+	REQUIRE( change_t::all_available == status.available( "b" ) );
+
+	// Disconnection: every topic becomes unavailable.
+	REQUIRE( change_t::some_unavailable == status.unavailable( "a" ) );
+	REQUIRE( change_t::none == status.unavailable( "b" ) );
+	REQUIRE( !status.all_available() );
+
+	// Restoring after reconnection.
+	REQUIRE( change_t::none == status.available( "b" ) );
+	REQUIRE( change_t::all_available == status.available( "a" ) );
+}
+
+TEST_CASE( "Loss before all topics are available", "partial" )
+{
+	bulk_status_t status{ 2u };
+
+	REQUIRE( change_t::none == status.available( "a" ) );
+	// The whole set wasn't reported as available. There is nothing
+	// to revoke.
+	REQUIRE( change_t::none == status.unavailable( "a" ) );
+
+	REQUIRE( change_t::none == status.available( "b" ) );
+	REQUIRE( change_t::all_available == status.available( "a" ) );
+}
+
+TEST_CASE( "Single topic", "single" )
+{
+	bulk_status_t status{ 1u };
+
+	REQUIRE( change_t::all_available == status.available( "a" ) );
+	REQUIRE( change_t::some_unavailable == status.unavailable( "a" ) );
+	REQUIRE( change_t::none == status.unavailable( "a" ) );
+}
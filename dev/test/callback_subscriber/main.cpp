@@ -0,0 +1,123 @@
+#define CATCH_CONFIG_MAIN
+#include <catch/catch.hpp>
+
+#include <mosquitto_transport/callback_subscriber.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+
+using namespace mosquitto_transport;
+using namespace mosquitto_transport::details;
+
+struct tag {};
+
+template< typename HANDLER >
+shared_ptr< callback_postman_t< tag, HANDLER > >
+make_postman(
+	HANDLER callback,
+	subscription_failure_handler_t on_failure =
+		subscription_failure_handler_t{} )
+{
+	return make_shared< callback_postman_t< tag, HANDLER > >(
+			std::move(callback),
+			subscription_options_t{},
+			shared_ptr< stats_counters_t >{},
+			std::move(on_failure) );
+}
+
+TEST_CASE( "Callback receives views", "views" )
+{
+	string topic;
+	string param;
+	string payload;
+
+	auto postman = make_postman(
+		[&]( const incoming_message_view_t< tag > & msg ) {
+			topic = msg.topic_name().to_string();
+			param = msg.topic_param( 0u ).to_string();
+			payload = msg.payload().to_string();
+		} );
+
+	delivery_info_t info;
+	info.m_topic_params = topic_params_t{ topic_param_t{ 2u, 1u } };
+	postman->deliver( "a/b/c", "payload", info );
+
+	REQUIRE( "a/b/c" == topic );
+	REQUIRE( "b" == param );
+	REQUIRE( "payload" == payload );
+}
+
+TEST_CASE( "No calls after deactivation", "deactivate" )
+{
+	atomic< bool > in_call{ false };
+	atomic< unsigned > calls{ 0u };
+
+	auto postman = make_postman(
+		[&]( const incoming_message_view_t< tag > & ) {
+			in_call = true;
+			this_thread::sleep_for( milliseconds{5} );
+			++calls;
+			in_call = false;
+		} );
+
+	atomic< bool > stop{ false };
+	thread deliverer{ [&] {
+			while( !stop )
+				postman->deliver( "a/b", "payload", delivery_info_t{} );
+		} };
+
+	while( calls < 3u )
+		this_thread::yield();
+
+	// Deactivation waits for the running call.
+	postman->deactivate();
+	REQUIRE( !in_call );
+
+	const unsigned calls_made = calls;
+	this_thread::sleep_for( milliseconds{50} );
+
+	stop = true;
+	deliverer.join();
+
+	REQUIRE( calls_made == calls );
+}
+
+TEST_CASE( "Failure handler", "failure_handler" )
+{
+	string topic;
+	string description;
+	unsigned failures = 0u;
+
+	auto postman = make_postman(
+		[]( const incoming_message_view_t< tag > & ) {},
+		[&]( const string & t, const string & d ) {
+			topic = t;
+			description = d;
+			++failures;
+		} );
+
+	postman->subscription_failed( "a/+", "rejected" );
+	REQUIRE( 1u == failures );
+	REQUIRE( "a/+" == topic );
+	REQUIRE( "rejected" == description );
+
+	// There are no calls after deactivation.
+	postman->deactivate();
+	postman->subscription_failed( "a/+", "rejected" );
+	REQUIRE( 1u == failures );
+}
+
+TEST_CASE( "Failure without handler", "failure_exception" )
+{
+	auto postman = make_postman(
+		[]( const incoming_message_view_t< tag > & ) {} );
+
+	REQUIRE_THROWS_AS(
+			postman->subscription_failed( "a/+", "rejected" ),
+			failed_subscription_ex_t );
+}
@@ -0,0 +1,171 @@
+#define CATCH_CONFIG_MAIN
+#include <catch/catch.hpp>
+
+#include <mosquitto_transport/impl/correlation_table.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+using namespace mosquitto_transport::impl;
+
+using table_t = correlation_table_t< string >;
+
+TEST_CASE( "Insert and extract", "extract" )
+{
+	const auto start = steady_clock::now();
+	table_t table{ milliseconds{10}, 8u, start };
+
+	REQUIRE( table.insert( 1u, "one", start + milliseconds{100} ) );
+	REQUIRE( table.insert( 2u, "two", start + milliseconds{100} ) );
+	REQUIRE( !table.insert( 1u, "again", start + milliseconds{100} ) );
+	REQUIRE( 2u == table.size() );
+
+	string value;
+	REQUIRE( table.extract( 1u, value ) );
+	REQUIRE( "one" == value );
+	REQUIRE( !table.extract( 1u, value ) );
+	REQUIRE( !table.extract( 3u, value ) );
+	REQUIRE( 1u == table.size() );
+
+	vector< string > expired;
+	table.expire( start + milliseconds{200},
+			[&]( table_t::id_type, string v ) { expired.push_back( v ); } );
+	REQUIRE( vector< string >{ "two" } == expired );
+	REQUIRE( table.empty() );
+}
+
+TEST_CASE( "Expiration by deadlines", "expire" )
+{
+	const auto start = steady_clock::now();
+	table_t table{ milliseconds{10}, 8u, start };
+
+	table.insert( 1u, "a", start + milliseconds{15} );
+	table.insert( 2u, "b", start + milliseconds{18} );
+	table.insert( 3u, "c", start + milliseconds{35} );
+
+	vector< table_t::id_type > expired;
+	const auto collect = [&]( table_t::id_type id, string ) {
+			expired.push_back( id );
+		};
+
+	table.expire( start + milliseconds{5}, collect );
+	REQUIRE( expired.empty() );
+
+	// The rest of tick is not expired yet.
+	table.expire( start + milliseconds{16}, collect );
+	REQUIRE( vector< table_t::id_type >{ 1u } == expired );
+
+	table.expire( start + milliseconds{20}, collect );
+	REQUIRE( vector< table_t::id_type >{ 1u, 2u } == expired );
+
+	table.expire( start + milliseconds{40}, collect );
+	REQUIRE( vector< table_t::id_type >{ 1u, 2u, 3u } == expired );
+	REQUIRE( table.empty() );
+}
+
+TEST_CASE( "Deadlines in next rounds of the wheel", "rounds" )
+{
+	const auto start = steady_clock::now();
+	table_t table{ milliseconds{10}, 4u, start };
+
+	// Both entries are in the same slot.
+	table.insert( 1u, "a", start + milliseconds{15} );
+	table.insert( 2u, "b", start + milliseconds{55} );
+	// Deadline is already passed.
+	table.insert( 3u, "c", start );
+
+	vector< table_t::id_type > expired;
+	const auto collect = [&]( table_t::id_type id, string ) {
+			expired.push_back( id );
+		};
+
+	table.expire( start + milliseconds{30}, collect );
+	REQUIRE( 2u == expired.size() );
+	REQUIRE( 1u == table.size() );
+
+	// More than one round is passed.
+	table.insert( 4u, "d", start + milliseconds{500} );
+	table.expire( start + milliseconds{300}, collect );
+	REQUIRE( 3u == expired.size() );
+	REQUIRE( 2u == expired.back() );
+
+	table.expire( start + milliseconds{500}, collect );
+	REQUIRE( 4u == expired.back() );
+	REQUIRE( table.empty() );
+}
+
+TEST_CASE( "Clear", "clear" )
+{
+	const auto start = steady_clock::now();
+	table_t table{ milliseconds{10}, 8u, start };
+
+	table.insert( 1u, "a", start + milliseconds{15} );
+	table.insert( 2u, "b", start + milliseconds{150} );
+
+	size_t cleared = 0u;
+	table.clear( [&]( table_t::id_type, string ) { ++cleared; } );
+	REQUIRE( 2u == cleared );
+	REQUIRE( table.empty() );
+
+	table.expire( start + milliseconds{200},
+			[&]( table_t::id_type, string ) { ++cleared; } );
+	REQUIRE( 2u == cleared );
+}
+
+TEST_CASE( "Next expiration", "next_expiration" )
+{
+	const auto start = steady_clock::now();
+	table_t table{ milliseconds{10}, 4u, start };
+
+	steady_clock::time_point at;
+	REQUIRE( !table.next_expiration( at ) );
+
+	table.insert( 1u, "a", start + milliseconds{25} );
+	table.insert( 2u, "b", start + milliseconds{15} );
+	// The end of the tick of the nearest deadline.
+	REQUIRE( table.next_expiration( at ) );
+	REQUIRE( start + milliseconds{20} == at );
+
+	size_t expired = 0u;
+	table.expire( at, [&]( table_t::id_type, string ) { ++expired; } );
+	REQUIRE( 1u == expired );
+	REQUIRE( table.next_expiration( at ) );
+	REQUIRE( start + milliseconds{30} == at );
+
+	table.expire( at, [&]( table_t::id_type, string ) { ++expired; } );
+	REQUIRE( 2u == expired );
+	REQUIRE( !table.next_expiration( at ) );
+}
+
+TEST_CASE( "Next expiration for the next round", "next_round" )
+{
+	const auto start = steady_clock::now();
+	table_t table{ milliseconds{10}, 4u, start };
+
+	// Slot of the tick 1 is used by the tick 5 too.
+	table.insert( 1u, "a", start + milliseconds{55} );
+
+	steady_clock::time_point at;
+	REQUIRE( table.next_expiration( at ) );
+	REQUIRE( start + milliseconds{20} == at );
+
+	// Nothing is expired. The entry stays in its slot and is found
+	// at the next round.
+	size_t expired = 0u;
+	table.expire( at, [&]( table_t::id_type, string ) { ++expired; } );
+	REQUIRE( 0u == expired );
+	REQUIRE( table.next_expiration( at ) );
+	REQUIRE( start + milliseconds{60} == at );
+
+	table.expire( at, [&]( table_t::id_type, string ) { ++expired; } );
+	REQUIRE( 1u == expired );
+
+	// Extracted entries don't block the table.
+	string value;
+	table.insert( 2u, "b", start + milliseconds{75} );
+	REQUIRE( table.extract( 2u, value ) );
+	REQUIRE( !table.next_expiration( at ) );
+}
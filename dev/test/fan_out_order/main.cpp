@@ -0,0 +1,183 @@
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <mosquitto_transport/a_transport_manager.hpp>
+
+#include <so_5/all.hpp>
+
+using namespace std::chrono_literals;
+
+// Transport manager is bound to adv_thread_pool dispatcher and every
+// postman is served by a separate chunk. Every postman must receive
+// back-to-back messages in the order of publishing.
+
+const std::string topic_name{ "test/fan_out_order/data" };
+
+constexpr int postmans_count = 4;
+constexpr int messages_count = 100;
+
+struct ordered_postman_t : public mosquitto_transport::postman_t
+	{
+		const std::chrono::microseconds m_delay;
+
+		std::mutex m_lock;
+		std::vector< int > m_received;
+
+		ordered_postman_t( std::chrono::microseconds delay )
+			:	m_delay{ delay }
+			{}
+
+		virtual void
+		subscription_available( const std::string & topic_name ) override
+			{
+				std::cout << "[" << topic_name << "]: available" << std::endl;
+			}
+
+		virtual void
+		subscription_unavailable( const std::string & topic_name ) override
+			{
+				std::cout << "[" << topic_name << "]: unavailable" << std::endl;
+			}
+
+		virtual void
+		post( std::string, std::string payload ) override
+			{
+				// Slow postmans let the next messages overtake the
+				// previous ones if the order isn't kept.
+				std::this_thread::sleep_for( m_delay );
+
+				std::lock_guard< std::mutex > lock{ m_lock };
+				m_received.push_back( std::stoi( payload ) );
+			}
+
+		std::vector< int >
+		received()
+			{
+				std::lock_guard< std::mutex > lock{ m_lock };
+				return m_received;
+			}
+	};
+
+bool
+check_results(
+	const std::vector< std::shared_ptr< ordered_postman_t > > & postmans,
+	const mosquitto_transport::transport_stats_t & stats )
+{
+	std::vector< int > expected;
+	for( int i = 0; i != messages_count; ++i )
+		expected.push_back( i );
+
+	bool ok = true;
+	for( std::size_t i = 0; i != postmans.size(); ++i )
+	{
+		const auto received = postmans[ i ]->received();
+		if( expected != received )
+		{
+			std::cout << "postman " << i << ": unexpected messages:";
+			for( const auto p : received )
+				std::cout << " " << p;
+			std::cout << std::endl;
+			ok = false;
+		}
+	}
+
+	std::cout << "fan_out_chunks=" << stats.m_fan_out_chunks << std::endl;
+	if( static_cast< std::uint64_t >(
+			messages_count * ( postmans_count - 1 ) ) != stats.m_fan_out_chunks )
+	{
+		std::cout << "unexpected count of chunks" << std::endl;
+		ok = false;
+	}
+
+	return ok;
+}
+
+bool
+do_test()
+{
+	mosquitto_transport::lib_initializer_t mosq_lib;
+
+	std::vector< std::shared_ptr< ordered_postman_t > > postmans;
+	for( int i = 0; i != postmans_count; ++i )
+		postmans.push_back( std::make_shared< ordered_postman_t >(
+				std::chrono::microseconds{ ( postmans_count - i ) * 200 } ) );
+
+	bool ok = false;
+
+	so_5::launch( [&mosq_lib, &postmans, &ok]( auto & env ) {
+		env.introduce_coop( [&]( so_5::coop_t & coop ) {
+			using namespace mosquitto_transport;
+
+			auto logger = spdlog::stdout_logger_mt( "mosqt" );
+			logger->set_level( spdlog::level::info );
+
+			namespace atp = so_5::disp::adv_thread_pool;
+
+			auto tm = coop.make_agent_with_binder< a_transport_manager_t >(
+					atp::create_private_disp( coop.environment(), 4u )->binder(
+							atp::bind_params_t{} ),
+					std::ref(mosq_lib),
+					connection_params_t{
+							"test-fan-out-order",
+							"localhost",
+							1883u,
+							5u },
+					logger );
+
+			fan_out_params_t fan_out;
+			fan_out.m_threshold = 1u;
+			fan_out.m_chunk_size = 1u;
+			tm->set_fan_out( fan_out );
+
+			auto instance = tm->instance();
+
+			struct subscribed : so_5::signal_t {};
+			struct check : so_5::signal_t {};
+
+			auto client = coop.define_agent();
+			client.event< broker_connected_t >(
+				instance.mbox(), [instance, client, &postmans] {
+					for( const auto & p : postmans )
+						so_5::send< subscribe_topic_t >( instance.mbox(),
+							topic_name, p );
+					// Wait for SUBACK.
+					so_5::send_delayed< subscribed >( client, 1s );
+				} );
+			client.event< subscribed >( client, [instance, client] {
+					for( int i = 0; i != messages_count; ++i )
+						so_5::send< publish_message_t >( instance.mbox(),
+								topic_name, std::to_string( i ) );
+
+					so_5::send_delayed< check >( client, 3s );
+				} );
+			client.event< check >( client, [&coop, &ok, &postmans, instance] {
+					ok = check_results( postmans, instance.stats() );
+					coop.deregister_normally();
+				} );
+		} );
+	} );
+
+	return ok;
+}
+
+int main()
+{
+	try
+	{
+		if( do_test() )
+		{
+			std::cout << "OK" << std::endl;
+			return 0;
+		}
+
+		std::cout << "FAILED" << std::endl;
+	}
+	catch( const std::exception & ex )
+	{
+		std::cerr << "Oops! " << ex.what() << std::endl;
+	}
+
+	return 1;
+}
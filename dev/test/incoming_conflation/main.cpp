@@ -0,0 +1,155 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <mosquitto_transport/a_transport_manager.hpp>
+
+#include <so_5/all.hpp>
+
+using namespace std::chrono_literals;
+
+// While a message of a conflated subscription waits for handling only
+// the newest message for the same topic must be kept. Topic params must
+// be delivered with the kept message.
+
+struct raw_decoder {};
+
+namespace mosqt = mosquitto_transport;
+
+using topic_subscriber = mosqt::topic_subscriber_t< raw_decoder >;
+
+const std::string topic_filter{ "test/incoming_conflation/+" };
+const std::string topic_name{ "test/incoming_conflation/x" };
+
+class a_receiver_t : public so_5::agent_t
+{
+	struct check : public so_5::signal_t {};
+
+public :
+	a_receiver_t(
+		context_t ctx,
+		mosqt::instance_t transport,
+		bool & ok )
+		:	so_5::agent_t{ ctx }
+		,	m_transport{ std::move(transport) }
+		,	m_ok( ok )
+	{}
+
+	virtual void
+	so_define_agent() override
+	{
+		topic_subscriber::subscribe_conflated(
+			m_transport,
+			topic_filter,
+			[this]( const so_5::mbox_t & mbox ) {
+				so_subscribe( mbox ).event( &a_receiver_t::on_message );
+				so_subscribe( mbox ).event( &a_receiver_t::on_topic_available );
+			} );
+
+		so_subscribe_self().event( &a_receiver_t::on_check );
+	}
+
+private :
+	const mosqt::instance_t m_transport;
+	bool & m_ok;
+
+	std::vector< std::string > m_payloads;
+	std::vector< std::string > m_params;
+
+	void
+	on_topic_available( const mosqt::subscription_available_t & cmd )
+	{
+		std::cout << cmd.topic_name() << ": subscribed!" << std::endl;
+
+		for( const char * payload : { "1", "2", "3", "4", "5" } )
+			so_5::send< mosqt::publish_message_t >( m_transport.mbox(),
+					topic_name, payload );
+
+		so_5::send_delayed< check >( *this, 2s );
+	}
+
+	void
+	on_message( const topic_subscriber::msg_type & cmd )
+	{
+		std::cout << cmd.topic_name() << " => " << cmd.payload() << std::endl;
+
+		m_payloads.push_back( cmd.payload() );
+		if( 1u == cmd.topic_params_count() )
+			m_params.push_back( cmd.topic_param( 0 ).to_string() );
+
+		if( 1u == m_payloads.size() )
+			// Next messages are received while the first one is handled.
+			std::this_thread::sleep_for( 300ms );
+	}
+
+	void
+	on_check( mhood_t< check > )
+	{
+		const std::vector< std::string > expected_payloads{ "1", "5" };
+		const std::vector< std::string > expected_params{ "x", "x" };
+
+		m_ok = expected_payloads == m_payloads && expected_params == m_params;
+		if( !m_ok )
+		{
+			std::cout << "unexpected messages received:";
+			for( const auto & p : m_payloads )
+				std::cout << " " << p;
+			std::cout << ", topic params:";
+			for( const auto & p : m_params )
+				std::cout << " " << p;
+			std::cout << std::endl;
+		}
+
+		so_deregister_agent_coop_normally();
+	}
+};
+
+bool
+do_test()
+{
+	mosquitto_transport::lib_initializer_t mosq_lib;
+
+	bool ok = false;
+
+	so_5::launch( [&mosq_lib, &ok]( auto & env ) {
+		env.introduce_coop( [&]( so_5::coop_t & coop ) {
+			using namespace mosquitto_transport;
+
+			auto logger = spdlog::stdout_logger_mt( "mosqt" );
+			logger->set_level( spdlog::level::debug );
+
+			auto tm = coop.make_agent< a_transport_manager_t >(
+					std::ref(mosq_lib),
+					connection_params_t{
+							"test-incoming-conflation",
+							"localhost",
+							1883u,
+							5u },
+					logger );
+
+			coop.make_agent< a_receiver_t >( tm->instance(), std::ref(ok) );
+		} );
+	} );
+
+	return ok;
+}
+
+int main()
+{
+	try
+	{
+		if( do_test() )
+		{
+			std::cout << "OK" << std::endl;
+			return 0;
+		}
+
+		std::cout << "FAILED" << std::endl;
+	}
+	catch( const std::exception & ex )
+	{
+		std::cerr << "Oops! " << ex.what() << std::endl;
+	}
+
+	return 1;
+}
@@ -0,0 +1,234 @@
+#define CATCH_CONFIG_MAIN
+#include <catch/catch.hpp>
+
+#include <mosquitto_transport/io_dispatcher.hpp>
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+
+using namespace mosquitto_transport;
+
+namespace {
+
+//
+// fake_broker_t
+//
+/*!
+ * Listening socket which accepts connections and answers to CONNECT
+ * by CONNACK. Nothing else is supported.
+ */
+class fake_broker_t
+	{
+	public :
+		fake_broker_t()
+			:	m_listener{ ::socket( AF_INET, SOCK_STREAM, 0 ) }
+			{
+				sockaddr_in addr{};
+				addr.sin_family = AF_INET;
+				addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+				addr.sin_port = 0;
+
+				REQUIRE( -1 != m_listener );
+				REQUIRE( 0 == ::bind( m_listener,
+						reinterpret_cast< sockaddr * >(&addr), sizeof(addr) ) );
+				REQUIRE( 0 == ::listen( m_listener, 4 ) );
+
+				socklen_t len = sizeof(addr);
+				REQUIRE( 0 == ::getsockname( m_listener,
+						reinterpret_cast< sockaddr * >(&addr), &len ) );
+				m_port = ntohs( addr.sin_port );
+			}
+
+		~fake_broker_t()
+			{
+				close_client();
+				::close( m_listener );
+			}
+
+		unsigned int
+		port() const { return m_port; }
+
+		//! Accept a connection, receive CONNECT and send CONNACK.
+		void
+		accept_client()
+			{
+				close_client();
+				m_client = ::accept( m_listener, nullptr, nullptr );
+				REQUIRE( -1 != m_client );
+
+				// CONNECT from libmosquitto is small enough to be
+				// received by one call.
+				char buf[ 256 ];
+				REQUIRE( 0 < ::recv( m_client, buf, sizeof(buf), 0 ) );
+				REQUIRE( 0x10 == static_cast< unsigned char >(buf[ 0 ]) );
+
+				const unsigned char connack[] = { 0x20, 0x02, 0x00, 0x00 };
+				REQUIRE( sizeof(connack) == static_cast< size_t >(
+						::send( m_client, connack, sizeof(connack), 0 ) ) );
+			}
+
+		//! Break the current connection.
+		void
+		close_client()
+			{
+				if( -1 != m_client )
+					{
+						::close( m_client );
+						m_client = -1;
+					}
+			}
+
+	private :
+		const int m_listener;
+		int m_client{ -1 };
+		unsigned int m_port{};
+	};
+
+//
+// counters_t
+//
+struct counters_t
+	{
+		atomic< int > m_connected{ 0 };
+		//! Calls of on_disconnect with non-zero rc.
+		/*!
+		 * Transport manager sends disconnected_t on every such call.
+		 */
+		atomic< int > m_disconnected{ 0 };
+		atomic< int > m_lost{ 0 };
+	};
+
+//
+// client_t
+//
+struct client_t
+	{
+		counters_t m_counters;
+		mosquitto * m_mosq;
+
+		client_t()
+			:	m_mosq{ mosquitto_new( "io_dispatcher_test", true, &m_counters ) }
+			{
+				REQUIRE( nullptr != m_mosq );
+
+				mosquitto_connect_callback_set( m_mosq,
+					[]( mosquitto *, void * obj, int rc ) {
+						if( 0 == rc )
+							++(reinterpret_cast< counters_t * >(obj)->m_connected);
+					} );
+				mosquitto_disconnect_callback_set( m_mosq,
+					[]( mosquitto *, void * obj, int rc ) {
+						if( 0 != rc )
+							++(reinterpret_cast< counters_t * >(obj)->m_disconnected);
+					} );
+			}
+
+		~client_t()
+			{
+				mosquitto_destroy( m_mosq );
+			}
+	};
+
+template< typename Predicate >
+bool
+wait_for( Predicate && predicate )
+	{
+		const auto deadline = steady_clock::now() + seconds{ 10 };
+		while( !predicate() )
+			{
+				if( steady_clock::now() > deadline )
+					return false;
+				this_thread::sleep_for( milliseconds{ 10 } );
+			}
+
+		return true;
+	}
+
+io_dispatcher_t::reconnect_options_t
+make_reconnect_options( const fake_broker_t & broker )
+	{
+		io_dispatcher_t::reconnect_options_t options;
+		options.m_endpoints.emplace_back( "127.0.0.1", broker.port() );
+		options.m_reconnect.m_initial_delay = milliseconds{ 100 };
+		options.m_reconnect.m_max_delay = milliseconds{ 100 };
+
+		return options;
+	}
+
+struct lib_init_t
+	{
+		lib_init_t() { mosquitto_lib_init(); }
+		~lib_init_t() { mosquitto_lib_cleanup(); }
+	};
+
+} /* namespace anonymous */
+
+TEST_CASE( "Start, attach, detach and stop", "attach_detach" )
+{
+	lib_init_t lib;
+	fake_broker_t broker;
+	client_t client;
+
+	auto dispatcher = make_epoll_io_dispatcher( 2u );
+
+	REQUIRE( MOSQ_ERR_SUCCESS == mosquitto_connect_async( client.m_mosq,
+			"127.0.0.1", static_cast< int >( broker.port() ), 30 ) );
+
+	const auto id = dispatcher->attach( client.m_mosq,
+			[&client]( int ) { ++client.m_counters.m_lost; },
+			make_reconnect_options( broker ) );
+
+	broker.accept_client();
+	REQUIRE( wait_for( [&]{ return 1 == client.m_counters.m_connected; } ) );
+
+	dispatcher->detach( id );
+	// Detach of unknown connection is ignored.
+	dispatcher->detach( id );
+	dispatcher.reset();
+
+	REQUIRE( 0 == client.m_counters.m_disconnected );
+	REQUIRE( 0 == client.m_counters.m_lost );
+}
+
+TEST_CASE( "Lost connection", "lost" )
+{
+	lib_init_t lib;
+	fake_broker_t broker;
+	client_t client;
+
+	auto dispatcher = make_epoll_io_dispatcher( 1u );
+
+	REQUIRE( MOSQ_ERR_SUCCESS == mosquitto_connect_async( client.m_mosq,
+			"127.0.0.1", static_cast< int >( broker.port() ), 30 ) );
+
+	const auto id = dispatcher->attach( client.m_mosq,
+			[&client]( int ) { ++client.m_counters.m_lost; },
+			make_reconnect_options( broker ) );
+
+	broker.accept_client();
+	REQUIRE( wait_for( [&]{ return 1 == client.m_counters.m_connected; } ) );
+
+	broker.close_client();
+	REQUIRE( wait_for( [&]{ return 1 == client.m_counters.m_lost; } ) );
+
+	// Dispatcher must reconnect.
+	broker.accept_client();
+	REQUIRE( wait_for( [&]{ return 2 == client.m_counters.m_connected; } ) );
+
+	dispatcher->detach( id );
+	dispatcher.reset();
+
+	// The loss is reported only once: by libmosquitto's on_disconnect.
+	// The lost handler is called for the same loss but must not report it.
+	REQUIRE( 1 == client.m_counters.m_disconnected );
+	REQUIRE( 1 == client.m_counters.m_lost );
+}
@@ -0,0 +1,185 @@
+#include <iostream>
+#include <mutex>
+
+#include <mosquitto_transport/a_transport_manager.hpp>
+
+#include <so_5/all.hpp>
+
+using namespace std::chrono_literals;
+
+// Every message published with local delivery must be received only
+// once: the copy returned by the broker must be dropped.
+
+const std::string topic_name{ "test/local_echo/data" };
+const std::string conflated_topic_name{ "test/local_echo/state" };
+
+constexpr int messages_count = 10;
+
+struct counting_postman_t : public mosquitto_transport::postman_t
+	{
+		std::mutex m_lock;
+		std::map< std::string, int > m_received;
+
+		virtual void
+		subscription_available( const std::string & topic_name ) override
+			{
+				std::cout << "[" << topic_name << "]: available" << std::endl;
+			}
+
+		virtual void
+		subscription_unavailable( const std::string & topic_name ) override
+			{
+				std::cout << "[" << topic_name << "]: unavailable" << std::endl;
+			}
+
+		virtual void
+		post( std::string topic, std::string payload ) override
+			{
+				std::cout << "[" << topic << "]: " << payload << std::endl;
+
+				std::lock_guard< std::mutex > lock{ m_lock };
+				++m_received[ topic + "/" + payload ];
+			}
+
+		int
+		received( const std::string & topic, const std::string & payload )
+			{
+				std::lock_guard< std::mutex > lock{ m_lock };
+				const auto it = m_received.find( topic + "/" + payload );
+				return it == m_received.end() ? 0 : it->second;
+			}
+	};
+
+bool
+check_results(
+	counting_postman_t & postman,
+	const mosquitto_transport::transport_stats_t & stats )
+{
+	bool ok = true;
+
+	for( int i = 0; i != messages_count; ++i )
+	{
+		const auto payload = std::to_string( i );
+		const int received = postman.received( topic_name, payload );
+		if( 1 != received )
+		{
+			std::cout << "message " << payload << " received "
+					<< received << " times" << std::endl;
+			ok = false;
+		}
+	}
+
+	// Every conflated message is delivered locally. Only the first and
+	// the last ones are published to the broker.
+	for( const char * payload : { "a", "b", "c" } )
+	{
+		const int received = postman.received( conflated_topic_name, payload );
+		if( 1 != received )
+		{
+			std::cout << "conflated message " << payload << " received "
+					<< received << " times" << std::endl;
+			ok = false;
+		}
+	}
+
+	std::cout << "local_deliveries=" << stats.m_local_deliveries
+			<< ", duplicates_dropped=" << stats.m_duplicates_dropped
+			<< ", conflated_messages=" << stats.m_conflated_messages
+			<< std::endl;
+
+	if( static_cast< std::uint64_t >( messages_count + 2 ) !=
+			stats.m_duplicates_dropped )
+	{
+		std::cout << "unexpected count of dropped echoes" << std::endl;
+		ok = false;
+	}
+
+	return ok;
+}
+
+bool
+do_test()
+{
+	mosquitto_transport::lib_initializer_t mosq_lib;
+
+	auto postman = std::make_shared< counting_postman_t >();
+	bool ok = false;
+
+	so_5::launch( [&mosq_lib, &postman, &ok]( auto & env ) {
+		env.introduce_coop( [&]( so_5::coop_t & coop ) {
+			using namespace mosquitto_transport;
+
+			auto logger = spdlog::stdout_logger_mt( "mosqt" );
+			logger->set_level( spdlog::level::debug );
+
+			auto tm = coop.make_agent< a_transport_manager_t >(
+					std::ref(mosq_lib),
+					connection_params_t{
+							"test-local-echo",
+							"localhost",
+							1883u,
+							5u },
+					logger );
+
+			local_delivery_params_t local;
+			local.m_policy = local_delivery_policy_t::publish_to_broker;
+			tm->set_local_delivery( local );
+
+			tm->set_publish_conflation( conflated_topic_name, 500ms );
+
+			auto instance = tm->instance();
+
+			struct subscribed : so_5::signal_t {};
+			struct check : so_5::signal_t {};
+
+			auto client = coop.define_agent();
+			client.event< broker_connected_t >(
+				instance.mbox(), [instance, client, postman] {
+					so_5::send< subscribe_topic_t >( instance.mbox(),
+						topic_name, postman );
+					so_5::send< subscribe_topic_t >( instance.mbox(),
+						conflated_topic_name, postman );
+					// Wait for SUBACKs.
+					so_5::send_delayed< subscribed >( client, 1s );
+				} );
+			client.event< subscribed >( client, [instance, client] {
+					for( int i = 0; i != messages_count; ++i )
+						so_5::send< publish_message_t >( instance.mbox(),
+								topic_name, std::to_string( i ) );
+
+					for( const char * payload : { "a", "b", "c" } )
+						so_5::send< publish_message_t >( instance.mbox(),
+								conflated_topic_name, payload );
+
+					// The conflated message is published after 500ms.
+					so_5::send_delayed< check >( client, 2s );
+				} );
+			client.event< check >( client, [&coop, &ok, postman, instance] {
+					ok = check_results( *postman, instance.stats() );
+					coop.deregister_normally();
+				} );
+		} );
+	} );
+
+	return ok;
+}
+
+int main()
+{
+	try
+	{
+		if( do_test() )
+		{
+			std::cout << "OK" << std::endl;
+			return 0;
+		}
+
+		std::cout << "FAILED" << std::endl;
+	}
+	catch( const std::exception & ex )
+	{
+		std::cerr << "Oops! " << ex.what() << std::endl;
+	}
+
+	return 1;
+}
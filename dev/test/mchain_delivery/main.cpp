@@ -0,0 +1,139 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <mosquitto_transport/a_transport_manager.hpp>
+
+#include <so_5/all.hpp>
+
+using namespace std::chrono_literals;
+
+// Messages are delivered to a size-limited mchain with remove_oldest
+// reaction. Messages are sent in ttl envelopes because of m_ttl,
+// expired ones must not be handled.
+
+struct raw_decoder {};
+
+namespace mosqt = mosquitto_transport;
+
+using topic_subscriber = mosqt::topic_subscriber_t< raw_decoder >;
+using incoming_type = mosqt::incoming_message_t< raw_decoder >;
+
+const std::string topic_name{ "test/mchain_delivery/data" };
+
+bool
+do_test()
+{
+	mosquitto_transport::lib_initializer_t mosq_lib;
+
+	so_5::wrapped_env_t sobj;
+
+	mosqt::instance_t transport;
+	sobj.environment().introduce_coop( [&]( so_5::coop_t & coop ) {
+		using namespace mosquitto_transport;
+
+		auto logger = spdlog::stdout_logger_mt( "mosqt" );
+		logger->set_level( spdlog::level::debug );
+
+		auto tm = coop.make_agent< a_transport_manager_t >(
+				std::ref(mosq_lib),
+				connection_params_t{
+						"test-mchain-delivery",
+						"localhost",
+						1883u,
+						5u },
+				logger );
+
+		transport = tm->instance();
+	} );
+
+	// Only two messages can wait in the chain.
+	auto chain = so_5::create_mchain( sobj.environment(),
+			2u,
+			so_5::mchain_props::memory_usage_t::preallocated,
+			so_5::mchain_props::overflow_reaction_t::remove_oldest );
+
+	mosqt::subscription_options_t options;
+	options.m_ttl = 500ms;
+
+	auto subscription = topic_subscriber::subscribe_to_mchain(
+			transport, topic_name, chain, options );
+
+	auto r = so_5::receive( so_5::from( chain ).handle_n( 1 ).empty_timeout( 5s ),
+			[]( const mosqt::subscription_available_t & cmd ) {
+				std::cout << cmd.topic_name() << ": subscribed!" << std::endl;
+			} );
+	if( 1u != r.handled() )
+	{
+		std::cout << "subscription isn't available" << std::endl;
+		return false;
+	}
+
+	bool ok = true;
+	std::vector< std::string > payloads;
+	auto collect = [&payloads]( const incoming_type & msg ) {
+			payloads.push_back( msg.payload() );
+		};
+
+	// The first message is removed by the chain.
+	for( const char * payload : { "1", "2", "3" } )
+		so_5::send< mosqt::publish_message_t >( transport.mbox(),
+				topic_name, payload );
+
+	std::this_thread::sleep_for( 200ms );
+	so_5::receive( so_5::from( chain ).no_wait_on_empty(), collect );
+
+	const std::vector< std::string > expected{ "2", "3" };
+	if( expected != payloads )
+	{
+		std::cout << "unexpected messages received: " << payloads.size()
+				<< std::endl;
+		ok = false;
+	}
+
+	// This message expires in the chain.
+	payloads.clear();
+	so_5::send< mosqt::publish_message_t >( transport.mbox(),
+			topic_name, "4" );
+
+	std::this_thread::sleep_for( 1s );
+	r = so_5::receive( so_5::from( chain ).no_wait_on_empty(), collect );
+	if( 1u != r.extracted() || !payloads.empty() )
+	{
+		std::cout << "expired message is handled" << std::endl;
+		ok = false;
+	}
+
+	const auto stats = transport.stats();
+	std::cout << "expired_messages=" << stats.m_expired_messages << std::endl;
+	if( 1u != stats.m_expired_messages )
+	{
+		std::cout << "unexpected count of expired messages" << std::endl;
+		ok = false;
+	}
+
+	subscription.unsubscribe();
+	sobj.stop_then_join();
+
+	return ok;
+}
+
+int main()
+{
+	try
+	{
+		if( do_test() )
+		{
+			std::cout << "OK" << std::endl;
+			return 0;
+		}
+
+		std::cout << "FAILED" << std::endl;
+	}
+	catch( const std::exception & ex )
+	{
+		std::cerr << "Oops! " << ex.what() << std::endl;
+	}
+
+	return 1;
+}
@@ -0,0 +1,126 @@
+#define CATCH_CONFIG_MAIN
+#include <catch/catch.hpp>
+
+#include <mosquitto_transport/impl/payload_filter_results.hpp>
+#include <mosquitto_transport/tools.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+using namespace mosquitto_transport;
+using namespace mosquitto_transport::impl;
+
+TEST_CASE( "Prefix filter", "prefix" )
+{
+	const auto filter = make_prefix_filter( "{\"type\":\"alarm\"" );
+
+	REQUIRE( filter->accept( string_view_t{ "{\"type\":\"alarm\",\"id\":1}" } ) );
+	REQUIRE( filter->accept( string_view_t{ "{\"type\":\"alarm\"" } ) );
+	REQUIRE( !filter->accept( string_view_t{ "{\"type\":\"alar" } ) );
+	REQUIRE( !filter->accept( string_view_t{ "{\"type\":\"event\"}" } ) );
+	REQUIRE( !filter->accept( string_view_t{} ) );
+
+	// Empty prefix accepts everything.
+	const auto empty = make_prefix_filter( string{} );
+	REQUIRE( empty->accept( string_view_t{} ) );
+	REQUIRE( empty->accept( string_view_t{ "abc" } ) );
+}
+
+TEST_CASE( "Byte mask filter", "byte_mask" )
+{
+	// The second byte must have the high bit set, the third one
+	// must be exactly 0x01.
+	const auto filter = make_byte_mask_filter( 1u,
+			string{ "\x80\xFF", 2u }, string{ "\x80\x01", 2u } );
+
+	REQUIRE( filter->accept( string_view_t{ "x\x80\x01", 3u } ) );
+	REQUIRE( filter->accept( string_view_t{ "x\xFF\x01tail", 7u } ) );
+	REQUIRE( !filter->accept( string_view_t{ "x\x7F\x01", 3u } ) );
+	REQUIRE( !filter->accept( string_view_t{ "x\x80\x02", 3u } ) );
+}
+
+TEST_CASE( "Byte mask filter with signed chars", "byte_mask_signed" )
+{
+	// Bytes with the high bit set are negative for signed char.
+	const auto filter = make_byte_mask_filter( 0u,
+			string{ "\xF0", 1u }, string{ "\xA5", 1u } );
+
+	REQUIRE( filter->accept( string_view_t{ "\xA0", 1u } ) );
+	REQUIRE( filter->accept( string_view_t{ "\xAF", 1u } ) );
+	REQUIRE( !filter->accept( string_view_t{ "\x20", 1u } ) );
+	REQUIRE( !filter->accept( string_view_t{ "\xB0", 1u } ) );
+	REQUIRE( !filter->accept( string_view_t{ "\xFF", 1u } ) );
+}
+
+TEST_CASE( "Byte mask filter with short payloads", "byte_mask_short" )
+{
+	const auto filter = make_byte_mask_filter( 2u,
+			string{ "\xFF\xFF", 2u }, string{ "ab", 2u } );
+
+	REQUIRE( filter->accept( string_view_t{ "xxab", 4u } ) );
+	REQUIRE( !filter->accept( string_view_t{ "xxa", 3u } ) );
+	REQUIRE( !filter->accept( string_view_t{ "xx", 2u } ) );
+	REQUIRE( !filter->accept( string_view_t{ "x", 1u } ) );
+	REQUIRE( !filter->accept( string_view_t{} ) );
+
+	// Empty mask accepts payloads which are not shorter than offset.
+	const auto empty = make_byte_mask_filter( 2u, string{}, string{} );
+	REQUIRE( empty->accept( string_view_t{ "xx", 2u } ) );
+	REQUIRE( !empty->accept( string_view_t{ "x", 1u } ) );
+}
+
+TEST_CASE( "Byte mask filter with different sizes", "byte_mask_sizes" )
+{
+	REQUIRE_THROWS_AS(
+			make_byte_mask_filter( 0u, "ab", "a" ),
+			ex_t );
+}
+
+TEST_CASE( "Results are shared", "shared_results" )
+{
+	int calls = 0;
+	const auto filter = make_payload_filter(
+			[&calls]( string_view_t payload ) {
+				++calls;
+				return payload.starts_with( "a" );
+			} );
+
+	const string payload{ "abc" };
+	payload_filter_results_t results{ payload };
+
+	REQUIRE( results.accept( *filter ) );
+	REQUIRE( results.accept( *filter ) );
+	REQUIRE( 1 == calls );
+
+	// Another message is checked again.
+	const string another{ "xyz" };
+	payload_filter_results_t another_results{ another };
+	REQUIRE( !another_results.accept( *filter ) );
+	REQUIRE( !another_results.accept( *filter ) );
+	REQUIRE( 2 == calls );
+}
+
+TEST_CASE( "Many different filters", "many_filters" )
+{
+	int calls = 0;
+	vector< payload_filter_shared_ptr_t > filters;
+	for( int i = 0; i != 10; ++i )
+		filters.push_back( make_payload_filter(
+				[&calls, i]( string_view_t ) {
+					++calls;
+					return 0 == i % 2;
+				} ) );
+
+	const string payload{ "abc" };
+	payload_filter_results_t results{ payload };
+
+	for( int round = 0; round != 2; ++round )
+		for( size_t i = 0; i != filters.size(); ++i )
+			REQUIRE( ( 0u == i % 2 ) == results.accept( *filters[ i ] ) );
+
+	// Only 8 results are remembered. Other filters are evaluated
+	// every time but their results are still correct.
+	REQUIRE( 12 == calls );
+}
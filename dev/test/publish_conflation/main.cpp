@@ -0,0 +1,175 @@
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include <mosquitto_transport/a_transport_manager.hpp>
+
+#include <so_5/all.hpp>
+
+using namespace std::chrono_literals;
+
+// Only the first and the latest messages published during the conflation
+// interval must reach the broker. A message published after a quiet
+// interval must be published immediately.
+
+const std::string topic_name{ "test/publish_conflation/state" };
+
+struct collecting_postman_t : public mosquitto_transport::postman_t
+	{
+		std::mutex m_lock;
+		std::vector< std::string > m_received;
+
+		virtual void
+		subscription_available( const std::string & topic_name ) override
+			{
+				std::cout << "[" << topic_name << "]: available" << std::endl;
+			}
+
+		virtual void
+		subscription_unavailable( const std::string & topic_name ) override
+			{
+				std::cout << "[" << topic_name << "]: unavailable" << std::endl;
+			}
+
+		virtual void
+		post( std::string topic, std::string payload ) override
+			{
+				std::cout << "[" << topic << "]: " << payload << std::endl;
+
+				std::lock_guard< std::mutex > lock{ m_lock };
+				m_received.push_back( std::move(payload) );
+			}
+
+		std::vector< std::string >
+		received()
+			{
+				std::lock_guard< std::mutex > lock{ m_lock };
+				return m_received;
+			}
+	};
+
+bool
+check_received(
+	const char * stage,
+	collecting_postman_t & postman,
+	const std::vector< std::string > & expected )
+{
+	const auto received = postman.received();
+	if( expected == received )
+		return true;
+
+	std::cout << stage << ": unexpected messages received:";
+	for( const auto & p : received )
+		std::cout << " " << p;
+	std::cout << std::endl;
+
+	return false;
+}
+
+bool
+do_test()
+{
+	mosquitto_transport::lib_initializer_t mosq_lib;
+
+	auto postman = std::make_shared< collecting_postman_t >();
+	bool ok = true;
+
+	so_5::launch( [&mosq_lib, &postman, &ok]( auto & env ) {
+		env.introduce_coop( [&]( so_5::coop_t & coop ) {
+			using namespace mosquitto_transport;
+
+			auto logger = spdlog::stdout_logger_mt( "mosqt" );
+			logger->set_level( spdlog::level::debug );
+
+			auto tm = coop.make_agent< a_transport_manager_t >(
+					std::ref(mosq_lib),
+					connection_params_t{
+							"test-publish-conflation",
+							"localhost",
+							1883u,
+							5u },
+					logger );
+
+			tm->set_publish_conflation( topic_name, 500ms );
+
+			auto instance = tm->instance();
+
+			struct subscribed : so_5::signal_t {};
+			struct flushed : so_5::signal_t {};
+			struct quiet : so_5::signal_t {};
+			struct check : so_5::signal_t {};
+
+			auto client = coop.define_agent();
+			client.event< broker_connected_t >(
+				instance.mbox(), [instance, client, postman] {
+					so_5::send< subscribe_topic_t >( instance.mbox(),
+						topic_name, postman );
+					// Wait for SUBACK.
+					so_5::send_delayed< subscribed >( client, 1s );
+				} );
+			client.event< subscribed >( client, [instance, client] {
+					// "1" is published immediately, "2" and "3" are
+					// replaced by "4".
+					for( const char * payload : { "1", "2", "3", "4" } )
+						so_5::send< publish_message_t >( instance.mbox(),
+								topic_name, payload );
+
+					// "4" is published after 500ms.
+					so_5::send_delayed< flushed >( client, 750ms );
+				} );
+			client.event< flushed >( client, [client, postman, &ok] {
+					ok = check_received( "flush", *postman, { "1", "4" } ) && ok;
+
+					// There are no messages during the next interval.
+					so_5::send_delayed< quiet >( client, 500ms );
+				} );
+			client.event< quiet >( client, [instance, client] {
+					// "5" is published immediately, "6" is published
+					// after 500ms.
+					for( const char * payload : { "5", "6" } )
+						so_5::send< publish_message_t >( instance.mbox(),
+								topic_name, payload );
+
+					so_5::send_delayed< check >( client, 250ms );
+				} );
+			client.event< check >( client, [&coop, &ok, postman, instance] {
+					ok = check_received( "quiet", *postman,
+							{ "1", "4", "5" } ) && ok;
+
+					const auto stats = instance.stats();
+					std::cout << "conflated_messages="
+							<< stats.m_conflated_messages << std::endl;
+					if( 2u != stats.m_conflated_messages )
+					{
+						std::cout << "unexpected count of conflated messages"
+								<< std::endl;
+						ok = false;
+					}
+
+					coop.deregister_normally();
+				} );
+		} );
+	} );
+
+	return ok;
+}
+
+int main()
+{
+	try
+	{
+		if( do_test() )
+		{
+			std::cout << "OK" << std::endl;
+			return 0;
+		}
+
+		std::cout << "FAILED" << std::endl;
+	}
+	catch( const std::exception & ex )
+	{
+		std::cerr << "Oops! " << ex.what() << std::endl;
+	}
+
+	return 1;
+}
@@ -0,0 +1,148 @@
+#define CATCH_CONFIG_MAIN
+#include <catch/catch.hpp>
+
+#include <mosquitto_transport/impl/recent_messages.hpp>
+
+using namespace std;
+using namespace std::chrono;
+
+using namespace mosquitto_transport::impl;
+
+TEST_CASE( "Messages from one source", "one_source" )
+{
+	recent_messages_t recent{ milliseconds{500}, 16u };
+	const auto now = steady_clock::now();
+
+	const auto h = message_hash( "a/b", "payload" );
+
+	// The same message from the same source is not a duplicate.
+	REQUIRE( recent.accept( h, message_source_t::primary, now ) );
+	REQUIRE( recent.accept( h, message_source_t::primary, now ) );
+	REQUIRE( 2u == recent.size() );
+}
+
+TEST_CASE( "Switch to standby", "switch" )
+{
+	recent_messages_t recent{ milliseconds{500}, 16u };
+	const auto now = steady_clock::now();
+
+	const auto h1 = message_hash( "a/b", "1" );
+	const auto h2 = message_hash( "a/b", "2" );
+	const auto h3 = message_hash( "a/b", "3" );
+
+	REQUIRE( recent.accept( h1, message_source_t::primary, now ) );
+	REQUIRE( recent.accept( h2, message_source_t::primary, now ) );
+
+	// Standby receives already delivered messages.
+	REQUIRE( !recent.accept( h1, message_source_t::standby, now ) );
+	REQUIRE( !recent.accept( h2, message_source_t::standby, now ) );
+	REQUIRE( recent.accept( h3, message_source_t::standby, now ) );
+
+	// Every delivered message suppresses only one duplicate.
+	REQUIRE( recent.accept( h1, message_source_t::standby, now ) );
+
+	// Switching back.
+	REQUIRE( !recent.accept( h3, message_source_t::primary, now ) );
+}
+
+TEST_CASE( "Outdated messages", "outdated" )
+{
+	recent_messages_t recent{ milliseconds{500}, 16u };
+	const auto now = steady_clock::now();
+
+	const auto h = message_hash( "a/b", "1" );
+
+	REQUIRE( recent.accept( h, message_source_t::primary, now ) );
+	REQUIRE( recent.accept( h, message_source_t::standby,
+			now + milliseconds{600} ) );
+	REQUIRE( 1u == recent.size() );
+}
+
+TEST_CASE( "Size limit", "size_limit" )
+{
+	recent_messages_t recent{ seconds{10}, 2u };
+	const auto now = steady_clock::now();
+
+	const auto h1 = message_hash( "a/b", "1" );
+	const auto h2 = message_hash( "a/b", "2" );
+	const auto h3 = message_hash( "a/b", "3" );
+
+	REQUIRE( recent.accept( h1, message_source_t::primary, now ) );
+	REQUIRE( recent.accept( h2, message_source_t::primary, now ) );
+	REQUIRE( recent.accept( h3, message_source_t::primary, now ) );
+	REQUIRE( 2u == recent.size() );
+
+	// h1 is already forgotten.
+	REQUIRE( recent.accept( h1, message_source_t::standby, now ) );
+}
+
+TEST_CASE( "Echo of local delivery", "local" )
+{
+	recent_messages_t recent{ milliseconds{500}, 16u };
+	const auto now = steady_clock::now();
+
+	const auto h1 = message_hash( "a/b", "1" );
+	const auto h2 = message_hash( "a/b", "2" );
+
+	recent.remember( h1, message_source_t::local, now );
+	recent.remember( h1, message_source_t::local, now );
+
+	// Both echoes are dropped.
+	REQUIRE( !recent.accept( h1, message_source_t::primary, now ) );
+	REQUIRE( recent.accept( h2, message_source_t::primary, now ) );
+	REQUIRE( !recent.accept( h1, message_source_t::primary, now ) );
+	REQUIRE( recent.accept( h1, message_source_t::primary, now ) );
+}
+
+TEST_CASE( "Big window", "big_window" )
+{
+	recent_messages_t recent{ seconds{10}, 16384u };
+	const auto now = steady_clock::now();
+
+	for( int i = 0; i != 16384; ++i )
+		REQUIRE( recent.accept( message_hash( "a/b", to_string( i ) ),
+				message_source_t::primary, now ) );
+	REQUIRE( 16384u == recent.size() );
+
+	// Duplicates are found in any part of the window.
+	REQUIRE( !recent.accept( message_hash( "a/b", "0" ),
+			message_source_t::standby, now ) );
+	REQUIRE( !recent.accept( message_hash( "a/b", "16383" ),
+			message_source_t::standby, now ) );
+	REQUIRE( recent.accept( message_hash( "a/b", "16384" ),
+			message_source_t::standby, now ) );
+
+	// Consumed entries leave the window as usual.
+	REQUIRE( 16384u == recent.size() );
+	REQUIRE( recent.accept( message_hash( "a/b", "0" ),
+			message_source_t::standby, now ) );
+}
+
+TEST_CASE( "The oldest message is consumed", "oldest" )
+{
+	recent_messages_t recent{ milliseconds{500}, 16u };
+	const auto now = steady_clock::now();
+
+	const auto h = message_hash( "a/b", "1" );
+
+	recent.remember( h, message_source_t::local, now );
+	recent.remember( h, message_source_t::standby, now + milliseconds{100} );
+
+	// The local message is consumed first.
+	REQUIRE( !recent.accept( h, message_source_t::primary,
+			now + milliseconds{200} ) );
+	// The local message is outdated, but the standby one isn't.
+	REQUIRE( !recent.accept( h, message_source_t::primary,
+			now + milliseconds{550} ) );
+	REQUIRE( recent.accept( h, message_source_t::primary,
+			now + milliseconds{550} ) );
+	// The consumed standby message and the last one.
+	REQUIRE( 2u == recent.size() );
+}
+
+TEST_CASE( "Hash depends on topic and payload", "hash" )
+{
+	REQUIRE( message_hash( "a", "b" ) == message_hash( "a", "b" ) );
+	REQUIRE( message_hash( "a", "b" ) != message_hash( "b", "a" ) );
+	REQUIRE( message_hash( "a/b", "1" ) != message_hash( "a/c", "1" ) );
+}
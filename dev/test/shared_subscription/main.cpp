@@ -0,0 +1,69 @@
+#define CATCH_CONFIG_MAIN
+#include <catch/catch.hpp>
+
+#include <mosquitto_transport/impl/shared_subscription.hpp>
+#include <mosquitto_transport/impl/subscriptions_map.hpp>
+
+#include <algorithm>
+
+using namespace std;
+using namespace std::string_literals;
+
+using namespace mosquitto_transport;
+using namespace mosquitto_transport::impl;
+
+TEST_CASE( "Detection of shared subscriptions", "detection" )
+{
+	REQUIRE( is_shared_subscription( "$share/g/a" ) );
+	REQUIRE( is_shared_subscription( "$share/g/a/+/#" ) );
+
+	REQUIRE( !is_shared_subscription( "a" ) );
+	REQUIRE( !is_shared_subscription( "$share" ) );
+	REQUIRE( !is_shared_subscription( "$SYS/broker/load" ) );
+	REQUIRE( !is_shared_subscription( "a/$share/g/b" ) );
+}
+
+TEST_CASE( "Parsing of shared subscriptions", "parsing" )
+{
+	auto r = parse_shared_subscription( "$share/workers/jobs/+/new" );
+	REQUIRE( "workers"s == r.m_group );
+	REQUIRE( "jobs/+/new"s == r.m_topic_filter );
+
+	r = parse_shared_subscription( "$share/g//a" );
+	REQUIRE( "g"s == r.m_group );
+	REQUIRE( "/a"s == r.m_topic_filter );
+
+	REQUIRE_THROWS_AS( parse_shared_subscription( "a/b" ), ex_t );
+	REQUIRE_THROWS_AS( parse_shared_subscription( "$share/" ), ex_t );
+	REQUIRE_THROWS_AS( parse_shared_subscription( "$share//a" ), ex_t );
+	REQUIRE_THROWS_AS( parse_shared_subscription( "$share/g" ), ex_t );
+	REQUIRE_THROWS_AS( parse_shared_subscription( "$share/g/" ), ex_t );
+	REQUIRE_THROWS_AS( parse_shared_subscription( "$share/+/a" ), ex_t );
+	REQUIRE_THROWS_AS( parse_shared_subscription( "$share/#/a" ), ex_t );
+}
+
+TEST_CASE( "Making of shared subscriptions", "making" )
+{
+	REQUIRE( "$share/g/a/+"s == make_shared_subscription( "g", "a/+" ) );
+
+	REQUIRE_THROWS_AS( make_shared_subscription( "", "a" ), ex_t );
+	REQUIRE_THROWS_AS( make_shared_subscription( "g/h", "a" ), ex_t );
+	REQUIRE_THROWS_AS( make_shared_subscription( "g+", "a" ), ex_t );
+	REQUIRE_THROWS_AS( make_shared_subscription( "g", "" ), ex_t );
+}
+
+TEST_CASE( "Delivery of messages from shared subscriptions", "delivery" )
+{
+	REQUIRE( "a/+"s == delivery_topic_filter( "a/+" ) );
+	REQUIRE( "a/+"s == delivery_topic_filter( "$share/g/a/+" ) );
+
+	subscriptions_map_t< int > map;
+	map.insert( delivery_topic_filter( "$share/g/a/+" ), 1 );
+	map.insert( delivery_topic_filter( "a/b" ), 2 );
+
+	auto matched = map.match( "a/b" );
+	sort( begin(matched), end(matched) );
+	REQUIRE( vector< int >{ 1, 2 } == matched );
+	REQUIRE( vector< int >{ 1 } == map.match( "a/c" ) );
+	REQUIRE( map.match( "$share/g/a/b" ).empty() );
+}
@@ -0,0 +1,94 @@
+#define CATCH_CONFIG_MAIN
+#include <catch/catch.hpp>
+
+#include <mosquitto_transport/impl/subscribe_packet.hpp>
+
+#include <utility>
+
+using namespace std;
+
+using namespace mosquitto_transport::impl;
+
+namespace {
+
+using packets_t = vector< pair< size_t, size_t > >;
+
+packets_t
+split(
+	const vector< string > & topics,
+	size_t max_filters,
+	size_t max_bytes )
+{
+	packets_t packets;
+	for_each_subscribe_packet( topics, max_filters, max_bytes,
+			[&]( size_t first, size_t last ) {
+				packets.emplace_back( first, last );
+			} );
+
+	return packets;
+}
+
+} /* namespace anonymous */
+
+TEST_CASE( "Empty list of filters", "empty" )
+{
+	REQUIRE( split( {}, 10u, 1000u ).empty() );
+}
+
+TEST_CASE( "Limit of filters count", "max_filters" )
+{
+	const vector< string > topics{ "a", "b", "c", "d", "e" };
+
+	REQUIRE( packets_t{ { 0u, 2u }, { 2u, 4u }, { 4u, 5u } } ==
+			split( topics, 2u, 1000u ) );
+	REQUIRE( packets_t{ { 0u, 5u } } == split( topics, 5u, 1000u ) );
+	REQUIRE( packets_t{ { 0u, 1u }, { 1u, 2u }, { 2u, 3u }, { 3u, 4u },
+			{ 4u, 5u } } == split( topics, 1u, 1000u ) );
+}
+
+TEST_CASE( "Limit of packet size", "max_bytes" )
+{
+	// Every filter takes 2 + 3 + 1 bytes.
+	const vector< string > topics{ "a/a", "b/b", "c/c", "d/d" };
+	REQUIRE( 6u == subscribe_filter_bytes( topics[ 0 ] ) );
+
+	SECTION( "exact boundary" )
+	{
+		REQUIRE( packets_t{ { 0u, 2u }, { 2u, 4u } } ==
+				split( topics, 100u, 12u ) );
+	}
+
+	SECTION( "one byte less than boundary" )
+	{
+		REQUIRE( packets_t{ { 0u, 1u }, { 1u, 2u }, { 2u, 3u }, { 3u, 4u } } ==
+				split( topics, 100u, 11u ) );
+	}
+
+	SECTION( "one byte more than boundary" )
+	{
+		REQUIRE( packets_t{ { 0u, 2u }, { 2u, 4u } } ==
+				split( topics, 100u, 13u ) );
+	}
+
+	SECTION( "both limits" )
+	{
+		REQUIRE( packets_t{ { 0u, 1u }, { 1u, 2u }, { 2u, 3u }, { 3u, 4u } } ==
+				split( topics, 1u, 100u ) );
+		REQUIRE( packets_t{ { 0u, 3u }, { 3u, 4u } } ==
+				split( topics, 3u, 18u ) );
+	}
+}
+
+TEST_CASE( "Filter greater than packet size limit", "oversize" )
+{
+	const vector< string > topics{ "a", string( 100u, 'x' ), "b", "c" };
+
+	// The oversize filter goes to a separate packet. Other filters
+	// are not lost.
+	REQUIRE( packets_t{ { 0u, 1u }, { 1u, 2u }, { 2u, 4u } } ==
+			split( topics, 100u, 10u ) );
+
+	// The only filter.
+	REQUIRE( packets_t{ { 0u, 1u } } ==
+			split( { string( 100u, 'x' ) }, 100u, 10u ) );
+}
@@ -0,0 +1,75 @@
+#define CATCH_CONFIG_MAIN
+#include <catch/catch.hpp>
+
+#include <mosquitto_transport/impl/subscription_batch.hpp>
+
+using namespace std;
+
+using namespace mosquitto_transport::impl;
+
+TEST_CASE( "Flush at the end of window", "window" )
+{
+	subscription_batch_t batch;
+	REQUIRE( batch.empty() );
+
+	// Delayed flush must be scheduled only for the first topics.
+	REQUIRE( batch.add( { "a", "b" } ) );
+	const auto id = batch.id();
+	REQUIRE( !batch.add( { "c" } ) );
+	REQUIRE( 3u == batch.size() );
+
+	REQUIRE( batch.is_current( id ) );
+	REQUIRE( vector< string >{ "a", "b", "c" } == batch.take() );
+	REQUIRE( batch.empty() );
+	REQUIRE( !batch.is_current( id ) );
+}
+
+TEST_CASE( "Empty list doesn't start a batch", "empty_add" )
+{
+	subscription_batch_t batch;
+
+	REQUIRE( !batch.add( {} ) );
+	REQUIRE( batch.empty() );
+	REQUIRE( batch.add( { "a" } ) );
+}
+
+TEST_CASE( "Size-limit flush then stale delayed flush", "stale" )
+{
+	subscription_batch_t batch;
+
+	// The first batch is sent because of size limit before its window ends.
+	REQUIRE( batch.add( { "a", "b" } ) );
+	const auto first_id = batch.id();
+	REQUIRE( vector< string >{ "a", "b" } == batch.take() );
+
+	// The second batch is started before the delayed flush for
+	// the first one arrives.
+	REQUIRE( batch.add( { "c" } ) );
+	const auto second_id = batch.id();
+	REQUIRE( first_id != second_id );
+
+	// The delayed flush for the first batch is stale. The second batch
+	// must wait for its own window.
+	REQUIRE( !batch.is_current( first_id ) );
+	REQUIRE( 1u == batch.size() );
+
+	REQUIRE( batch.is_current( second_id ) );
+	REQUIRE( vector< string >{ "c" } == batch.take() );
+}
+
+TEST_CASE( "Clear makes delayed flush stale", "clear" )
+{
+	subscription_batch_t batch;
+
+	REQUIRE( batch.add( { "a" } ) );
+	const auto id = batch.id();
+
+	// Disconnection.
+	batch.clear();
+	REQUIRE( batch.empty() );
+
+	// New subscriptions after reconnection.
+	REQUIRE( batch.add( { "b" } ) );
+	REQUIRE( !batch.is_current( id ) );
+	REQUIRE( batch.is_current( batch.id() ) );
+}
@@ -0,0 +1,86 @@
+#define CATCH_CONFIG_MAIN
+#include <catch/catch.hpp>
+
+#include <mosquitto_transport/impl/subscription_deadlines.hpp>
+
+using namespace std;
+using namespace std::chrono;
+
+using namespace mosquitto_transport::impl;
+
+TEST_CASE( "Nearest deadline is at the top", "queue" )
+{
+	const auto now = steady_clock::now();
+
+	subscription_deadline_queue_t queue;
+	queue.push( subscription_deadline_t{ now + seconds{3}, 3, {} } );
+	queue.push( subscription_deadline_t{ now + seconds{1}, 0, "a" } );
+	queue.push( subscription_deadline_t{ now + seconds{2}, 2, {} } );
+	queue.push( subscription_deadline_t{ now, 0, "b" } );
+
+	REQUIRE( now == queue.top().m_at );
+	REQUIRE( "b" == queue.top().m_topic_name );
+	queue.pop();
+
+	REQUIRE( now + seconds{1} == queue.top().m_at );
+	REQUIRE( "a" == queue.top().m_topic_name );
+	queue.pop();
+
+	REQUIRE( 2 == queue.top().m_mid );
+	queue.pop();
+
+	REQUIRE( 3 == queue.top().m_mid );
+	queue.pop();
+
+	REQUIRE( queue.empty() );
+}
+
+TEST_CASE( "Exponential backoff without jitter", "backoff" )
+{
+	mt19937 engine;
+
+	const auto delay = [&]( unsigned int attempts ) {
+		return subscription_retry_delay(
+				seconds{1}, seconds{10}, 2.0, 0.0, attempts, engine );
+	};
+
+	REQUIRE( seconds{1} == delay( 0u ) );
+	REQUIRE( seconds{2} == delay( 1u ) );
+	REQUIRE( seconds{4} == delay( 2u ) );
+	REQUIRE( seconds{8} == delay( 3u ) );
+	// Max delay is not exceeded.
+	REQUIRE( seconds{10} == delay( 4u ) );
+	REQUIRE( seconds{10} == delay( 1000u ) );
+}
+
+TEST_CASE( "Constant delay", "constant" )
+{
+	mt19937 engine;
+
+	for( unsigned int attempts = 0u; attempts != 10u; ++attempts )
+		REQUIRE( milliseconds{500} == subscription_retry_delay(
+				milliseconds{500}, seconds{60}, 1.0, 0.0, attempts, engine ) );
+}
+
+TEST_CASE( "Jitter", "jitter" )
+{
+	mt19937 engine;
+
+	bool less = false;
+	bool greater = false;
+	for( int i = 0; i != 1000; ++i )
+		{
+			const auto d = subscription_retry_delay(
+					seconds{1}, seconds{60}, 2.0, 0.2, 2u, engine );
+
+			REQUIRE( milliseconds{3200} <= d );
+			REQUIRE( milliseconds{4800} >= d );
+
+			less = less || d < seconds{4};
+			greater = greater || d > seconds{4};
+		}
+
+	// Delays are really spread.
+	REQUIRE( less );
+	REQUIRE( greater );
+}
@@ -4,6 +4,7 @@
 #include <mosquitto_transport/impl/subscriptions_map.hpp>
 
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <set>
 
@@ -203,3 +204,65 @@ TEST_CASE( "Advanced insert/match/remove", "adv_insert_match_remove" )
 	REQUIRE( mk_expected({"foo/#"}) == mk_actual( map.match("foo") ) );
 	REQUIRE( mk_expected({"foo/#"}) == mk_actual( map.match("foo/") ) );
 }
+
+vector< string > mk_params(
+	const string & topic_name,
+	const subscriptions_map_t< postman_shptr_t >::match_t & m )
+{
+	vector< string > r;
+	for( const auto & p : m.m_params )
+		r.push_back( topic_name.substr( p.m_offset, p.m_size ) );
+
+	return r;
+}
+
+map< string, vector< string > > mk_actual_params(
+	const subscriptions_map_t< postman_shptr_t > & map,
+	const string & topic_name )
+{
+	std::map< string, vector< string > > r;
+	for( const auto & m : map.match_with_params( topic_name ) )
+		r[ m.m_postman->name() ] = mk_params( topic_name, m );
+
+	return r;
+}
+
+TEST_CASE( "Match with params", "match_with_params" )
+{
+	using params_t = map< string, vector< string > >;
+
+	subscriptions_map_t< postman_shptr_t > map;
+	map.insert( "devices/+/telemetry/+",
+			dummy_postman_t::make( "devices/+/telemetry/+" ) );
+	map.insert( "devices/+/#", dummy_postman_t::make( "devices/+/#" ) );
+	map.insert( "devices/#", dummy_postman_t::make( "devices/#" ) );
+	map.insert( "devices/d1/telemetry/t",
+			dummy_postman_t::make( "devices/d1/telemetry/t" ) );
+	map.insert( "#", dummy_postman_t::make( "#" ) );
+
+	REQUIRE( params_t{
+				{ "devices/+/telemetry/+", { "d1", "t" } },
+				{ "devices/+/#", { "d1", "telemetry/t" } },
+				{ "devices/#", { "d1/telemetry/t" } },
+				{ "devices/d1/telemetry/t", {} },
+				{ "#", { "devices/d1/telemetry/t" } } }
+			== mk_actual_params( map, "devices/d1/telemetry/t" ) );
+
+	REQUIRE( params_t{
+				{ "devices/+/#", { "d2", "" } },
+				{ "devices/#", { "d2" } },
+				{ "#", { "devices/d2" } } }
+			== mk_actual_params( map, "devices/d2" ) );
+
+	REQUIRE( params_t{
+				{ "devices/+/telemetry/+", { "", "" } },
+				{ "devices/+/#", { "", "telemetry/" } },
+				{ "devices/#", { "/telemetry/" } },
+				{ "#", { "devices//telemetry/" } } }
+			== mk_actual_params( map, "devices//telemetry/" ) );
+
+	REQUIRE( params_t{
+				{ "devices/#", { "" } },
+				{ "#", { "devices" } } }
+			== mk_actual_params( map, "devices" ) );
+}
@@ -0,0 +1,164 @@
+#define CATCH_CONFIG_MAIN
+#include <catch/catch.hpp>
+
+#include <mosquitto_transport/impl/subscriptions_cover.hpp>
+
+#include <algorithm>
+
+using namespace std;
+using namespace std::string_literals;
+
+using namespace mosquitto_transport;
+using namespace mosquitto_transport::impl;
+
+vector< string > mk_actual( vector< string > v )
+{
+	sort( begin(v), end(v) );
+	return v;
+}
+
+vector< string > mk_actual( const set< string > & v )
+{
+	return vector< string >( begin(v), end(v) );
+}
+
+vector< string > mk_expected( vector< string > v )
+{
+	sort( begin(v), end(v) );
+	return v;
+}
+
+TEST_CASE( "Covering of topic filters", "covering" )
+{
+	REQUIRE( topic_filter_covers( "a/b", "a/b" ) );
+	REQUIRE( topic_filter_covers( "a/+", "a/b" ) );
+	REQUIRE( topic_filter_covers( "a/+", "a/+" ) );
+	REQUIRE( topic_filter_covers( "a/#", "a/b/c" ) );
+	REQUIRE( topic_filter_covers( "a/#", "a/+/c" ) );
+	REQUIRE( topic_filter_covers( "a/#", "a/#" ) );
+	REQUIRE( topic_filter_covers( "a/#", "a" ) );
+	REQUIRE( topic_filter_covers( "a/#", "a/b/#" ) );
+	REQUIRE( topic_filter_covers( "#", "a/b" ) );
+	REQUIRE( topic_filter_covers( "+/+/temp", "plant/1/temp" ) );
+
+	REQUIRE( !topic_filter_covers( "a/b", "a/+" ) );
+	REQUIRE( !topic_filter_covers( "a/+", "a/#" ) );
+	REQUIRE( !topic_filter_covers( "a/+", "a" ) );
+	REQUIRE( !topic_filter_covers( "a/+", "a/b/c" ) );
+	REQUIRE( !topic_filter_covers( "a/b/#", "a/#" ) );
+	REQUIRE( !topic_filter_covers( "a/b", "a/c" ) );
+
+	REQUIRE( !topic_filter_covers( "#", "$SYS/load" ) );
+	REQUIRE( !topic_filter_covers( "+/load", "$SYS/load" ) );
+	REQUIRE( topic_filter_covers( "$SYS/#", "$SYS/load" ) );
+
+	REQUIRE( topic_filter_covers( "$share/g/a", "$share/g/a" ) );
+	REQUIRE( !topic_filter_covers( "#", "$share/g/a" ) );
+	REQUIRE( !topic_filter_covers( "$share/g/#", "$share/g/a" ) );
+}
+
+TEST_CASE( "Insertion of filters", "insertion" )
+{
+	subscriptions_cover_t cover;
+
+	auto a = cover.insert( "plant/1/line3/temp" );
+	REQUIRE( mk_expected({ "plant/1/line3/temp" }) == mk_actual( a.m_subscribe ) );
+	REQUIRE( a.m_unsubscribe.empty() );
+
+	a = cover.insert( "plant/1/line3/#" );
+	REQUIRE( mk_expected({ "plant/1/line3/#" }) == mk_actual( a.m_subscribe ) );
+	REQUIRE( mk_expected({ "plant/1/line3/temp" }) ==
+			mk_actual( a.m_unsubscribe ) );
+
+	a = cover.insert( "plant/1/+/temp" );
+	REQUIRE( mk_expected({ "plant/1/+/temp" }) == mk_actual( a.m_subscribe ) );
+	REQUIRE( a.m_unsubscribe.empty() );
+
+	a = cover.insert( "plant/1/line3/pressure" );
+	REQUIRE( a.m_subscribe.empty() );
+	REQUIRE( a.m_unsubscribe.empty() );
+
+	REQUIRE( 2u == cover.roots_count() );
+	REQUIRE( cover.is_root( "plant/1/line3/#" ) );
+	REQUIRE( cover.is_root( "plant/1/+/temp" ) );
+	REQUIRE( "plant/1/line3/#"s == cover.root_of( "plant/1/line3/pressure" ) );
+	REQUIRE( mk_expected({ "plant/1/line3/temp", "plant/1/line3/pressure" }) ==
+			mk_actual( cover.covered_by( "plant/1/line3/#" ) ) );
+
+	a = cover.insert( "plant/#" );
+	REQUIRE( mk_expected({ "plant/#" }) == mk_actual( a.m_subscribe ) );
+	REQUIRE( mk_expected({ "plant/1/line3/#", "plant/1/+/temp" }) ==
+			mk_actual( a.m_unsubscribe ) );
+	REQUIRE( 1u == cover.roots_count() );
+	REQUIRE( 4u == cover.covered_by( "plant/#" ).size() );
+
+	a = cover.insert( "$share/g/plant/1" );
+	REQUIRE( mk_expected({ "$share/g/plant/1" }) == mk_actual( a.m_subscribe ) );
+	REQUIRE( a.m_unsubscribe.empty() );
+	REQUIRE( 2u == cover.roots_count() );
+}
+
+TEST_CASE( "Removal of filters", "removal" )
+{
+	subscriptions_cover_t cover;
+
+	cover.insert( "a/#" );
+	cover.insert( "a/b/#" );
+	cover.insert( "a/b/c" );
+	cover.insert( "a/+/d" );
+	cover.insert( "a/x" );
+
+	REQUIRE( 1u == cover.roots_count() );
+
+	// Removal of covered filter doesn't require broker actions.
+	auto a = cover.erase( "a/x" );
+	REQUIRE( a.m_subscribe.empty() );
+	REQUIRE( a.m_unsubscribe.empty() );
+
+	// Orphans must get new roots.
+	a = cover.erase( "a/#" );
+	REQUIRE( mk_expected({ "a/b/#", "a/+/d" }) == mk_actual( a.m_subscribe ) );
+	REQUIRE( mk_expected({ "a/#" }) == mk_actual( a.m_unsubscribe ) );
+	REQUIRE( "a/b/#"s == cover.root_of( "a/b/c" ) );
+	REQUIRE( cover.is_root( "a/+/d" ) );
+
+	a = cover.erase( "a/b/#" );
+	REQUIRE( mk_expected({ "a/b/c" }) == mk_actual( a.m_subscribe ) );
+	REQUIRE( mk_expected({ "a/b/#" }) == mk_actual( a.m_unsubscribe ) );
+
+	a = cover.erase( "a/b/c" );
+	REQUIRE( a.m_subscribe.empty() );
+	REQUIRE( mk_expected({ "a/b/c" }) == mk_actual( a.m_unsubscribe ) );
+
+	a = cover.erase( "a/+/d" );
+	REQUIRE( 0u == cover.roots_count() );
+
+	// Removal of unknown filter.
+	a = cover.erase( "unknown" );
+	REQUIRE( a.m_subscribe.empty() );
+	REQUIRE( a.m_unsubscribe.empty() );
+}
+
+TEST_CASE( "Orphans covered by existing roots", "orphans" )
+{
+	subscriptions_cover_t cover;
+
+	cover.insert( "a/+/c" );
+	cover.insert( "a/#" );
+	cover.insert( "+/b/c" );
+
+	REQUIRE( 2u == cover.roots_count() );
+
+	auto a = cover.erase( "a/#" );
+	REQUIRE( mk_expected({ "a/+/c" }) == mk_actual( a.m_subscribe ) );
+	REQUIRE( mk_expected({ "a/#" }) == mk_actual( a.m_unsubscribe ) );
+
+	cover.insert( "a/b/c" );
+	REQUIRE( "a/+/c"s == cover.root_of( "a/b/c" ) );
+
+	// a/b/c is still covered by +/b/c.
+	a = cover.erase( "a/+/c" );
+	REQUIRE( a.m_subscribe.empty() );
+	REQUIRE( mk_expected({ "a/+/c" }) == mk_actual( a.m_unsubscribe ) );
+	REQUIRE( "+/b/c"s == cover.root_of( "a/b/c" ) );
+}
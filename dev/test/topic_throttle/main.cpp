@@ -0,0 +1,116 @@
+#define CATCH_CONFIG_MAIN
+#include <catch/catch.hpp>
+
+#include <mosquitto_transport/impl/topic_throttle.hpp>
+
+using namespace std;
+using namespace std::chrono;
+
+using namespace mosquitto_transport::impl;
+
+TEST_CASE( "Disabled throttle", "disabled" )
+{
+	topic_throttle_t throttle{ steady_clock::duration::zero(), 0u };
+	const auto now = steady_clock::now();
+
+	REQUIRE( !throttle.enabled() );
+	for( int i = 0; i != 10; ++i )
+		REQUIRE( throttle.accept( "a/b", now ) );
+	REQUIRE( 0u == throttle.size() );
+}
+
+TEST_CASE( "Sampling", "sampling" )
+{
+	topic_throttle_t throttle{ steady_clock::duration::zero(), 3u };
+	const auto now = steady_clock::now();
+
+	REQUIRE( throttle.enabled() );
+
+	REQUIRE( throttle.accept( "a/b", now ) );
+	REQUIRE( !throttle.accept( "a/b", now ) );
+	REQUIRE( !throttle.accept( "a/b", now ) );
+	REQUIRE( throttle.accept( "a/b", now ) );
+	REQUIRE( !throttle.accept( "a/b", now ) );
+
+	// Topics are sampled separately.
+	REQUIRE( throttle.accept( "a/c", now ) );
+	REQUIRE( !throttle.accept( "a/c", now ) );
+	REQUIRE( !throttle.accept( "a/b", now ) );
+	REQUIRE( throttle.accept( "a/b", now ) );
+
+	REQUIRE( 2u == throttle.size() );
+}
+
+TEST_CASE( "Rate limiting", "rate" )
+{
+	topic_throttle_t throttle{ milliseconds{100}, 1u };
+	const auto now = steady_clock::now();
+
+	REQUIRE( throttle.enabled() );
+
+	REQUIRE( throttle.accept( "a/b", now ) );
+	REQUIRE( !throttle.accept( "a/b", now + milliseconds{50} ) );
+	REQUIRE( throttle.accept( "a/c", now + milliseconds{50} ) );
+	REQUIRE( !throttle.accept( "a/b", now + milliseconds{99} ) );
+	REQUIRE( throttle.accept( "a/b", now + milliseconds{100} ) );
+	REQUIRE( !throttle.accept( "a/b", now + milliseconds{150} ) );
+	REQUIRE( throttle.accept( "a/b", now + milliseconds{500} ) );
+}
+
+TEST_CASE( "Sampling with rate limiting", "sampling_and_rate" )
+{
+	topic_throttle_t throttle{ milliseconds{100}, 2u };
+	const auto now = steady_clock::now();
+
+	// Selected.
+	REQUIRE( throttle.accept( "a/b", now ) );
+	// Not selected.
+	REQUIRE( !throttle.accept( "a/b", now + milliseconds{20} ) );
+	// Selected but too early.
+	REQUIRE( !throttle.accept( "a/b", now + milliseconds{50} ) );
+	// Not selected.
+	REQUIRE( !throttle.accept( "a/b", now + milliseconds{110} ) );
+	// Selected.
+	REQUIRE( throttle.accept( "a/b", now + milliseconds{120} ) );
+}
+
+TEST_CASE( "Removal of idle topics", "idle" )
+{
+	topic_throttle_t throttle{ milliseconds{100}, 2u, milliseconds{500} };
+	const auto now = steady_clock::now();
+
+	REQUIRE( throttle.accept( "a/b", now ) );
+	REQUIRE( throttle.accept( "a/c", now ) );
+	REQUIRE( !throttle.accept( "a/c", now + milliseconds{400} ) );
+	REQUIRE( 2u == throttle.size() );
+
+	// The first sweep. "a/b" is idle, "a/c" isn't.
+	REQUIRE( throttle.accept( "a/d", now + milliseconds{600} ) );
+	REQUIRE( 2u == throttle.size() );
+
+	// Too early for the next sweep.
+	REQUIRE( throttle.accept( "a/b", now + milliseconds{1000} ) );
+	REQUIRE( 3u == throttle.size() );
+
+	// Only "a/b" has messages during the last idle timeout.
+	REQUIRE( !throttle.accept( "a/b", now + milliseconds{1100} ) );
+	REQUIRE( 1u == throttle.size() );
+
+	// Sampling of the removed topic starts from the beginning.
+	REQUIRE( throttle.accept( "a/c", now + milliseconds{1200} ) );
+}
+
+TEST_CASE( "Idle timeout is not less than min interval", "idle_min_interval" )
+{
+	topic_throttle_t throttle{ milliseconds{1000}, 1u, milliseconds{100} };
+	const auto now = steady_clock::now();
+
+	REQUIRE( throttle.accept( "a/b", now ) );
+	REQUIRE( throttle.accept( "a/c", now + milliseconds{50} ) );
+
+	// The state of "a/b" is kept by the sweep and it is still limited.
+	REQUIRE( !throttle.accept( "a/c", now + milliseconds{500} ) );
+	REQUIRE( !throttle.accept( "a/b", now + milliseconds{999} ) );
+	REQUIRE( 2u == throttle.size() );
+	REQUIRE( throttle.accept( "a/b", now + milliseconds{1000} ) );
+}